@@ -5,6 +5,13 @@
 #include <sstream>
 #include <stdio.h>
 #include <chrono>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <iomanip>
+#include <csignal>
+#include <pthread.h>
 
 #include <vector>
 #include <tuple>
@@ -24,102 +31,108 @@
 #include "GameLibrary/vector.h"
 #include "GameLibrary/matrix.h"
 #include "GameLibrary/operators.h"
-#include "GameLibrary/fit.h"
-
-#define OCVSTEP 0
-#define MEASURETIME
-
-// InputType structure 
-enum InputType {
-    image, video, camera
-};
-
-// all relevant paramters
-struct Parameters {
-    // input handling
-    std::array<int, 4> crop = {0, 0, 0, 0};
-    InputType inputtype = InputType::image;
-    std::string inputFile;
-    std::string configFile;
-    libconfig::Config config;
-
-    // renderer options
-    int width;
-    int height;
-
-    // opencv specific
-    int fillShortBlanks;
-    int lightThreshold;
-    int interThreshold;
-    int minLineLength;
-    int maxLineGap;
-    int blursize;
-    int upperThreshold;
-    int lowerThreshold;
-    int rResolution;
-    float thetaResolution;
-    bool blankMoves = false;
-    bool doColorCorrection = false;
-    bool colorBoost = true;
-
-    // SDL specific
-    int maxFramesPerSecond = 20;
-};
-
-template<typename T> 
-T distanceSq(types::xypoint<T> a, types::xypoint<T> b) {
-    T deltaX = a.first - b.first;
-    T deltaY = a.second - b.second;
-    return (deltaX * deltaX + deltaY * deltaY);
-}
+#include "src/parameters.h"
+#include "src/pointframe.h"
+#include "src/vectorizer.h"
+#include "src/color.h"
+#include "src/geometry.h"
+#include "src/output.h"
+#include "src/multidevice.h"
+#include "src/trace.h"
+#include "src/compiler.h"
+#include "src/ilda.h"
+#include "src/svg.h"
+#include "src/input.h"
+#include "src/framecache.h"
+#include "src/linalg.h"
+#include "src/snapshot.h"
+#include "src/realtime.h"
+#include "src/autotune.h"
+#include "src/compositor.h"
+#include "src/strokefont.h"
 
 void usage(char* argv[]) {
     std::cout << "Usage:" << std::endl << argv[0] << " -i <path/filename> [options]" << std::endl;
     std::cout << "Options:" << std::endl;
     std::cout << "-h                                                   display help message" << std::endl;
     std::cout << "-i <input filename>                                  path to input file to render" << std::endl;
+    std::cout << "                                                     image sequence (img_%04d.png or a directory), camera, screen, shm[:/name] or compose" << std::endl;
     std::cout << "-x <width>                                           display width" << std::endl;
     std::cout << "-y <height>                                          display height" << std::endl;
     std::cout << "-c <crop-left>,<crop-up>,<crop-right>,<crop-down>    crop dimensions" << std::endl;
     std::cout << "-k <config filename>                                 path to config file" << std::endl;
+    std::cout << "-d <lumax|simulated>                                 output backend" << std::endl;
+    std::cout << "-o <ILDA filename>                                   compile the input offline into an ILDA file" << std::endl;
+    std::cout << "-a                                                   auto-tune the opencv parameters on the input, written to the config file" << std::endl;
+    std::cout << "-r <ILDA filename>                                   record the emitted frames" << std::endl;
+    std::cout << "-t <trace filename>                                  enable tracing, written with x and on exit" << std::endl;
+    std::cout << "-s <raw filename>                                    save the input frames for a bit-exact replay with -i" << std::endl;
+    std::cout << "-b                                                   benchmark: no frame rate cap and no video pacing" << std::endl;
+    std::cout << "-n                                                   headless: no window, statistics on the console" << std::endl;
 
     std::exit(-1);
 }
 
-cv::Mat readInputSource(const std::string& input, cv::VideoCapture& capture, InputType inputtype, std::array<int, 4> cropDim) {
-    cv::Mat img;
-    if (inputtype == InputType::image) {
-        // read image from file
-        img = cv::imread(input);
-    } else if (inputtype == InputType::video || inputtype == InputType::camera) {
-        // get a new frame from camera
-        capture >> img;
-    
-        if (cropDim[0] != 0 || cropDim[1] != 0 || cropDim[2] != 0 || cropDim[3] != 0) {
-            cropDim[0] = algorithms::constrain(cropDim[0], 0, img.cols / 2);
-            cropDim[1] = algorithms::constrain(cropDim[1], 0, img.rows / 2);
-            cropDim[2] = algorithms::constrain(cropDim[2], 0, img.cols / 2);
-            cropDim[3] = algorithms::constrain(cropDim[3], 0, img.rows / 2);
-            // Crop the full image to that image contained by the rectangle crop
-            cv::Rect crop(cropDim[0], cropDim[1], img.cols - cropDim[0] - cropDim[2], img.rows - cropDim[1] - cropDim[3]);
-            img = img(crop);
+// SIGINT and SIGTERM end all loops, so the devices are always stopped and closed
+std::atomic<bool> stopRequested(false);
+
+// waits for the signals in a thread of its own: all other threads have them blocked,
+// so the waiting input can be cancelled here, where taking locks is allowed
+class signalWatcher {
+public:
+    signalWatcher() {
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        // inherited by all threads started later
+        pthread_sigmask(SIG_BLOCK, &signals, NULL);
+        worker = std::thread(&signalWatcher::run, this);
+    }
+    ~signalWatcher() {
+        done = true;
+        pthread_kill(worker.native_handle(), SIGTERM);
+        worker.join();
+    }
+
+    // the input that is cancelled on a signal, NULL before it is stopped
+    void watch(input::prefetcher* p) {
+        std::lock_guard<std::mutex> lock(mutex);
+        prefetch = p;
+    }
+
+private:
+    void run() {
+        int sig = 0;
+        while (sigwait(&signals, &sig) == 0 && !done) {
+            std::cout << "Signal " << sig << ", stopping." << std::endl;
+            stopRequested = true;
+            std::lock_guard<std::mutex> lock(mutex);
+            if (prefetch != NULL)
+                prefetch->cancel();
         }
     }
-    return img;
-}
+
+    sigset_t signals;
+    std::thread worker;
+    std::mutex mutex;
+    input::prefetcher* prefetch = NULL;
+    std::atomic<bool> done{false};
+};
 
 #if LUMAX_OUTPUT
 // TODO: move to seperate file
-void colorCorrection(void* lumaxHandle, renderer::lumaxRenderer& ren, SDL_Renderer* renderer, TTF_Font* font, Parameters& parameters) {
+void colorCorrection(output::lumaxBackend& dac, SDL_Renderer* renderer, TTF_Font* font, Parameters& parameters) {
     sdl::auxiliary::timer fps;
     SDL_Event e;
     bool quit = false;
     bool done = false;
     std::string message = std::string();
     size_t maxSteps = 7;
-    math::vector<math::vector<double>> pointsRed(4, 2);
-    math::vector<math::vector<double>> pointsGre(4, 2);
-    math::vector<math::vector<double>> pointsBlu(4, 2);
+    linalg::matrix<double> pointsRed(4, 2);
+    linalg::matrix<double> pointsGre(4, 2);
+    linalg::matrix<double> pointsBlu(4, 2);
+    geometry::projection calibrationLayout = geometry::projection::toDevice(renderer::screen_width, renderer::screen_height)
+        * geometry::projection::fromLayout(dac.getLayout(), renderer::screen_width, renderer::screen_height);
 
     for (int step = 0; step < maxSteps; ++step) {
         int r = 0, g = 0, b = 0;
@@ -188,42 +201,42 @@ void colorCorrection(void* lumaxHandle, renderer::lumaxRenderer& ren, SDL_Render
                         done = true;
                         switch(step) {
                             case 0:
-                                pointsRed[0][0] = 0; // soll
-                                pointsRed[0][1] = r; // ist
+                                pointsRed(0, 0) = 0; // soll
+                                pointsRed(0, 1) = r; // ist
                                 break;
                             case 1:
-                                pointsGre[0][0] = 0; // soll
-                                pointsGre[0][1] = g; // ist
+                                pointsGre(0, 0) = 0; // soll
+                                pointsGre(0, 1) = g; // ist
                                 break;
                             case 2:
-                                pointsBlu[0][0] = 0; // soll
-                                pointsBlu[0][1] = b; // ist
+                                pointsBlu(0, 0) = 0; // soll
+                                pointsBlu(0, 1) = b; // ist
                                 break;
                             case 3:
-                                pointsRed[1][0] = 255; // soll
-                                pointsRed[1][1] = r; // ist
-                                pointsGre[1][0] = 255; // soll
-                                pointsGre[1][1] = g; // ist
-                                pointsBlu[1][0] = 255; // soll
-                                pointsBlu[1][1] = b; // ist
+                                pointsRed(1, 0) = 255; // soll
+                                pointsRed(1, 1) = r; // ist
+                                pointsGre(1, 0) = 255; // soll
+                                pointsGre(1, 1) = g; // ist
+                                pointsBlu(1, 0) = 255; // soll
+                                pointsBlu(1, 1) = b; // ist
                                 break;
                             case 4:
-                                pointsRed[2][0] = 170; // soll
-                                pointsRed[2][1] = r; // ist
-                                pointsGre[2][0] = 170; // soll
-                                pointsGre[2][1] = g; // ist
+                                pointsRed(2, 0) = 170; // soll
+                                pointsRed(2, 1) = r; // ist
+                                pointsGre(2, 0) = 170; // soll
+                                pointsGre(2, 1) = g; // ist
                                 break;
                             case 5:
-                                pointsGre[3][0] = 170; // soll
-                                pointsGre[3][1] = g; // ist
-                                pointsBlu[2][0] = 170; // soll
-                                pointsBlu[2][1] = b; // ist
+                                pointsGre(3, 0) = 170; // soll
+                                pointsGre(3, 1) = g; // ist
+                                pointsBlu(2, 0) = 170; // soll
+                                pointsBlu(2, 1) = b; // ist
                                 break;
                             case 6:
-                                pointsBlu[3][0] = 170; // soll
-                                pointsBlu[3][1] = b; // ist
-                                pointsRed[3][0] = 170; // soll
-                                pointsRed[3][1] = r; // ist
+                                pointsBlu(3, 0) = 170; // soll
+                                pointsBlu(3, 1) = b; // ist
+                                pointsRed(3, 0) = 170; // soll
+                                pointsRed(3, 1) = r; // ist
                                 break;
                         }
                     }
@@ -267,15 +280,17 @@ void colorCorrection(void* lumaxHandle, renderer::lumaxRenderer& ren, SDL_Render
             // apply the renderer to the screen
             SDL_RenderPresent(renderer);
 
-            std::vector<types::point<float>> points;
-            points.push_back({ 100,  100,   0,   0,   0, 255, false});
-            points.push_back({ 100,  100, r, g, b, 255, false});
-            points.push_back({-100,  100, r, g, b, 255, false});
-            points.push_back({-100, -100, r, g, b, 255, false});
-            points.push_back({ 100, -100, r, g, b, 255, false});
-            points.push_back({ 100,  100, r, g, b, 255, false});
-            renderer::drawPoints(points, ren);
-            renderer::sendPointsToLumax(lumaxHandle, ren, 200);
+            // square around the center of the screen
+            const int cx = renderer::screen_width / 2, cy = renderer::screen_height / 2;
+            laser::frame points(6);
+            points.push(cx + 100, cy + 100, 0, 0, 0);
+            points.push(cx + 100, cy + 100, r, g, b);
+            points.push(cx - 100, cy + 100, r, g, b);
+            points.push(cx - 100, cy - 100, r, g, b);
+            points.push(cx + 100, cy - 100, r, g, b);
+            points.push(cx + 100, cy + 100, r, g, b);
+            calibrationLayout.apply(points);
+            dac.sendFrame(points, 200);
 
             // apply the fps cap
             if (fps.getTicks() < 1000 / 10) {
@@ -286,51 +301,40 @@ void colorCorrection(void* lumaxHandle, renderer::lumaxRenderer& ren, SDL_Render
 
     // Summary
     std::cout << "Summary:" << std::endl;
-    math::matrix<double> matrixRed(pointsRed);
-    math::matrix<double> matrixGre(pointsGre);
-    math::matrix<double> matrixBlu(pointsBlu);
+    for (size_t i = 0; i < pointsRed.rows(); ++i)
+        std::cout << "Pred_" << i << " = (" << pointsRed(i, 0) << ", " << pointsRed(i, 1) << ")" << std::endl;
+    for (size_t i = 0; i < pointsGre.rows(); ++i)
+        std::cout << "Pgre_" << i << " = (" << pointsGre(i, 0) << ", " << pointsGre(i, 1) << ")" << std::endl;
+    for (size_t i = 0; i < pointsBlu.rows(); ++i)
+        std::cout << "Pblu_" << i << " = (" << pointsBlu(i, 0) << ", " << pointsBlu(i, 1) << ")" << std::endl;
 
-    for (size_t i = 0; i < matrixRed.rows(); ++i)
-        std::cout << "Pred_" << i << " = (" << matrixRed(i, 0) << ", " << matrixRed(i, 1) << ")" << std::endl;
-    for (size_t i = 0; i < matrixGre.rows(); ++i)
-        std::cout << "Pgre_" << i << " = (" << matrixGre(i, 0) << ", " << matrixGre(i, 1) << ")" << std::endl;
-    for (size_t i = 0; i < matrixBlu.rows(); ++i)
-        std::cout << "Pblu_" << i << " = (" << matrixBlu(i, 0) << ", " << matrixBlu(i, 1) << ")" << std::endl;
-
-    math::vector<double> coeffRed = math::utilities::fit::polyFit<double>(matrixRed, 2);
-    math::vector<double> coeffGre = math::utilities::fit::polyFit<double>(matrixGre, 2);
-    math::vector<double> coeffBlu = math::utilities::fit::polyFit<double>(matrixBlu, 2);
+    std::vector<double> coeffRed = linalg::polyFit<double>(pointsRed, 2);
+    std::vector<double> coeffGre = linalg::polyFit<double>(pointsGre, 2);
+    std::vector<double> coeffBlu = linalg::polyFit<double>(pointsBlu, 2);
 
     std::cout << "Color correction polynomials:" << std::endl;
     std::cout << "Pol_red(x) = " << coeffRed[0] << " + " << coeffRed[1] << " * x + " << coeffRed[2] << " * x^2" << std::endl; 
     std::cout << "Pol_gre(x) = " << coeffGre[0] << " + " << coeffGre[1] << " * x + " << coeffGre[2] << " * x^2" << std::endl; 
     std::cout << "Pol_blu(x) = " << coeffBlu[0] << " + " << coeffBlu[1] << " * x + " << coeffBlu[2] << " * x^2" << std::endl; 
 
-    // store the coefficients
-    ren.parameters.colorCorr.ar = static_cast<float>(coeffRed[2]);
-    ren.parameters.colorCorr.br = static_cast<float>(coeffRed[1]);
-    ren.parameters.colorCorr.cr = static_cast<float>(coeffRed[0]);
-    ren.parameters.colorCorr.ag = static_cast<float>(coeffGre[2]);
-    ren.parameters.colorCorr.bg = static_cast<float>(coeffGre[1]);
-    ren.parameters.colorCorr.cg = static_cast<float>(coeffGre[0]);
-    ren.parameters.colorCorr.ab = static_cast<float>(coeffBlu[2]);
-    ren.parameters.colorCorr.bb = static_cast<float>(coeffBlu[1]);
-    ren.parameters.colorCorr.cb = static_cast<float>(coeffBlu[0]);
+    // compile the coefficients into the lookup table of the device
+    color::correction corr;
+    corr.ar = static_cast<float>(coeffRed[2]);
+    corr.br = static_cast<float>(coeffRed[1]);
+    corr.cr = static_cast<float>(coeffRed[0]);
+    corr.ag = static_cast<float>(coeffGre[2]);
+    corr.bg = static_cast<float>(coeffGre[1]);
+    corr.cg = static_cast<float>(coeffGre[0]);
+    corr.ab = static_cast<float>(coeffBlu[2]);
+    corr.bb = static_cast<float>(coeffBlu[1]);
+    corr.cb = static_cast<float>(coeffBlu[0]);
+    dac.setColorTable(color::buildLookupTable(corr));
 
     // write coefficients to file
     if (parameters.configFile != std::string()) {
         libconfig::Setting& root = parameters.config.getRoot();
         try {
-            libconfig::Setting& colorCorrection = root["lumax"]["color-correction"];
-            colorCorrection["ar"] = static_cast<float>(ren.parameters.colorCorr.ar);
-            colorCorrection["br"] = static_cast<float>(ren.parameters.colorCorr.br);
-            colorCorrection["cr"] = static_cast<float>(ren.parameters.colorCorr.cr);
-            colorCorrection["ag"] = static_cast<float>(ren.parameters.colorCorr.ag);
-            colorCorrection["bg"] = static_cast<float>(ren.parameters.colorCorr.bg);
-            colorCorrection["cg"] = static_cast<float>(ren.parameters.colorCorr.cg);
-            colorCorrection["ab"] = static_cast<float>(ren.parameters.colorCorr.ab);
-            colorCorrection["bb"] = static_cast<float>(ren.parameters.colorCorr.bb);
-            colorCorrection["cb"] = static_cast<float>(ren.parameters.colorCorr.cb);
+            color::setCorrection(root["lumax"]["color-correction"], corr);
             parameters.config.writeFile(parameters.configFile.c_str());
         } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore*/
     } else {
@@ -339,60 +343,278 @@ void colorCorrection(void* lumaxHandle, renderer::lumaxRenderer& ren, SDL_Render
 }
 #endif
 
-void handleKeyPress(Parameters& parameters) {
+// true if a parameter was changed
+bool handleKeyPress(Parameters& parameters) {
     // handle keyboard inputs (no lags and delays!)
+    bool changed = false;
     const uint8_t* keystate = SDL_GetKeyboardState(NULL);
     if (keystate[SDL_SCANCODE_B]) {
+        changed = true;
         parameters.blankMoves = !parameters.blankMoves;
     }
     if (keystate[SDL_SCANCODE_W]) {
+        changed = true;
         parameters.fillShortBlanks++;
     }
     if (keystate[SDL_SCANCODE_S]) {
+        changed = true;
         parameters.fillShortBlanks = (parameters.fillShortBlanks >= 2 ? parameters.fillShortBlanks - 1 : parameters.fillShortBlanks);
     }
     if (keystate[SDL_SCANCODE_E]) {
+        changed = true;
         parameters.lightThreshold++;
     }
     if (keystate[SDL_SCANCODE_D]) {
+        changed = true;
         parameters.lightThreshold = (parameters.lightThreshold >= 2 ? parameters.lightThreshold - 1 : parameters.lightThreshold);
     }
     if (keystate[SDL_SCANCODE_R]) {
+        changed = true;
         parameters.interThreshold++;
     }
     if (keystate[SDL_SCANCODE_F]) {
+        changed = true;
         parameters.interThreshold = (parameters.interThreshold >= 1 ? parameters.interThreshold - 1 : parameters.interThreshold);
     }
     if (keystate[SDL_SCANCODE_T]) {
+        changed = true;
         parameters.minLineLength++;
     }
     if (keystate[SDL_SCANCODE_G]) {
+        changed = true;
         parameters.minLineLength = (parameters.minLineLength >= 1 ? parameters.minLineLength - 1 : parameters.minLineLength);   
     }
     if (keystate[SDL_SCANCODE_Y]) {
+        changed = true;
         parameters.maxLineGap++;
     }
     if (keystate[SDL_SCANCODE_H]) {
+        changed = true;
         parameters.maxLineGap = (parameters.maxLineGap >= 1 ? parameters.maxLineGap - 1 : parameters.maxLineGap);
     }
     if (keystate[SDL_SCANCODE_U]) {
+        changed = true;
         parameters.blursize += 2;
     }
     if (keystate[SDL_SCANCODE_J]) {
+        changed = true;
         parameters.blursize = (parameters.blursize >= 3 ? parameters.blursize - 2 : parameters.blursize);
     }
     if (keystate[SDL_SCANCODE_I]) {
+        changed = true;
         parameters.upperThreshold++;
     }
     if (keystate[SDL_SCANCODE_K]) {
+        changed = true;
         parameters.upperThreshold = (parameters.upperThreshold >= 1 ? parameters.upperThreshold - 1 : parameters.upperThreshold);
     }
     if (keystate[SDL_SCANCODE_O]) {
+        changed = true;
         parameters.lowerThreshold = (parameters.lowerThreshold < parameters.upperThreshold ? parameters.lowerThreshold + 1 : parameters.upperThreshold - 1);
     }
     if (keystate[SDL_SCANCODE_L]) {
+        changed = true;
         parameters.lowerThreshold = (parameters.lowerThreshold >= 1 ? parameters.lowerThreshold - 1 : parameters.lowerThreshold);
     }
+    return changed;
+}
+
+// per stage timing of the last frames (p50 / p95 / p99) and the capture to laser latency
+void renderTrace(TTF_Font* font, SDL_Color textColor, SDL_Renderer* renderer, int x, int y) {
+    char line[128];
+    for (int s = 0; s < trace::numberOfStages; ++s) {
+        trace::percentiles p = trace::getPercentiles(static_cast<trace::stage>(s));
+        std::snprintf(line, sizeof(line), "%-7s %6.2f / %6.2f / %6.2f ms", trace::stageName(static_cast<trace::stage>(s)), p.p50, p.p95, p.p99);
+        sdl::auxiliary::utilities::renderText(line, font, textColor, renderer, x, y + 25 * s);
+    }
+    trace::percentiles p = trace::getLatency();
+    std::snprintf(line, sizeof(line), "capture to laser %6.2f / %6.2f / %6.2f ms", p.p50, p.p95, p.p99);
+    sdl::auxiliary::utilities::renderText(line, font, textColor, renderer, x, y + 25 * trace::numberOfStages);
+}
+
+// find the lines and generate the laser points of img with one parameter snapshot, looping
+// media from the cache, several inputs from the compositor
+void generateFrame(const cv::Mat& img, const Parameters& parameters, const snapshot::publisher<vectorizerParameters>::version& tuning,
+                   const laser::frame& drawing, compositor::compositor* compositing, framecache::cache* frameCache, uint64_t& cachedVersion,
+                   std::vector<cv::Vec4i>& houghLines, laser::frame& points, cv::Mat& display) {
+    houghLines.clear();
+    if (parameters.inputtype == vectorgraphic) {
+        const uint64_t id = points.sequence;
+        points = drawing;
+        points.sequence = id;
+        display = img;
+    } else if (compositing != NULL) {
+        compositing->compose(points);
+        display = img;
+    } else if (frameCache != NULL) {
+        // the snapshot version is the key of the parameters, results of older versions
+        // never match and are dropped
+        if (tuning.number != cachedVersion) {
+            frameCache->clear();
+            cachedVersion = tuning.number;
+        }
+        const uint64_t key = framecache::key(framecache::hashImage(img), tuning.number);
+        if (frameCache->lookup(key, points, houghLines)) {
+            display = vectorizer::preview(img);
+        } else {
+            vectorizer::vectorize(img, tuning.value, houghLines, points, display);
+            frameCache->insert(key, points, houghLines);
+        }
+    } else {
+        vectorizer::vectorize(img, tuning.value, houghLines, points, display);
+    }
+}
+
+// stream a precompiled ILDA file to the devices at its frame rate: no OpenCV, the frames are
+// read straight from the mapped file into one reused point frame.
+// Keys: space pause, left/right seek 5s, n loop on/off, x write trace. Without renderer
+// (headless) there is no preview and no keys.
+void playIlda(ilda::reader& file, output::deviceGroup& devices, SDL_Renderer* renderer, TTF_Font* font, SDL_Color textColor, Parameters& parameters) {
+    double fps = file.getFrameRate();
+    if (fps <= 0)
+        fps = parameters.maxFramesPerSecond;
+    std::cout << "Playing " << file.getFrames() << " frames at " << fps << " fps." << std::endl;
+
+    ilda::playback clock(file.getFrames(), fps);
+    laser::frame points(file.getMaxPoints());
+    long shown = -1;
+    bool quit = false;
+    SDL_Event e;
+    clock.start();
+    while (!quit && !stopRequested) {
+        while (renderer != NULL && SDL_PollEvent(&e)) {
+            if (e.type == SDL_QUIT) {
+                quit = true;
+            } else if (e.type == SDL_KEYDOWN) {
+                if (e.key.keysym.sym == SDLK_SPACE)
+                    clock.setPause(!clock.isPaused());
+                if (e.key.keysym.sym == SDLK_LEFT)
+                    clock.seek(-5);
+                if (e.key.keysym.sym == SDLK_RIGHT)
+                    clock.seek(5);
+                if (e.key.keysym.sym == SDLK_n)
+                    clock.setLoop(!clock.isLooping());
+                if (e.key.keysym.sym == SDLK_x && parameters.trace)
+                    trace::writeChromeTrace(parameters.traceFile);
+            }
+        }
+
+        const long index = clock.getFrame();
+        if (index < 0)
+            break; // end of the file
+        if (index != shown) {
+            points.sequence = trace::nextFrame();
+            {
+                trace::scope span(points.sequence, trace::decode);
+                file.readFrame(static_cast<size_t>(index), points);
+            }
+            devices.present(points);
+            shown = index;
+            if (parameters.trace)
+                trace::collect();
+            if (renderer == NULL)
+                continue;
+
+            // preview: device coordinates -> screen
+            SDL_RenderClear(renderer);
+            boxRGBA(renderer, 0, 0, renderer::screen_width, renderer::screen_height, 10, 10, 10, 255);
+            for (size_t i = 1; i < points.size(); ++i) {
+                int x1 = (points.x[i - 1] + 32768) * renderer::screen_width / 65536;
+                int y1 = (32767 - points.y[i - 1]) * renderer::screen_height / 65536;
+                int x2 = (points.x[i] + 32768) * renderer::screen_width / 65536;
+                int y2 = (32767 - points.y[i]) * renderer::screen_height / 65536;
+                if (!points.isBlank(i))
+                    lineRGBA(renderer, x1, y1, x2, y2, points.r[i], points.g[i], points.b[i], 255);
+                else if (parameters.blankMoves)
+                    lineRGBA(renderer, x1, y1, x2, y2, 0, 255, 255, 255); // blank move
+            }
+            std::string str = "Frame " + algorithms::typeToStr<long>(index + 1) + " / " + algorithms::typeToStr<size_t>(file.getFrames()) +
+                               ", " + algorithms::typeToStr<int>(static_cast<int>(clock.getPosition())) + "s" + (clock.isLooping() ? " (loop)" : "");
+            sdl::auxiliary::utilities::renderText(str, font, textColor, renderer, 25, 25);
+            SDL_RenderPresent(renderer);
+        }
+
+        // sleep until the next frame is due
+        std::this_thread::sleep_for(std::chrono::duration<double>(clock.getTimeToNextFrame()));
+    }
+}
+
+// capture -> vectorize -> output without window, vsync or SDL: the loop is paced by the
+// prefetcher and its own frame rate cap. Prints the throughput every statsInterval seconds,
+// returns the number of frames.
+uint64_t runHeadless(cv::Mat img, const Parameters& parameters, const snapshot::publisher<vectorizerParameters>& tuning, input::prefetcher* prefetch,
+                     const laser::frame& drawing, compositor::compositor* compositing, framecache::cache* frameCache, uint64_t& cachedVersion,
+                     const strokefont::ticker& ticker, output::deviceGroup& devices) {
+    typedef std::chrono::steady_clock clock;
+    laser::frame points(15000);
+    std::vector<cv::Vec4i> houghLines;
+    cv::Mat display;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / std::max(parameters.maxFramesPerSecond, 1)));
+    const auto statsInterval = std::chrono::seconds(std::max(parameters.statsInterval, 1));
+    const auto start = clock::now();
+    auto due = start;
+    auto statsStart = start;
+    uint64_t frames = 0;
+    uint64_t statsFrames = 0;
+    size_t statsPoints = 0;
+    double statsVectorize = 0;
+    // frames that took longer than the frame period to vectorize
+    uint64_t vectorizeMisses = 0;
+
+    std::cout << "Headless: running without window, stop with Ctrl-C." << std::endl;
+    while (!stopRequested) {
+        // every frame gets its id at capture, all stages are traced with it
+        points.sequence = trace::nextFrame();
+        {
+            trace::scope span(points.sequence, trace::decode);
+            if (prefetch != NULL && !prefetch->next(img))
+                break;
+        }
+        const auto vectorizeStart = clock::now();
+        generateFrame(img, parameters, tuning.latest(), drawing, compositing, frameCache, cachedVersion, houghLines, points, display);
+        const auto vectorized = clock::now() - vectorizeStart;
+        statsVectorize += std::chrono::duration<double>(vectorized).count();
+        if (vectorized > period)
+            vectorizeMisses++;
+        ticker.render(std::chrono::duration<double>(clock::now() - start).count(), points);
+        devices.present(points);
+        if (parameters.trace)
+            trace::collect();
+        frames++;
+        statsFrames++;
+        statsPoints += points.size();
+
+        const auto now = clock::now();
+        if (now - statsStart >= statsInterval) {
+            const double seconds = std::chrono::duration<double>(now - statsStart).count();
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(1) << "[" << std::chrono::duration<double>(now - start).count() << " s] "
+                 << statsFrames / seconds << " FPS, vectorize " << 1000 * statsVectorize / statsFrames << " ms, "
+                 << statsPoints / statsFrames << " points";
+            if (prefetch != NULL)
+                line << ", input: dropped " << prefetch->getDropped() << ", late " << prefetch->getLate();
+            if (frameCache != NULL)
+                line << ", cache: " << frameCache->getHits() << " hits, " << frameCache->getMisses() << " misses";
+            line << ", deadline misses: vectorize " << vectorizeMisses << ", output " << devices.getDeadlineMisses();
+            if (parameters.trace) {
+                trace::percentiles p = trace::getLatency();
+                line << ", capture to laser p50 " << p.p50 << " ms, p95 " << p.p95 << " ms";
+            }
+            std::cout << line.str() << std::endl;
+            statsStart = now;
+            statsFrames = 0;
+            statsPoints = 0;
+            statsVectorize = 0;
+        }
+
+        // the frame rate cap replaces the vsync of the window, late frames do not
+        // make the following ones come in a burst
+        if (!parameters.benchmark) {
+            due = std::max(due + period, now);
+            std::this_thread::sleep_until(due);
+        }
+    }
+    return frames;
 }
 
 int getParameters(int argc, char* argv[], Parameters& parameters) {
@@ -443,23 +665,14 @@ int getParameters(int argc, char* argv[], Parameters& parameters) {
     std::cout << "Input file: " << parameters.inputFile << std::endl;
 
     // determine input type
-    parameters.inputtype = InputType::image;
-    if (parameters.inputFile == "camera") {
-        parameters.inputtype = InputType::camera;
-    } else {
-        std::string suffix = parameters.inputFile.substr(parameters.inputFile.size() - 3);
-        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
-        if (suffix == "png" || suffix == "jpg" || suffix == "jpeg") {
-            parameters.inputtype = InputType::image;
-            std::cout << "Input type: image" << std::endl;
-        } else if (suffix == "mp4") {
-            parameters.inputtype = InputType::video;
-            std::cout << "Input type: video" << std::endl;
-        } else {
-            std::cerr << "Error: Data type unknown." << std::endl;
-            usage(argv);
-        }
+    if (!input::getInputType(parameters.inputFile, parameters.inputtype)) {
+        std::cerr << "Error: Data type unknown." << std::endl;
+        usage(argv);
     }
+    // shm or shm:/name
+    if (parameters.inputtype == InputType::sharedmemory && parameters.inputFile.size() > 4)
+        parameters.shmName = parameters.inputFile.substr(4);
+    std::cout << "Input type: " << input::inputTypeName(parameters.inputtype) << std::endl;
 
     // read max FPS
     if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-f")) {
@@ -504,93 +717,149 @@ int getParameters(int argc, char* argv[], Parameters& parameters) {
         }
     }
 
-    // read openCV parameters from config file
+    // offline compilation
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-o")) {
+        parameters.compileFile = sdl::auxiliary::commandLineParser::readCmdNormalized(argv, argv + argc, "-o");
+    }
+
+    // offline tuning of the vectorizer
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-a")) {
+        parameters.autotune = true;
+    }
+
+    // recording of the output
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-r")) {
+        parameters.recordFile = sdl::auxiliary::commandLineParser::readCmdNormalized(argv, argv + argc, "-r");
+    }
+
+    // output backend
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-d")) {
+        parameters.outputBackend = sdl::auxiliary::commandLineParser::readCmdNormalized(argv, argv + argc, "-d");
+    } else {
+        try {
+            root["output"].lookupValue("backend", parameters.outputBackend);
+        } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+    }
+    std::cout << "Output backend: " << parameters.outputBackend << std::endl;
+
+    // save the input frames
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-s")) {
+        parameters.saveInputFile = sdl::auxiliary::commandLineParser::readCmdNormalized(argv, argv + argc, "-s");
+    }
+
+    // run as fast as possible
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-b")) {
+        parameters.benchmark = true;
+        std::cout << "Benchmark: no frame rate cap and no video pacing." << std::endl;
+    }
+
+    // no window
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-n")) {
+        parameters.headless = true;
+        std::cout << "Headless: no window." << std::endl;
+    }
     try {
-        const libconfig::Setting& opencv = root["application"]["opencv"];
-        opencv.lookupValue("fillShortBlanks", parameters.fillShortBlanks);
-        opencv.lookupValue("lightThreshold", parameters.lightThreshold);
-        opencv.lookupValue("interThreshold", parameters.interThreshold);
-        opencv.lookupValue("minLineLength", parameters.minLineLength);
-        opencv.lookupValue("maxLineGap", parameters.maxLineGap);
-        opencv.lookupValue("blursize", parameters.blursize);
-        opencv.lookupValue("upperThreshold", parameters.upperThreshold);
-        opencv.lookupValue("lowerThreshold", parameters.lowerThreshold);
-        opencv.lookupValue("rResolution", parameters.rResolution);
-        opencv.lookupValue("thetaResolution", parameters.thetaResolution);
-        opencv.lookupValue("colorBoost", parameters.colorBoost);
+        root["application"]["headless"].lookupValue("statsInterval", parameters.statsInterval);
     } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
 
-    return 0;
-}
+    // tracing
+    try {
+        const libconfig::Setting& tracesettings = root["application"]["trace"];
+        tracesettings.lookupValue("enabled", parameters.trace);
+        tracesettings.lookupValue("file", parameters.traceFile);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+    if (sdl::auxiliary::commandLineParser::cmdOptionExists(argv, argv + argc, "-t")) {
+        parameters.trace = true;
+        parameters.traceFile = sdl::auxiliary::commandLineParser::readCmdNormalized(argv, argv + argc, "-t");
+    }
 
-#ifdef LUMAX_OUTPUT
-int getLumaxParameters(const libconfig::Config& config, renderer::lumaxParameters& parameters) {
-    const libconfig::Setting& root = config.getRoot();
+    // read openCV parameters from config file
     try {
-        libconfig::Setting& colorCorrection = root["lumax"]["color-correction"];
-        colorCorrection.lookupValue("ar", parameters.colorCorr.ar);
-        colorCorrection.lookupValue("br", parameters.colorCorr.br);
-        colorCorrection.lookupValue("cr", parameters.colorCorr.cr);
-        colorCorrection.lookupValue("ag", parameters.colorCorr.ag);
-        colorCorrection.lookupValue("bg", parameters.colorCorr.bg);
-        colorCorrection.lookupValue("cg", parameters.colorCorr.cg);
-        colorCorrection.lookupValue("ab", parameters.colorCorr.ab);
-        colorCorrection.lookupValue("bb", parameters.colorCorr.bb);
-        colorCorrection.lookupValue("cb", parameters.colorCorr.cb);
-        std::cout << "Color correction coefficients:" << std::endl;
-        std::cout << "ar = " << parameters.colorCorr.ar;
-        std::cout << ", br = " << parameters.colorCorr.br;
-        std::cout << ", cr = " << parameters.colorCorr.cr << std::endl;
-        std::cout << "ag = " << parameters.colorCorr.ag;
-        std::cout << ", bg = " << parameters.colorCorr.bg;
-        std::cout << ", cg = " << parameters.colorCorr.cg << std::endl;
-        std::cout << "ab = " << parameters.colorCorr.ab;
-        std::cout << ", bb = " << parameters.colorCorr.bb;
-        std::cout <<  ", cb = " << parameters.colorCorr.cb << std::endl;
+        vectorizer::getParameters(root["application"]["opencv"], parameters);
     } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
 
+    // read input parameters from config file
     try {
-        const libconfig::Setting& layout = root["lumax"]["layout"];
-        layout.lookupValue("mirrorFactX", parameters.mirrorFactX);
-        layout.lookupValue("mirrorFactY", parameters.mirrorFactY);
-        layout.lookupValue("scalingX", parameters.scalingX);
-        layout.lookupValue("scalingY", parameters.scalingY);
-        layout.lookupValue("swapXY", parameters.swapXY);
-        
+        const libconfig::Setting& inputsettings = root["application"]["input"];
+        inputsettings.lookupValue("prefetch", parameters.prefetchDepth);
+        inputsettings.lookupValue("sequenceFPS", parameters.sequenceFPS);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+    try {
+        const libconfig::Setting& shmsettings = root["application"]["input"]["shm"];
+        if (parameters.inputFile.find(':') == std::string::npos)
+            shmsettings.lookupValue("name", parameters.shmName);
+        shmsettings.lookupValue("slots", parameters.shmSlots);
+        shmsettings.lookupValue("slotSize", parameters.shmSlotSize);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+    try {
+        const libconfig::Setting& screensettings = root["application"]["input"]["screen"];
+        screensettings.lookupValue("display", parameters.screenDisplay);
+        screensettings.lookupValue("x", parameters.screenArea[0]);
+        screensettings.lookupValue("y", parameters.screenArea[1]);
+        screensettings.lookupValue("width", parameters.screenArea[2]);
+        screensettings.lookupValue("height", parameters.screenArea[3]);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+
+    // read SVG parameters from config file
+    try {
+        const libconfig::Setting& svgsettings = root["application"]["svg"];
+        svgsettings.lookupValue("tolerance", parameters.svgTolerance);
+        svgsettings.lookupValue("resolution", parameters.svgResolution);
     } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
 
     return 0;
 }
-#endif
 
 int main(int argc, char* argv[]) {
     Parameters parameters;
     getParameters(argc, argv, parameters);
 
-#ifdef LUMAX_OUTPUT
-    // open Lumax device
-    int NumOfCards = Lumax_GetPhysicalDevices();
-    void* lumaxHandle = NULL;
-    std::cout << "Number of MiniLumax devices: " <<  NumOfCards << std::endl;
-    if (NumOfCards > 0) {
-        lumaxHandle = Lumax_OpenDevice(1, 0);
-        std::cout << "Lumax_OpenDevice returned handle: 0x" << std::hex << (unsigned long)lumaxHandle << std::endl;
-        if (lumaxHandle == NULL) {
-            std::cerr << "I/O Error while opening the Lumax device." << std::endl;
-            SDL_Quit();
-            return 1;
-        }
+    // pre-produced shows: vectorize all frames on all cores, no window and no devices
+    if (parameters.compileFile != std::string())
+        return compiler::compileVideo(parameters, parameters.compileFile) == 0 ? 0 : 1;
+    // the same for the search of the best parameters
+    if (parameters.autotune)
+        return autotune::tune(parameters) == 0 ? 0 : 1;
+
+    trace::enable(parameters.trace);
+    // before any other thread is started, they all inherit the worker CPUs. The output
+    // threads move to their own CPUs.
+    realtime::realtimeParameters scheduling;
+    realtime::getRealtimeParameters(parameters.config, scheduling);
+    realtime::pinThread(scheduling.workerCPUs);
+    if (scheduling.opencvThreads > 0)
+        cv::setNumThreads(scheduling.opencvThreads);
+    signalWatcher signals;
+
+    // open the output devices, every device gets its own output thread
+    output::deviceGroup devices;
+    if (output::createDeviceGroup(parameters.outputBackend, parameters.config, devices) != 0) {
+        SDL_Quit();
+        return 1;
     }
+    devices.setRealtime(scheduling);
+
+    // record what is sent to the scanners, in the background
+    output::recorderParameters recording;
+    output::getRecorderParameters(parameters.config, recording);
+    if (parameters.recordFile != std::string()) {
+        recording.enabled = true;
+        recording.file = parameters.recordFile;
+    }
+    if (recording.enabled)
+        devices.enableRecording(recording);
 
-    // declare the lumax renderer
-    renderer::lumaxRenderer lumaxRenderer;
-    getLumaxParameters(parameters.config, lumaxRenderer.parameters);
+#ifdef LUMAX_OUTPUT
+    // color calibration is done with the first device
+    output::lumaxBackend* lumax = NULL;
+    if (devices.size() > 0)
+        lumax = dynamic_cast<output::lumaxBackend*>(&devices.getDevice(0));
 #endif
 
     // take records of frame number
     int frame = 0;
     // Framecap an oder ausschalten
-    bool cap = true;
+    bool cap = !parameters.benchmark;
 
     // Timer zum Festlegen der FPS
     sdl::auxiliary::timer fps;
@@ -601,39 +870,96 @@ int main(int argc, char* argv[]) {
     // initialize random generator
     sdl::auxiliary::utilities::seed(time(NULL));
 
-    // Initialize SDL_ttf
-    if (TTF_Init() != 0) {
-        std::cerr << "Error in TTF_Init: " << SDL_GetError() << std::endl;
-        return -1;
+    // precompiled shows are mapped, not decoded
+    ilda::reader ildaFile;
+    if (parameters.inputtype == precompiled && ildaFile.open(parameters.inputFile) != 0) {
+        SDL_Quit();
+        return 1;
     }
 
-    // Start up SDL and make sure it went ok
-    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
-        std::cerr << "Error in SDL_Init: " << SDL_GetError() << std::endl;
-        return -1;
+    // all raster inputs are decoded and cropped in the background
+    std::unique_ptr<input::prefetcher> prefetch;
+    if (parameters.inputtype != precompiled && parameters.inputtype != vectorgraphic && parameters.inputtype != composite) {
+        std::unique_ptr<input::source> src = input::createSource(parameters);
+        if (!src) {
+            SDL_Quit();
+            return 1;
+        }
+        // videos play at their own frame rate, unless benchmarking
+        prefetch.reset(new input::prefetcher(std::move(src), parameters.crop, parameters.prefetchDepth, true, !parameters.benchmark));
+        if (parameters.saveInputFile != std::string() && prefetch->record(parameters.saveInputFile) != 0) {
+            SDL_Quit();
+            return 1;
+        }
+        prefetch->start();
+        signals.watch(prefetch.get());
+    }
+
+    // the vectorizer parameters as immutable snapshots, a new one for every change by the keys
+    snapshot::publisher<vectorizerParameters> tuning(parameters);
+
+    // looping media are vectorized once, later loops are served from the cache. Only
+    // for a known, finite number of frames: live inputs never repeat a frame and
+    // would only pay for the hashing.
+    framecache::cacheParameters caching;
+    framecache::getCacheParameters(parameters.config, caching);
+    std::unique_ptr<framecache::cache> frameCache;
+    uint64_t cachedVersion = 0;
+    if (prefetch && caching.enabled && !prefetch->getSource().isLive() && prefetch->getSource().getFrameCount() > 0) {
+        frameCache.reset(new framecache::cache(caching));
     }
-    
-    // initialize video or camera input
-    cv::VideoCapture capture = cv::VideoCapture();
-    if (parameters.inputtype == camera) {
-        // open the default camera
-        capture.open(0);
-    } else if (parameters.inputtype == video) {
-        // open video file
-        capture.open(parameters.inputFile);
-    }
-    if (parameters.inputtype == video || parameters.inputtype == camera) {
-        if (!capture.isOpened()) {
-            std::cerr << "Error while opening the video device." << std::endl;
+
+    // vector graphics are flattened and ordered once, every frame shows the same points
+    laser::frame drawing;
+    if (parameters.inputtype == vectorgraphic) {
+        svg::document doc;
+        if (svg::load(parameters.inputFile, parameters.svgTolerance, parameters.svgResolution, doc) != 0) {
             SDL_Quit();
             return 1;
         }
+        svg::generatePoints(doc, drawing);
     }
 
+    // several inputs, each vectorized by its own worker, merged into one frame
+    std::unique_ptr<compositor::compositor> compositing;
+    if (parameters.inputtype == composite) {
+        compositor::compositorParameters composing;
+        if (compositor::getCompositorParameters(parameters, composing) != 0) {
+            SDL_Quit();
+            return 1;
+        }
+        compositing.reset(new compositor::compositor(parameters, composing, &tuning));
+        if (compositing->start() != 0) {
+            SDL_Quit();
+            return 1;
+        }
+    }
+
+    // text scrolling over the frames, drawn with the stroke font
+    strokefont::font laserFont;
+    strokefont::tickerParameters ticking;
+    strokefont::getTickerParameters(parameters.config, ticking);
+    strokefont::ticker ticker(laserFont, ticking);
+
     // read image for the first time to get its dimensions
-    cv::Mat img = readInputSource(parameters.inputFile, capture, parameters.inputtype, parameters.crop);
+    cv::Mat img;
+    if (prefetch && !prefetch->next(img)) {
+        std::cerr << "Error: the input has no frames." << std::endl;
+        SDL_Quit();
+        return 1;
+    }
+    if (parameters.inputtype == vectorgraphic || compositing) {
+        // black background of the preview, at most 900 pixels wide
+        const int width = compositing ? compositing->getWidth() : drawing.width;
+        const int height = compositing ? compositing->getHeight() : drawing.height;
+        const float previewScale = std::min(1.0f, 900.0f / std::max(width, height));
+        img = cv::Mat(std::max(1, static_cast<int>(height * previewScale)), std::max(1, static_cast<int>(width * previewScale)), CV_8UC3, cv::Scalar(0, 0, 0));
+    }
     // sets the global variabls renderer::screen_width and renderer::screen_height
-    if (parameters.width == 0 && parameters.height == 0) {
+    if (parameters.width == 0 && parameters.height == 0 && parameters.inputtype == precompiled) {
+        // ILDA frames have no pixel dimensions
+        renderer::setDimensions(600, 600);
+    } else if (parameters.width == 0 && parameters.height == 0) {
         // use the original dimensions
         renderer::setDimensions(img.cols, img.rows);
     } else {
@@ -641,167 +967,129 @@ int main(int argc, char* argv[]) {
         renderer::setDimensions(parameters.width, parameters.height);
     }
 
-    // Set up our window and renderer, this time let's put our window in the center of the screen
-    SDL_Window *window = SDL_CreateWindow("Laser-Display", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, renderer::screen_width, renderer::screen_height, SDL_WINDOW_SHOWN);
-    if (window == NULL) {
-        std::cerr << "Error in SDL_CreateWindow: " << SDL_GetError() << std::endl;
-        SDL_Quit();
-        return -1;
-    }
+    // the window, none in headless mode
+    SDL_Window* window = NULL;
+    SDL_Renderer* renderer = NULL;
+    SDL_Texture* texture = NULL;
+    TTF_Font* font = NULL;
+    SDL_Color textColor = {0, 255, 0};
+    if (!parameters.headless) {
+        // Initialize SDL_ttf
+        if (TTF_Init() != 0) {
+            std::cerr << "Error in TTF_Init: " << SDL_GetError() << std::endl;
+            return -1;
+        }
 
-    // load the SDL renderer and set the screen dimensions
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (renderer == NULL) {
-        std::cerr << "Error in SDL_CreateRenderer: " << SDL_GetError() << std::endl;
-        sdl::auxiliary::utilities::cleanup(window);
-        SDL_Quit();
-        return -1;
-    }
+        // Start up SDL and make sure it went ok
+        if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+            std::cerr << "Error in SDL_Init: " << SDL_GetError() << std::endl;
+            return -1;
+        }
 
-    // create a texture for displaying images
-    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_BGR24, SDL_TEXTUREACCESS_STREAMING, img.cols, img.rows);
-    if (renderer == NULL) {
-        std::cerr << "Error in SDL_CreateTexture: " << SDL_GetError() << std::endl;
-        sdl::auxiliary::utilities::cleanup(window, renderer);
-        SDL_Quit();
-        return -1;
-    }
+        // Set up our window and renderer, this time let's put our window in the center of the screen
+        window = SDL_CreateWindow("Laser-Display", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, renderer::screen_width, renderer::screen_height, SDL_WINDOW_SHOWN);
+        if (window == NULL) {
+            std::cerr << "Error in SDL_CreateWindow: " << SDL_GetError() << std::endl;
+            SDL_Quit();
+            return -1;
+        }
 
-    // setup text rendering
-    TTF_Font* font = TTF_OpenFont("fonts/lazy.ttf", 16);
-    if (font == NULL) {
-        std::cerr << "Error in TTF_OpenFont: " << SDL_GetError() << std::endl;
-        sdl::auxiliary::utilities::cleanup(window, renderer, texture);
-        SDL_Quit();
-        return -1;
+        // load the SDL renderer and set the screen dimensions
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        if (renderer == NULL) {
+            std::cerr << "Error in SDL_CreateRenderer: " << SDL_GetError() << std::endl;
+            sdl::auxiliary::utilities::cleanup(window);
+            SDL_Quit();
+            return -1;
+        }
+
+        // create a texture for displaying images
+        texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_BGR24, SDL_TEXTUREACCESS_STREAMING, std::max(img.cols, 1), std::max(img.rows, 1));
+        if (renderer == NULL) {
+            std::cerr << "Error in SDL_CreateTexture: " << SDL_GetError() << std::endl;
+            sdl::auxiliary::utilities::cleanup(window, renderer);
+            SDL_Quit();
+            return -1;
+        }
+
+        // setup text rendering
+        font = TTF_OpenFont("fonts/lazy.ttf", 16);
+        if (font == NULL) {
+            std::cerr << "Error in TTF_OpenFont: " << SDL_GetError() << std::endl;
+            sdl::auxiliary::utilities::cleanup(window, renderer, texture);
+            SDL_Quit();
+            return -1;
+        }
     }
-    SDL_Color textColor = {0, 255, 0};
 
 #ifdef LUMAX_OUTPUT
     // before we start: do the color calibration routine
-    if (parameters.doColorCorrection == true)
-        colorCorrection(lumaxHandle, lumaxRenderer, renderer, font, parameters);
+    if (parameters.doColorCorrection == true && lumax != NULL && renderer != NULL)
+        colorCorrection(*lumax, renderer, font, parameters);
+    else if (parameters.doColorCorrection == true && parameters.headless)
+        std::cerr << "The color calibration needs the window, it is skipped in headless mode." << std::endl;
 #endif
+    devices.start();
+
+    // laser points of the current frame
+    laser::frame points(15000);
 
     // the event structure
     bool quit = false;
     bool pause = false;
     SDL_Event e;
-    while (!quit) {
+
+    const auto benchmarkStart = std::chrono::steady_clock::now();
+    uint64_t benchmarkFrames = 0;
+    // precompiled shows bypass the vectorization loop
+    if (parameters.inputtype == precompiled) {
+        playIlda(ildaFile, devices, renderer, font, textColor, parameters);
+        quit = true;
+    } else if (parameters.headless) {
+        benchmarkFrames = runHeadless(img, parameters, tuning, prefetch.get(), drawing, compositing.get(), frameCache.get(), cachedVersion, ticker, devices);
+        quit = true;
+    }
+    while (!quit && !stopRequested) {
         // start the fps timer
         fps.start();
 
         // read any events that occured, for now we'll just quit if any event occurs
         while (SDL_PollEvent(&e)) {
-            // if user closes the window
-            if (e.type == SDL_QUIT)
+            if (e.type == SDL_QUIT) {
+                // if user closes the window
                 quit = true;
-            // if user presses any key
-            else if (e.type == SDL_KEYDOWN)
+            } else if (e.type == SDL_KEYDOWN) {
+                // if user presses any key
                 if (e.key.keysym.sym == SDLK_c)
                     cap = !cap;
-                if (e.key.keysym.sym == SDLK_SPACE)
+                if (e.key.keysym.sym == SDLK_SPACE) {
                     pause = !pause;
+                    if (prefetch)
+                        prefetch->setPause(pause);
+                }
+                if (e.key.keysym.sym == SDLK_x && parameters.trace)
+                    trace::writeChromeTrace(parameters.traceFile);
+            }
         }
 
-        handleKeyPress(parameters);
-
-#ifdef MEASURETIME
-        // measure time
-        auto start_time = std::chrono::high_resolution_clock::now();
-#endif
-
-        if (!pause) {
-            img = readInputSource(parameters.inputFile, capture, parameters.inputtype, parameters.crop);
-        }
-#if OCVSTEP == 0
-        cv::Mat display = img.clone();
-#endif
-
-// TODO: test if HSV threshold may improve object detection
-#if 0
-        // HSV threshold detection
-        // Convert from BGR to HSV colorspace
-        cv::Mat imgHSV;
-        cv::cvtColor(img, imgHSV, cv::COLOR_BGR2HSV);
-        // Detect the object based on HSV Range Values
-        cv::Mat img_threshold;
-        int max_value = 255;
-        int max_value_H = 360/2;
-        int low_H = 0;
-        int low_S = 0;
-        int low_V = 0;
-        int high_H = max_value_H;
-        int high_S = max_value;
-        int high_V = max_value;
-        cv::inRange(imgHSV, cv::Scalar(low_H, low_S, low_V), cv::Scalar(high_H, high_S, high_V), img_threshold);
-#if OCVSTEP == 1
-        cv::Mat display = img_threshold.clone();
-        //cv::cvtColor(display, display, cv::COLOR_HSV2BGR);
-#endif
-#endif
-
-        // Blur the image for better edge detection
-        cv::Mat img_blur;
-        cv::GaussianBlur(img, img_blur, cv::Size(parameters.blursize, parameters.blursize), 0);
-#if OCVSTEP == 2
-        cv::Mat display = img_blur.clone();
-#endif
-
-        // Convert to graycsale
-        cv::Mat img_gray;
-        cv::cvtColor(img_blur, img_gray, cv::COLOR_BGR2GRAY);
-#if OCVSTEP == 3
-        cv::Mat display = img_gray.clone();
-        // convert to original color space, preserving content
-        cv::cvtColor(display, display, cv::COLOR_GRAY2RGB);
-#endif
-
-        // Canny edge detection
-        cv::Mat edges;
-        cv::Canny(img_gray, edges, parameters.lowerThreshold, parameters.upperThreshold, 3, false);
-#if OCVSTEP == 4
-        cv::Mat display = edges.clone();
-        // convert to original color space, preserving content
-        cv::cvtColor(display, display, cv::COLOR_GRAY2RGB);
-#endif
-
-        // dilate the lines (thicken)
-        int dilationSize = 1;
-        int erosionType = cv::MORPH_ELLIPSE; // MORPH_RECT, MORPH_CROSS, MORPH_ELLIPSE
-        cv::Mat element = cv::getStructuringElement(erosionType, cv::Size(2*dilationSize + 1, 2*dilationSize+1), cv::Point(dilationSize, dilationSize));
-        cv::dilate(edges, edges, element);
-#if OCVSTEP == 5
-        cv::Mat display = edges.clone();
-        // convert to original color space, preserving content
-        cv::cvtColor(display, display, cv::COLOR_GRAY2RGB);
-#endif
-
+        // the keys change the parameters in place, the pipeline only sees published snapshots
+        if (handleKeyPress(parameters))
+            tuning.publish(parameters);
 
-        // probabilistic Hough Line Transform
-        std::vector<cv::Vec4i> houghLines; // HoughLinesP: will hold the results of the detection
-        HoughLinesP(edges, houghLines, parameters.rResolution, parameters.thetaResolution, parameters.interThreshold, parameters.minLineLength, parameters.maxLineGap);
-        // sort the lines (TSP problem)
-        sort::sortLines(houghLines);
-
-        // Draw the lines
-        cv::Mat lines = edges.clone(); // copy to have a matrix with the right size
-        lines.setTo(cv::Scalar(0, 0, 0));
-        for(size_t i = 0; i < houghLines.size(); ++i) {
-            cv::Vec4i l = houghLines[i];
-            cv::line(lines, cv::Point(l[0], l[1]), cv::Point(l[2], l[3]), cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+        // every frame gets its id at capture, all stages are traced with it
+        points.sequence = trace::nextFrame();
+        {
+            trace::scope span(points.sequence, trace::decode);
+            // waits only if the decoder is behind
+            if (!pause && prefetch && !prefetch->next(img))
+                quit = true;
         }
-        // convert to original color space, preserving content
-        cv::cvtColor(lines, lines, cv::COLOR_GRAY2RGB);
-#if OCVSTEP == 6
-        cv::Mat display = lines.clone();
-#endif
+        // find the lines and generate the laser points
+        std::vector<cv::Vec4i> houghLines;
+        cv::Mat display;
+        generateFrame(img, parameters, tuning.latest(), drawing, compositing.get(), frameCache.get(), cachedVersion, houghLines, points, display);
+        ticker.render(std::chrono::duration<double>(std::chrono::steady_clock::now() - benchmarkStart).count(), points);
 
-        // use lines as mask and multiply original image with mask
-        cv::bitwise_and(img, lines, lines);
-#if OCVSTEP == 7
-        cv::Mat display = lines.clone();
-#endif
         // Draw the background black
         SDL_RenderClear(renderer);
         boxRGBA(renderer, 0, 0, renderer::screen_width, renderer::screen_height, 10, 10, 10, 255);
@@ -815,73 +1103,20 @@ int main(int argc, char* argv[]) {
         //SDL_RenderCopyEx(renderer, texture, NULL, &destRect, 0, NULL, SDL_FLIP_NONE);
 #endif
 
-        // apply the lines to the renderers
-        std::vector<types::point<float>> points;
-        points.reserve(15000); // TODO
-        int lastLaser[2] = {renderer::screen_width / 2, renderer::screen_height / 2};
-        int lastSDL[2] = {renderer::screen_width / 2, renderer::screen_height / 2};
-        for(size_t i = 0; i < houghLines.size(); ++i) {
-            cv::Vec4i l = houghLines[i];
-            cv::Vec3b intensity1 = lines.at<cv::Vec3b>(cv::Point(algorithms::constrain<int>(l[0], 0, lines.cols - 1), algorithms::constrain<int>(l[1], 0, lines.rows - 1)));
-            cv::Vec3b intensity2 = lines.at<cv::Vec3b>(cv::Point(algorithms::constrain<int>(l[2], 0, lines.cols - 1), algorithms::constrain<int>(l[3], 0, lines.rows - 1)));
-            
-            int blue  = algorithms::constrain<int>((intensity1.val[0] + intensity2.val[0]) / 2, 0, 255);
-            int green = algorithms::constrain<int>((intensity1.val[1] + intensity2.val[1]) / 2, 0, 255);
-            int red   = algorithms::constrain<int>((intensity1.val[2] + intensity2.val[2]) / 2, 0, 255);
-
-            // sort out dark lines
-            if ((blue + green + red) >= parameters.lightThreshold) {
-                // color boost
-                if (parameters.colorBoost) {
-                    float colorFactor = 255 / std::max(blue, std::max(green, red));
-                    blue  *= colorFactor;
-                    green *= colorFactor;
-                    red   *= colorFactor;
-                }
-
-                // Points for Laser output
-                if (std::sqrt(distanceSq(types::xypoint<int>({l[0], l[1]}), types::xypoint<int>({lastLaser[0], lastLaser[1]}))) > parameters.fillShortBlanks) {
-                    // blank move
-                    points.push_back({(float)lastLaser[0], (float)lastLaser[1], 0, 0, 0, 255, false});
-                    points.push_back({(float)l[0], (float)l[1], 0, 0, 0, 255, false});
-                }
-                // laser line
-                points.push_back({(float)l[0], (float)l[1], blue, green, red, 255, false});
-                points.push_back({(float)l[2], (float)l[3], blue, green, red, 255, false});
-                // store the last laser point
-                lastLaser[0] = l[2];
-                lastLaser[1] = l[3];
-
-                // Points for SDL output: Transform from original image dimensions to dimensions of the renderer's screen
-                l[0] = renderer::transform(l[0], 0, img.cols, 0, renderer::screen_width);
-                l[1] = renderer::transform(l[1], 0, img.rows, 0, renderer::screen_height);
-                l[2] = renderer::transform(l[2], 0, img.cols, 0, renderer::screen_width);
-                l[3] = renderer::transform(l[3], 0, img.rows, 0, renderer::screen_height);
-                // TODO: fillShortBlanks should be different in the SDL renderer context
-                if (std::sqrt(distanceSq(types::xypoint<int>({l[0], l[1]}), types::xypoint<int>({lastSDL[0], lastSDL[1]}))) <= parameters.fillShortBlanks)
-                    lineRGBA(renderer, lastSDL[0], lastSDL[1], (int)l[0], (int)l[1], red, green, blue, 255);
-                else if (parameters.blankMoves)
-                    lineRGBA(renderer, lastSDL[0], lastSDL[1], (int)l[0], (int)l[1], 0, 255, 255, 255); // blank move
-                lineRGBA(renderer, (int)l[0], (int)l[1], (int)l[2], (int)l[3], red, green, blue, 255);
-                // store the last SDL point
-                lastSDL[0] = l[2];
-                lastSDL[1] = l[3];
-            }
+        // SDL output: Transform from original image dimensions to dimensions of the renderer's screen
+        for (size_t i = 1; i < points.size(); ++i) {
+            int x1 = renderer::transform((int)points.x[i - 1], 0, points.width, 0, renderer::screen_width);
+            int y1 = renderer::transform((int)points.y[i - 1], 0, points.height, 0, renderer::screen_height);
+            int x2 = renderer::transform((int)points.x[i], 0, points.width, 0, renderer::screen_width);
+            int y2 = renderer::transform((int)points.y[i], 0, points.height, 0, renderer::screen_height);
+            if (!points.isBlank(i))
+                lineRGBA(renderer, x1, y1, x2, y2, points.r[i], points.g[i], points.b[i], 255);
+            else if (parameters.blankMoves)
+                lineRGBA(renderer, x1, y1, x2, y2, 0, 255, 255, 255); // blank move
         }
 
-#ifdef LUMAX_OUTPUT
-        renderer::drawPoints(points, lumaxRenderer);
-        renderer::sendPointsToLumax(lumaxHandle, lumaxRenderer, 20000);
-#endif
-        
-#ifdef MEASURETIME
-        // measure time
-        auto end_time = std::chrono::high_resolution_clock::now();
-        auto time = end_time - start_time;
-        std::cout << "Extracted " << houghLines.size() << " lines and ";
-        std::cout << "generated " << points.size() << " points. ";
-        std::cout << "Took " << time/std::chrono::milliseconds(1) << "ms to run.\n";
-#endif
+        // laser output
+        devices.present(points);
 
         // build text for displaying values
         std::string str = "FPS: " +  algorithms::typeToStr<int>(1000.0f * frame / worldtime.getTicks());
@@ -902,6 +1137,21 @@ int main(int argc, char* argv[]) {
         sdl::auxiliary::utilities::renderText(str, font, textColor, renderer, 25, 200);
         str = "(o+, l-): Edge Detection: Lower threshold = " + algorithms::typeToStr<int>(parameters.lowerThreshold);
         sdl::auxiliary::utilities::renderText(str, font, textColor, renderer, 25, 225);
+        str = "Lines: " + algorithms::typeToStr<size_t>(houghLines.size()) + ", points: " + algorithms::typeToStr<size_t>(points.size());
+        sdl::auxiliary::utilities::renderText(str, font, textColor, renderer, 25, 250);
+        if (prefetch) {
+            str = "Input: dropped " + algorithms::typeToStr<uint64_t>(prefetch->getDropped()) + ", late " + algorithms::typeToStr<uint64_t>(prefetch->getLate());
+            str += prefetch->isPaced() ? " (paced)" : "";
+            if (frameCache) {
+                str += ", cache: " + algorithms::typeToStr<uint64_t>(frameCache->getHits()) + " hits, " + algorithms::typeToStr<uint64_t>(frameCache->getMisses());
+                str += " misses, " + algorithms::typeToStr<size_t>(frameCache->getBytes() >> 20) + " MB";
+            }
+            sdl::auxiliary::utilities::renderText(str, font, textColor, renderer, 25, 275);
+        }
+        if (parameters.trace) {
+            trace::collect();
+            renderTrace(font, textColor, renderer, 25, 300);
+        }
 
        // FPS
         if (worldtime.getTicks() > 1000 ) {
@@ -914,21 +1164,43 @@ int main(int argc, char* argv[]) {
 
         // increment the frame number
         frame++;
+        benchmarkFrames++;
         // apply the fps cap
         if ((cap == true) && (fps.getTicks() < 1000 / parameters.maxFramesPerSecond) ) {
             SDL_Delay((1000 / parameters.maxFramesPerSecond) - fps.getTicks() );
         }
     }
 
-#ifdef LUMAX_OUTPUT
-    Lumax_StopFrame(lumaxHandle);
-    Lumax_CloseDevice(lumaxHandle);
-#endif
+    if (prefetch) {
+        signals.watch(NULL);
+        prefetch->stop();
+        std::cout << "Input: " << prefetch->getDropped() << " frames dropped, " << prefetch->getLate() << " late." << std::endl;
+    }
+    if (compositing) {
+        compositing->stop();
+        compositing->printStatistics(std::cout);
+    }
+    if (frameCache)
+        frameCache->printStatistics(std::cout);
+    if (parameters.benchmark && benchmarkFrames > 0) {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - benchmarkStart).count();
+        std::cout << "Benchmark: " << benchmarkFrames << " frames in " << seconds << " s, " << benchmarkFrames / seconds << " FPS." << std::endl;
+    }
+    devices.stop();
+    devices.printStatistics(std::cout);
+    if (parameters.trace) {
+        trace::collect();
+        trace::writeChromeTrace(parameters.traceFile);
+    }
+    for (size_t i = 0; i < devices.size(); ++i)
+        devices.getDevice(i).close();
 
     // Destroy the various items
-    sdl::auxiliary::utilities::cleanup(renderer, window, texture);
-    TTF_CloseFont(font);
-    SDL_Quit();
+    if (!parameters.headless) {
+        sdl::auxiliary::utilities::cleanup(renderer, window, texture);
+        TTF_CloseFont(font);
+        SDL_Quit();
+    }
 
     return 0;
 }
@@ -0,0 +1,216 @@
+#include "src/autotune.h"
+
+#include <opencv2/imgproc.hpp>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "src/vectorizer.h"
+#include "src/input.h"
+
+namespace autotune {
+
+namespace {
+    // the parameters the keys W/S, E/D, ... change and the tuner searches
+    vectorizerParameters randomConfiguration(const vectorizerParameters& base, std::mt19937& random) {
+        vectorizerParameters p = base;
+        p.blursize = 2 * std::uniform_int_distribution<int>(0, 12)(random) + 1;
+        p.upperThreshold = std::uniform_int_distribution<int>(10, 150)(random);
+        p.lowerThreshold = std::uniform_int_distribution<int>(1, p.upperThreshold - 1)(random);
+        p.interThreshold = std::uniform_int_distribution<int>(2, 60)(random);
+        p.minLineLength = std::uniform_int_distribution<int>(0, 30)(random);
+        p.maxLineGap = std::uniform_int_distribution<int>(0, 20)(random);
+        return p;
+    }
+
+    score evaluate(const vectorizerParameters& p, const std::vector<cv::Mat>& frames, const std::vector<cv::Mat>& references, int tolerance) {
+        typedef std::chrono::steady_clock clock;
+        score s;
+        s.parameters = p;
+        std::vector<cv::Vec4i> houghLines;
+        laser::frame points;
+        cv::Mat display;
+        for (size_t i = 0; i < frames.size(); ++i) {
+            const auto start = clock::now();
+            vectorizer::vectorize(frames[i], p, houghLines, points, display);
+            s.time += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            s.points += points.size();
+            s.fidelity += fidelity(references[i], points, tolerance);
+        }
+        s.time /= frames.size();
+        s.points /= frames.size();
+        s.fidelity /= frames.size();
+        return s;
+    }
+
+    void print(const score& s) {
+        const vectorizerParameters& p = s.parameters;
+        std::cout << std::fixed << std::setprecision(2) << std::setw(9) << s.time << std::setw(9) << std::setprecision(0) << s.points
+                  << std::setw(9) << std::setprecision(3) << s.fidelity << "   blur " << p.blursize << ", canny " << p.lowerThreshold << "/"
+                  << p.upperThreshold << ", hough " << p.interThreshold << ", min length " << p.minLineLength << ", max gap " << p.maxLineGap << std::endl;
+    }
+
+    void set(libconfig::Setting& group, const char* name, int value) {
+        if (!group.exists(name))
+            group.add(name, libconfig::Setting::TypeInt);
+        group[name] = value;
+    }
+}
+
+cv::Mat referenceEdges(const cv::Mat& img) {
+    cv::Mat gray, edges;
+    if (img.channels() == 1)
+        gray = img;
+    else
+        cv::cvtColor(img, gray, img.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    cv::GaussianBlur(gray, gray, cv::Size(3, 3), 0);
+    cv::Canny(gray, edges, 50, 150);
+    return edges;
+}
+
+double fidelity(const cv::Mat& reference, const laser::frame& points, int tolerance) {
+    cv::Mat drawn = cv::Mat::zeros(reference.rows, reference.cols, CV_8U);
+    for (size_t i = 1; i < points.size(); ++i)
+        if (!points.isBlank(i))
+            cv::line(drawn, cv::Point(points.x[i - 1], points.y[i - 1]), cv::Point(points.x[i], points.y[i]), cv::Scalar(255));
+    const int edgePixels = cv::countNonZero(reference);
+    const int linePixels = cv::countNonZero(drawn);
+    if (edgePixels == 0 || linePixels == 0)
+        return edgePixels == linePixels ? 1 : 0;
+
+    const cv::Mat kernel = cv::getStructuringElement(cv::MORPH_ELLIPSE, cv::Size(2 * tolerance + 1, 2 * tolerance + 1));
+    cv::Mat nearLines, nearEdges, covered, onEdges;
+    cv::dilate(drawn, nearLines, kernel);
+    cv::dilate(reference, nearEdges, kernel);
+    cv::bitwise_and(reference, nearLines, covered);
+    cv::bitwise_and(drawn, nearEdges, onEdges);
+    const double recall = static_cast<double>(cv::countNonZero(covered)) / edgePixels;
+    const double precision = static_cast<double>(cv::countNonZero(onEdges)) / linePixels;
+    return recall + precision > 0 ? 2 * recall * precision / (recall + precision) : 0;
+}
+
+void getTuneParameters(const libconfig::Config& config, tuneParameters& parameters) {
+    const libconfig::Setting& root = config.getRoot();
+    try {
+        const libconfig::Setting& t = root["application"]["autotune"];
+        t.lookupValue("frames", parameters.frames);
+        t.lookupValue("samples", parameters.samples);
+        t.lookupValue("tolerance", parameters.tolerance);
+        t.lookupValue("minFidelity", parameters.minFidelity);
+        t.lookupValue("maxPoints", parameters.maxPoints);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+}
+
+int tune(Parameters& parameters, unsigned threads) {
+    if (parameters.inputtype != InputType::image && parameters.inputtype != InputType::video && parameters.inputtype != InputType::sequence
+        && parameters.inputtype != InputType::replay) {
+        std::cerr << "Error: only images, videos, image sequences and raw frames can be tuned on." << std::endl;
+        return -1;
+    }
+    tuneParameters t;
+    getTuneParameters(parameters.config, t);
+    std::unique_ptr<input::source> src = input::createSource(parameters);
+    if (!src)
+        return -1;
+
+    // frames spread over the whole input, with their reference edges
+    std::vector<cv::Mat> frames, references;
+    const size_t total = src->getFrameCount();
+    const size_t step = (total > static_cast<size_t>(t.frames) && t.frames > 0) ? total / t.frames : 1;
+    while (frames.size() < static_cast<size_t>(std::max(t.frames, 1))) {
+        cv::Mat img;
+        if (!src->read(img))
+            break;
+        frames.push_back(vectorizer::crop(img, parameters.crop).clone());
+        references.push_back(referenceEdges(frames.back()));
+        for (size_t i = 1; i < step; ++i)
+            src->skip();
+    }
+    if (frames.empty()) {
+        std::cerr << "Error: no frames to tune on in " << parameters.inputFile << "." << std::endl;
+        return -1;
+    }
+
+    // the current configuration first, so it is always scored
+    std::vector<vectorizerParameters> configurations(1, parameters);
+    std::mt19937 random(1);
+    for (int i = 0; i < t.samples; ++i)
+        configurations.push_back(randomConfiguration(parameters, random));
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Tuning on " << frames.size() << " frames of " << parameters.inputFile << ", " << configurations.size()
+              << " configurations with " << threads << " threads." << std::endl;
+
+    // every worker scores one configuration at a time, timed single threaded as in the
+    // compiler; OpenCV's own threads would only compete
+    const int cvThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+    std::vector<score> scores(configurations.size());
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            for (size_t k = next++; k < configurations.size(); k = next++)
+                scores[k] = evaluate(configurations[k], frames, references, t.tolerance);
+        });
+    }
+    for (auto& w : workers)
+        w.join();
+    cv::setNumThreads(cvThreads);
+
+    std::vector<score> front = paretoFront(scores);
+    std::sort(front.begin(), front.end(), [](const score& a, const score& b) { return a.time < b.time; });
+    std::cout << "Pareto front (" << front.size() << " of " << scores.size() << "):" << std::endl;
+    std::cout << "   [ms]   points fidelity" << std::endl;
+    for (const score& s : front)
+        print(s);
+    std::cout << "Current:" << std::endl;
+    print(scores[0]);
+
+    // the most fidelity per millisecond that is still faithful enough and fits the point budget
+    double bestFidelity = 0;
+    for (const score& s : front)
+        bestFidelity = std::max(bestFidelity, s.fidelity);
+    const score* chosen = NULL;
+    for (const score& s : front) {
+        if (s.fidelity < t.minFidelity * bestFidelity || s.points > t.maxPoints)
+            continue;
+        if (chosen == NULL || s.fidelity / std::max(s.time, 1e-3) > chosen->fidelity / std::max(chosen->time, 1e-3))
+            chosen = &s;
+    }
+    if (chosen == NULL) {
+        std::cerr << "No configuration keeps " << t.minFidelity << " of the best fidelity within " << t.maxPoints << " points, the configuration is not changed." << std::endl;
+        return -1;
+    }
+    std::cout << "Chosen:" << std::endl;
+    print(*chosen);
+
+    // write the profile back into the opencv section
+    const libconfig::Setting& root = parameters.config.getRoot();
+    if (!root.exists("application") || !root["application"].exists("opencv")) {
+        std::cerr << "Error: no application.opencv section in " << parameters.configFile << "." << std::endl;
+        return -1;
+    }
+    libconfig::Setting& opencv = root["application"]["opencv"];
+    set(opencv, "blursize", chosen->parameters.blursize);
+    set(opencv, "upperThreshold", chosen->parameters.upperThreshold);
+    set(opencv, "lowerThreshold", chosen->parameters.lowerThreshold);
+    set(opencv, "interThreshold", chosen->parameters.interThreshold);
+    set(opencv, "minLineLength", chosen->parameters.minLineLength);
+    set(opencv, "maxLineGap", chosen->parameters.maxLineGap);
+    try {
+        parameters.config.writeFile(parameters.configFile.c_str());
+    } catch(const libconfig::FileIOException &fioex) {
+        std::cerr << "I/O error while writing " << parameters.configFile << "." << std::endl;
+        return -1;
+    }
+    std::cout << "Written to the opencv section of " << parameters.configFile << "." << std::endl;
+    return 0;
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <libconfig.h++>
+
+#include "src/parameters.h"
+#include "src/pointframe.h"
+
+namespace autotune {
+    struct tuneParameters {
+        // frames taken evenly from the input
+        int frames = 16;
+        // random configurations tried besides the current one
+        int samples = 256;
+        // [px] an edge counts as covered by a line this close to it
+        int tolerance = 3;
+        // the chosen profile keeps at least this fraction of the best fidelity
+        float minFidelity = 0.8f;
+        // and at most this many points per frame
+        int maxPoints = 15000;
+    };
+
+    // one configuration, averaged over all frames
+    struct score {
+        vectorizerParameters parameters;
+        // [ms] per frame, single threaded
+        double time = 0;
+        double points = 0;
+        // edge coverage, see fidelity()
+        double fidelity = 0;
+    };
+
+    // a is at least as fast, as short and as faithful as b and better in one of them
+    inline bool dominates(const score& a, const score& b) {
+        return a.time <= b.time && a.points <= b.points && a.fidelity >= b.fidelity
+            && (a.time < b.time || a.points < b.points || a.fidelity > b.fidelity);
+    }
+
+    // the scores no other score dominates, in their order
+    inline std::vector<score> paretoFront(const std::vector<score>& scores) {
+        std::vector<score> front;
+        for (const score& s : scores) {
+            bool dominated = false;
+            for (const score& other : scores)
+                if (dominates(other, s)) {
+                    dominated = true;
+                    break;
+                }
+            if (!dominated)
+                front.push_back(s);
+        }
+        return front;
+    }
+
+    // edges of the image the vectorizer should find, independent of the tuned parameters
+    cv::Mat referenceEdges(const cv::Mat& img);
+    // F1 score of the reference edges covered by the lit lines of the points (pixel
+    // coordinates) and the lines that lie on reference edges, both within tolerance
+    double fidelity(const cv::Mat& reference, const laser::frame& points, int tolerance);
+
+    void getTuneParameters(const libconfig::Config& config, tuneParameters& parameters);
+
+    // vectorize frames of the input with many configurations on all cores, print the
+    // Pareto front of time, points and fidelity and write the chosen profile into the
+    // opencv section of the configuration file. threads = 0 uses all cores.
+    int tune(Parameters& parameters, unsigned threads = 0);
+}
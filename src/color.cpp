@@ -0,0 +1,129 @@
+#include "src/color.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace color {
+
+namespace {
+    uint8_t evaluate(float a, float b, float c, float gamma, int x) {
+        if (x == 0)
+            return 0;
+        float v = 255.0f * std::pow(x / 255.0f, gamma);
+        v = a * v * v + b * v + c;
+        return static_cast<uint8_t>(std::min(std::max(std::lround(v), 0L), 255L));
+    }
+
+    // reciprocals 255 / max in 16.16 fixed point, index 0 is never used
+    std::array<uint32_t, 256> makeBoostTable() {
+        std::array<uint32_t, 256> table;
+        table[0] = 0;
+        for (int i = 1; i < 256; ++i)
+            table[i] = static_cast<uint32_t>(std::lround(255.0 * 65536.0 / i));
+        return table;
+    }
+}
+
+lookupTable identityTable() {
+    lookupTable table;
+    for (int i = 0; i < 256; ++i)
+        table.r[i] = table.g[i] = table.b[i] = static_cast<uint8_t>(i);
+    return table;
+}
+
+lookupTable buildLookupTable(const correction& corr) {
+    lookupTable table;
+    for (int i = 0; i < 256; ++i) {
+        table.r[i] = evaluate(corr.ar, corr.br, corr.cr, corr.gamma, i);
+        table.g[i] = evaluate(corr.ag, corr.bg, corr.cg, corr.gamma, i);
+        table.b[i] = evaluate(corr.ab, corr.bb, corr.cb, corr.gamma, i);
+    }
+    return table;
+}
+
+namespace {
+    void applyPlane(const uint8_t* table, uint8_t* plane, size_t n) {
+        size_t i = 0;
+#ifdef __AVX2__
+        // gather 32 bit words starting at the table entries and keep the lowest byte
+        const __m256i mask = _mm256_set1_epi32(0xff);
+        for (; i + 8 <= n; i += 8) {
+            const __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(plane + i)));
+            __m256i v = _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(table), index, 1), mask);
+            // 8 x 32 bit -> 8 x 8 bit
+            v = _mm256_packus_epi32(v, v);
+            v = _mm256_packus_epi16(v, v);
+            const uint32_t lo = static_cast<uint32_t>(_mm256_extract_epi32(v, 0));
+            const uint32_t hi = static_cast<uint32_t>(_mm256_extract_epi32(v, 4));
+            std::memcpy(plane + i, &lo, 4);
+            std::memcpy(plane + i + 4, &hi, 4);
+        }
+#endif
+        for (; i < n; ++i)
+            plane[i] = table[plane[i]];
+    }
+}
+
+void apply(const lookupTable& table, laser::frame& points) {
+    const size_t n = points.size();
+    applyPlane(table.r.data(), points.r.data(), n);
+    applyPlane(table.g.data(), points.g.data(), n);
+    applyPlane(table.b.data(), points.b.data(), n);
+}
+
+void boost(int& r, int& g, int& b) {
+    static const std::array<uint32_t, 256> table = makeBoostTable();
+    const int m = std::max(r, std::max(g, b));
+    if (m <= 0 || m > 255)
+        return;
+    const uint32_t factor = table[m];
+    r = std::min<int>((r * factor + 0x8000) >> 16, 255);
+    g = std::min<int>((g * factor + 0x8000) >> 16, 255);
+    b = std::min<int>((b * factor + 0x8000) >> 16, 255);
+}
+
+int getCorrection(const libconfig::Setting& colorCorrection, correction& corr) {
+    colorCorrection.lookupValue("ar", corr.ar);
+    colorCorrection.lookupValue("br", corr.br);
+    colorCorrection.lookupValue("cr", corr.cr);
+    colorCorrection.lookupValue("ag", corr.ag);
+    colorCorrection.lookupValue("bg", corr.bg);
+    colorCorrection.lookupValue("cg", corr.cg);
+    colorCorrection.lookupValue("ab", corr.ab);
+    colorCorrection.lookupValue("bb", corr.bb);
+    colorCorrection.lookupValue("cb", corr.cb);
+    colorCorrection.lookupValue("gamma", corr.gamma);
+    std::cout << "Color correction coefficients:" << std::endl;
+    std::cout << "ar = " << corr.ar;
+    std::cout << ", br = " << corr.br;
+    std::cout << ", cr = " << corr.cr << std::endl;
+    std::cout << "ag = " << corr.ag;
+    std::cout << ", bg = " << corr.bg;
+    std::cout << ", cg = " << corr.cg << std::endl;
+    std::cout << "ab = " << corr.ab;
+    std::cout << ", bb = " << corr.bb;
+    std::cout <<  ", cb = " << corr.cb << std::endl;
+    std::cout << "gamma = " << corr.gamma << std::endl;
+    return 0;
+}
+
+void setCorrection(libconfig::Setting& colorCorrection, const correction& corr) {
+    colorCorrection["ar"] = corr.ar;
+    colorCorrection["br"] = corr.br;
+    colorCorrection["cr"] = corr.cr;
+    colorCorrection["ag"] = corr.ag;
+    colorCorrection["bg"] = corr.bg;
+    colorCorrection["cg"] = corr.cg;
+    colorCorrection["ab"] = corr.ab;
+    colorCorrection["bb"] = corr.bb;
+    colorCorrection["cb"] = corr.cb;
+    if (colorCorrection.exists("gamma"))
+        colorCorrection["gamma"] = corr.gamma;
+}
+
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <libconfig.h++>
+
+#include "src/pointframe.h"
+
+namespace color {
+    // quadratic correction per channel: P(x) = a * x^2 + b * x + c, applied after the gamma curve
+    struct correction {
+        float ar = 0, br = 1, cr = 0;
+        float ag = 0, bg = 1, cg = 0;
+        float ab = 0, bb = 1, cb = 0;
+        float gamma = 1;
+    };
+
+    // 256 entries per channel, compiled from a correction. The padding allows
+    // 32 bit gathers from every entry.
+    struct lookupTable {
+        std::array<uint8_t, 256> r;
+        std::array<uint8_t, 256> g;
+        std::array<uint8_t, 256> b;
+        uint8_t padding[4] = {0, 0, 0, 0};
+    };
+
+    // tables that map every value onto itself
+    lookupTable identityTable();
+
+    // evaluate the correction for every possible channel value. Zero stays zero,
+    // so blank moves stay blank even if the polynomial has an offset.
+    lookupTable buildLookupTable(const correction& corr);
+
+    // replace the color of every point by its table entry, one gather per plane
+    void apply(const lookupTable& table, laser::frame& points);
+
+    // scale the color so that the brightest channel becomes 255, uses a table of
+    // 16.16 fixed point reciprocals instead of a division per line
+    void boost(int& r, int& g, int& b);
+
+    // read the coefficients from a "color-correction" group
+    int getCorrection(const libconfig::Setting& colorCorrection, correction& corr);
+    // write the coefficients back into a "color-correction" group
+    void setCorrection(libconfig::Setting& colorCorrection, const correction& corr);
+}
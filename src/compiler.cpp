@@ -0,0 +1,204 @@
+#include "src/compiler.h"
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "src/pointframe.h"
+#include "src/vectorizer.h"
+#include "src/color.h"
+#include "src/geometry.h"
+#include "src/ilda.h"
+#include "src/input.h"
+
+namespace compiler {
+
+namespace {
+    struct job {
+        size_t index;
+        cv::Mat img;
+    };
+
+    // state shared by the decoder, the workers and the writer
+    struct pipeline {
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<job> jobs;
+        // vectorized frames waiting for their turn to be written
+        std::map<size_t, laser::frame> done;
+        size_t decoded = 0;
+        size_t written = 0;
+        // the decoder reached the end of the input
+        bool finished = false;
+        bool aborted = false;
+    };
+
+    void report(size_t written, size_t total, size_t points, double seconds, double fps) {
+        std::cout << "Compiled " << written;
+        if (total > 0)
+            std::cout << "/" << total << " frames (" << 100 * written / total << "%)";
+        else
+            std::cout << " frames";
+        if (seconds > 0) {
+            std::cout << ", " << written / seconds << " frames/s";
+            std::cout << ", " << written / fps / seconds << "x real time";
+        }
+        if (written > 0)
+            std::cout << ", " << points / written << " points/frame";
+        std::cout << std::endl;
+    }
+}
+
+int compileVideo(const Parameters& parameters, const std::string& outputFile, unsigned threads) {
+    if (parameters.inputtype != InputType::image && parameters.inputtype != InputType::video && parameters.inputtype != InputType::sequence
+        && parameters.inputtype != InputType::replay) {
+        std::cerr << "Error: only images, videos, image sequences and raw frames can be compiled." << std::endl;
+        return -1;
+    }
+    std::unique_ptr<input::source> src = input::createSource(parameters);
+    if (!src)
+        return -1;
+    double fps = src->getFrameRate();
+    if (fps <= 0)
+        fps = parameters.maxFramesPerSecond;
+    const size_t total = src->getFrameCount();
+
+    // output geometry and color correction, as for the first device in live mode
+    geometry::layout l;
+    color::correction corr;
+    const libconfig::Setting& root = parameters.config.getRoot();
+    if (root.exists("lumax")) {
+        if (root["lumax"].exists("layout"))
+            geometry::getLayout(root["lumax"]["layout"], l);
+        if (root["lumax"].exists("color-correction"))
+            color::getCorrection(root["lumax"]["color-correction"], corr);
+    }
+    const color::lookupTable table = color::buildLookupTable(corr);
+
+    ilda::writer file;
+    if (file.open(outputFile, ilda::frameRateName(fps)) != 0)
+        return -1;
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    // bounds the memory, frames are decoded at most this far ahead of the writer
+    const size_t inFlight = 4 * threads;
+    std::cout << "Compiling " << parameters.inputFile << " (" << fps << " fps) to " << outputFile << " with " << threads << " threads." << std::endl;
+
+    // every worker vectorizes one frame, OpenCV's own threads would only compete
+    const int cvThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    pipeline p;
+    std::thread decoder([&] {
+        while (true) {
+            cv::Mat img;
+            if (!src->read(img))
+                break;
+            img = vectorizer::crop(img, parameters.crop);
+
+            std::unique_lock<std::mutex> lock(p.mutex);
+            p.changed.wait(lock, [&] { return p.aborted || p.decoded - p.written < inFlight; });
+            if (p.aborted)
+                break;
+            p.jobs.push_back({p.decoded++, img});
+            p.changed.notify_all();
+        }
+        std::lock_guard<std::mutex> lock(p.mutex);
+        p.finished = true;
+        p.changed.notify_all();
+    });
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            std::vector<cv::Vec4i> houghLines;
+            cv::Mat display;
+            geometry::projection proj;
+            int width = -1, height = -1;
+            while (true) {
+                job j;
+                {
+                    std::unique_lock<std::mutex> lock(p.mutex);
+                    p.changed.wait(lock, [&] { return !p.jobs.empty() || p.finished; });
+                    if (p.jobs.empty())
+                        return;
+                    j = std::move(p.jobs.front());
+                    p.jobs.pop_front();
+                }
+
+                // the same chain as the live mode and the output threads
+                laser::frame points;
+                points.sequence = j.index;
+                vectorizer::vectorize(j.img, parameters, houghLines, points, display);
+                if (points.width != width || points.height != height) {
+                    proj = geometry::projection::toDevice(points.width, points.height) * geometry::projection::fromLayout(l, points.width, points.height);
+                    width = points.width;
+                    height = points.height;
+                }
+                proj.apply(points);
+                color::apply(table, points);
+
+                std::lock_guard<std::mutex> lock(p.mutex);
+                p.done.emplace(j.index, std::move(points));
+                p.changed.notify_all();
+            }
+        });
+    }
+
+    // write the frames in order
+    int ret = 0;
+    size_t points = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    std::unique_lock<std::mutex> lock(p.mutex);
+    while (true) {
+        p.changed.wait(lock, [&] { return p.done.count(p.written) > 0 || (p.finished && p.written == p.decoded && p.jobs.empty()); });
+        auto it = p.done.find(p.written);
+        if (it == p.done.end())
+            break;
+        laser::frame f = std::move(it->second);
+        p.done.erase(it);
+        lock.unlock();
+
+        if (file.writeFrame(f) != 0) {
+            std::cerr << "Error while writing " << outputFile << "." << std::endl;
+            ret = -1;
+            lock.lock();
+            p.aborted = true;
+            p.changed.notify_all();
+            break;
+        }
+        points += f.size();
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport > std::chrono::seconds(1)) {
+            report(p.written + 1, total, points, std::chrono::duration<double>(now - start).count(), fps);
+            lastReport = now;
+        }
+        lock.lock();
+        p.written++;
+        p.changed.notify_all();
+    }
+    const size_t written = p.written;
+    lock.unlock();
+
+    decoder.join();
+    for (auto& w : workers)
+        w.join();
+    cv::setNumThreads(cvThreads);
+
+    if (file.close() != 0)
+        ret = -1;
+    report(written, total, points, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), fps);
+    return ret;
+}
+
+}
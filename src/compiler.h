@@ -0,0 +1,12 @@
+#pragma once
+#include <string>
+
+#include "src/parameters.h"
+
+namespace compiler {
+    // decode the input video or image sequence and vectorize its frames on all cores with the same
+    // parameters as the live mode. The frames are transformed with the global
+    // lumax.layout and color-correction and written in order to an ILDA file.
+    // threads = 0 uses all cores.
+    int compileVideo(const Parameters& parameters, const std::string& outputFile, unsigned threads = 0);
+}
@@ -0,0 +1,282 @@
+#include "src/compositor.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "src/vectorizer.h"
+#include "src/svg.h"
+#include "src/trace.h"
+
+namespace compositor {
+
+namespace {
+    template<size_t N, typename T>
+    void readArray(const libconfig::Setting& settings, const char* name, std::array<T, N>& values) {
+        if (!settings.exists(name) || settings[name].getLength() != static_cast<int>(N))
+            return;
+        for (size_t k = 0; k < N; ++k)
+            values[k] = settings[name][static_cast<int>(k)];
+    }
+
+    // the points [0, count) of a frame
+    void appendPoints(const laser::frame& f, size_t count, laser::frame& points) {
+        points.x.insert(points.x.end(), f.x.begin(), f.x.begin() + count);
+        points.y.insert(points.y.end(), f.y.begin(), f.y.begin() + count);
+        points.r.insert(points.r.end(), f.r.begin(), f.r.begin() + count);
+        points.g.insert(points.g.end(), f.g.begin(), f.g.begin() + count);
+        points.b.insert(points.b.end(), f.b.begin(), f.b.begin() + count);
+    }
+}
+
+int getCompositorParameters(const Parameters& parameters, compositorParameters& result) {
+    const libconfig::Setting& root = parameters.config.getRoot();
+    try {
+        const libconfig::Setting& settings = root["application"]["compositor"];
+        settings.lookupValue("width", result.width);
+        settings.lookupValue("height", result.height);
+        settings.lookupValue("pointBudget", result.pointBudget);
+        const libconfig::Setting& list = settings["sources"];
+        for (int i = 0; i < list.getLength(); ++i) {
+            const libconfig::Setting& s = list[i];
+            sourceParameters p;
+            p.tuning = parameters;
+            if (!s.lookupValue("input", p.input) || !input::getInputType(p.input, p.inputtype)
+                || p.inputtype == InputType::precompiled || p.inputtype == InputType::composite) {
+                std::cerr << "Compositor source " << i << ": no image, video, camera, sequence, screen, shm, raw or SVG input, ignored." << std::endl;
+                continue;
+            }
+            readArray(s, "region", p.area);
+            readArray(s, "crop", p.crop);
+            s.lookupValue("priority", p.priority);
+            s.lookupValue("maxFPS", p.maxFPS);
+            if (s.exists("opencv")) {
+                vectorizer::getParameters(s["opencv"], p.tuning);
+                p.ownTuning = true;
+            }
+            result.sources.push_back(p);
+        }
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+    if (result.sources.empty()) {
+        std::cerr << "Error: no sources in application.compositor.sources." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+void place(const laser::frame& points, const placement& area, int width, int height, laser::frame& result) {
+    result.clear();
+    result.width = width;
+    result.height = height;
+    result.sequence = points.sequence;
+    if (points.width <= 0 || points.height <= 0)
+        return;
+    const float sx = (area[2] - area[0]) * width / points.width;
+    const float sy = (area[3] - area[1]) * height / points.height;
+    const float ox = area[0] * width, oy = area[1] * height;
+    result.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+        result.push(std::lround(ox + points.x[i] * sx), std::lround(oy + points.y[i] * sy), points.r[i], points.g[i], points.b[i]);
+}
+
+compositor::compositor(const Parameters& parameters, const compositorParameters& settings, snapshot::publisher<vectorizerParameters>* tuning)
+    : parameters(parameters), settings(settings), tuning(tuning) {}
+
+int compositor::open(source& s) {
+    const sourceParameters& p = s.parameters;
+    laser::frame points;
+    if (p.inputtype == InputType::vectorgraphic) {
+        svg::document doc;
+        if (svg::load(p.input, parameters.svgTolerance, parameters.svgResolution, doc) != 0)
+            return -1;
+        svg::generatePoints(doc, points);
+    } else {
+        std::unique_ptr<input::source> src = input::createSource(parameters, p.inputtype, p.input);
+        if (!src)
+            return -1;
+        if (p.inputtype != InputType::image) {
+            s.prefetch.reset(new input::prefetcher(std::move(src), p.crop, parameters.prefetchDepth, true, true));
+            return 0;
+        }
+        // a still image is vectorized once
+        cv::Mat img;
+        if (!src->read(img)) {
+            std::cerr << "Error: the input " << p.input << " has no frames." << std::endl;
+            return -1;
+        }
+        std::vector<cv::Vec4i> houghLines;
+        cv::Mat display;
+        vectorizer::vectorize(vectorizer::crop(img, p.crop), p.tuning, houghLines, points, display);
+    }
+    publish(s, points);
+    s.vectorized++;
+    return 0;
+}
+
+int compositor::start() {
+    if (running)
+        return 0;
+    sources.clear();
+    for (const sourceParameters& p : settings.sources) {
+        std::unique_ptr<source> s(new source());
+        s->parameters = p;
+        if (open(*s) != 0)
+            return -1;
+        std::cout << "Compositor source " << sources.size() << ": " << p.input << " (" << input::inputTypeName(p.inputtype) << "), region (";
+        std::cout << p.area[0] << ", " << p.area[1] << ", " << p.area[2] << ", " << p.area[3] << "), priority " << p.priority << std::endl;
+        sources.push_back(std::move(s));
+    }
+    running = true;
+    for (auto& s : sources) {
+        if (!s->prefetch)
+            continue;
+        s->prefetch->start();
+        s->worker = std::thread(&compositor::run, this, std::ref(*s));
+    }
+    return 0;
+}
+
+void compositor::stop() {
+    if (!running.exchange(false))
+        return;
+    {
+        // a worker between its check of running and the wait would miss the notification
+        std::lock_guard<std::mutex> lock(pacing);
+    }
+    stopped.notify_all();
+    for (auto& s : sources)
+        if (s->prefetch)
+            s->prefetch->cancel();
+    for (auto& s : sources) {
+        if (s->worker.joinable())
+            s->worker.join();
+        if (s->prefetch)
+            s->prefetch->stop();
+    }
+}
+
+void compositor::run(source& s) {
+    typedef std::chrono::steady_clock clock;
+    std::vector<cv::Vec4i> houghLines;
+    laser::frame points;
+    cv::Mat img, display;
+    const double maxFPS = s.parameters.maxFPS;
+    const auto period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(maxFPS > 0 ? 1.0 / maxFPS : 0));
+    auto due = clock::now();
+    // the parameters of the keys, pinned for one frame at a time
+    std::unique_ptr<snapshot::reader<vectorizerParameters>> published;
+    if (tuning != NULL && !s.parameters.ownTuning) {
+        published.reset(new snapshot::reader<vectorizerParameters>(*tuning));
+        if (!published->isValid()) {
+            std::cerr << "Warning: too many compositor sources, " << s.parameters.input << " keeps its parameters." << std::endl;
+            published.reset();
+        }
+    }
+    while (running) {
+        // every source frame gets its own id, the stages of all sources are traced
+        points.sequence = trace::nextFrame();
+        {
+            trace::scope span(points.sequence, trace::decode);
+            if (!s.prefetch->next(img))
+                break;
+        }
+        vectorizer::vectorize(img, published ? published->acquire().value : s.parameters.tuning, houghLines, points, display);
+        if (published)
+            published->release();
+        publish(s, points);
+        s.vectorized++;
+        if (maxFPS > 0) {
+            due = std::max(due + period, clock::now());
+            std::unique_lock<std::mutex> lock(pacing);
+            stopped.wait_until(lock, due, [&]{ return !running; });
+        }
+    }
+}
+
+void compositor::publish(source& s, const laser::frame& points) {
+    std::shared_ptr<laser::frame> f;
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        f.swap(s.recycled);
+    }
+    // compose() only takes the latest frame, so nobody can grab the recycled one meanwhile
+    if (!f || f.use_count() > 1)
+        f = std::make_shared<laser::frame>();
+    else
+        std::atomic_thread_fence(std::memory_order_acquire); // pairs with the release in compose()
+    place(points, s.parameters.area, settings.width, settings.height, *f);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.recycled = s.latest;
+    s.latest = f;
+}
+
+void compositor::compose(laser::frame& points) {
+    struct piece {
+        source* s;
+        std::shared_ptr<const laser::frame> f;
+        size_t count;
+    };
+    std::vector<piece> pieces;
+    for (auto& s : sources) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (s->latest && !s->latest->empty())
+            pieces.push_back({s.get(), s->latest, 0});
+    }
+    const uint64_t sequence = points.sequence;
+    points.clear();
+    points.width = settings.width;
+    points.height = settings.height;
+    points.sequence = sequence;
+
+    // the budget goes to the higher priorities first, on equal priorities to the sources
+    // listed first. Every source after the first costs two blank points.
+    std::stable_sort(pieces.begin(), pieces.end(), [](const piece& a, const piece& b) { return a.s->parameters.priority > b.s->parameters.priority; });
+    size_t budget = std::max(settings.pointBudget, 0);
+    size_t used = 0;
+    for (piece& p : pieces) {
+        const size_t joint = used > 0 ? 2 : 0;
+        p.count = budget > joint ? std::min(p.f->size(), budget - joint) : 0;
+        p.s->truncated += p.f->size() - p.count;
+        if (p.count > 0) {
+            budget -= p.count + joint;
+            used++;
+        }
+    }
+    pieces.erase(std::remove_if(pieces.begin(), pieces.end(), [](const piece& p) { return p.count == 0; }), pieces.end());
+
+    // short blank moves: the source of the highest priority first, then always the one
+    // that starts nearest to the end of the one before
+    points.reserve(settings.pointBudget);
+    for (size_t k = 0; k < pieces.size(); ++k) {
+        if (k > 0) {
+            const int lastX = points.x.back(), lastY = points.y.back();
+            size_t nearest = k;
+            int64_t best = -1;
+            for (size_t i = k; i < pieces.size(); ++i) {
+                const int64_t dx = pieces[i].f->x[0] - lastX, dy = pieces[i].f->y[0] - lastY;
+                if (best < 0 || dx * dx + dy * dy < best) {
+                    best = dx * dx + dy * dy;
+                    nearest = i;
+                }
+            }
+            std::swap(pieces[k], pieces[nearest]);
+            points.push(lastX, lastY, 0, 0, 0);
+            points.push(pieces[k].f->x[0], pieces[k].f->y[0], 0, 0, 0);
+        }
+        appendPoints(*pieces[k].f, pieces[k].count, points);
+    }
+}
+
+void compositor::printStatistics(std::ostream& os) const {
+    for (size_t i = 0; i < sources.size(); ++i) {
+        const source& s = *sources[i];
+        os << "Compositor source " << i << " (" << s.parameters.input << "): " << s.vectorized.load() << " frames vectorized, "
+           << s.truncated << " points over the budget";
+        if (s.prefetch)
+            os << ", input: " << s.prefetch->getDropped() << " frames dropped, " << s.prefetch->getLate() << " late";
+        os << "." << std::endl;
+    }
+}
+
+}
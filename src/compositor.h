@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <ostream>
+
+#include "src/parameters.h"
+#include "src/pointframe.h"
+#include "src/input.h"
+#include "src/snapshot.h"
+
+// Several inputs on one projector, e.g. a logo over a live camera or two videos side by
+// side. Every source has its own placement, vectorizer parameters and priority and is
+// vectorized by its own worker at its own rate; images and SVG drawings only once. The
+// newest frames of all sources are merged into one frame within the point budget.
+// Workers of sources without their own opencv settings follow the published
+// parameters (the keys), with one snapshot per frame.
+namespace compositor {
+    // part of the composed frame a source is shown in, normalized to [0, 1] (x0, y0, x1, y1)
+    typedef std::array<float, 4> placement;
+
+    struct sourceParameters {
+        std::string input;
+        InputType inputtype = InputType::image;
+        placement area = {0, 0, 1, 1};
+        // higher priorities get their points first when the budget is short
+        int priority = 0;
+        // [1/s] cap of the vectorization rate, 0 vectorizes every frame of the input
+        double maxFPS = 0;
+        std::array<int, 4> crop = {0, 0, 0, 0};
+        // the opencv section, overwritten by the source's own opencv settings
+        vectorizerParameters tuning;
+        // the source has its own opencv settings, the published parameters do not apply
+        bool ownTuning = false;
+    };
+
+    struct compositorParameters {
+        // pixels of the composed frame
+        int width = 1920;
+        int height = 1080;
+        // points of the composed frame, blank moves between the sources included
+        int pointBudget = 15000;
+        std::vector<sourceParameters> sources;
+    };
+
+    // application.compositor, -1 if there are no usable sources
+    int getCompositorParameters(const Parameters& parameters, compositorParameters& result);
+
+    // scale the points of a frame (pixel coordinates) into the area of a width x height frame
+    void place(const laser::frame& points, const placement& area, int width, int height, laser::frame& result);
+
+    class compositor {
+    public:
+        // tuning: the parameters changed by the keys, NULL keeps those of the start
+        compositor(const Parameters& parameters, const compositorParameters& settings, snapshot::publisher<vectorizerParameters>* tuning = NULL);
+        ~compositor() { stop(); }
+        compositor(const compositor&) = delete;
+        compositor& operator=(const compositor&) = delete;
+
+        // open all inputs, vectorize the static ones and start the workers
+        int start();
+        void stop();
+
+        // merges the newest frame of every source into points, in pixel coordinates of
+        // the composed frame. Never waits for a worker.
+        void compose(laser::frame& points);
+
+        int getWidth() const { return settings.width; }
+        int getHeight() const { return settings.height; }
+        void printStatistics(std::ostream& os) const;
+
+    private:
+        struct source {
+            sourceParameters parameters;
+            // NULL for images and drawings, they are vectorized once
+            std::unique_ptr<input::prefetcher> prefetch;
+            std::thread worker;
+            std::mutex mutex;
+            // placed into the composed frame, not changed once published
+            std::shared_ptr<laser::frame> latest;
+            // the frame before, reused once compose() does not hold it anymore
+            std::shared_ptr<laser::frame> recycled;
+            std::atomic<uint64_t> vectorized{0};
+            // points left out of the composed frames for lack of budget, compose() only
+            uint64_t truncated = 0;
+        };
+
+        int open(source& s);
+        void run(source& s);
+        void publish(source& s, const laser::frame& points);
+
+        const Parameters& parameters;
+        compositorParameters settings;
+        snapshot::publisher<vectorizerParameters>* tuning;
+        std::vector<std::unique_ptr<source>> sources;
+        std::atomic<bool> running{false};
+        // wakes the workers that wait for their next frame (maxFPS) on stop()
+        std::mutex pacing;
+        std::condition_variable stopped;
+    };
+}
@@ -0,0 +1,222 @@
+#include "src/framecache.h"
+
+#include <iostream>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace framecache {
+
+namespace {
+    const uint64_t prime = 0x9e3779b97f4a7c15ull;
+
+    inline uint64_t mix(uint64_t h, uint64_t v) {
+        h ^= v * prime;
+        h = (h << 27) | (h >> 37);
+        return h * 0xbf58476d1ce4e5b9ull;
+    }
+
+    // header of a spilled frame, followed by x, y, r, g, b and the lines
+    struct spillHeader {
+        uint64_t key;
+        uint64_t points;
+        uint64_t lines;
+        int32_t width;
+        int32_t height;
+    };
+
+    size_t spillSize(size_t points, size_t lines) {
+        const size_t n = sizeof(spillHeader) + points * (2 * sizeof(int16_t) + 3 * sizeof(uint8_t)) + lines * sizeof(cv::Vec4i);
+        return (n + 7) / 8 * 8;
+    }
+}
+
+uint64_t hashImage(const cv::Mat& img) {
+    uint64_t h = mix(mix(mix(0, img.cols), img.rows), img.type());
+    const size_t rowBytes = img.cols * img.elemSize();
+    for (int y = 0; y < img.rows; ++y) {
+        // rows of a view are not contiguous
+        const uint8_t* p = img.ptr<uint8_t>(y);
+        size_t i = 0;
+        for (; i + 8 <= rowBytes; i += 8) {
+            uint64_t v;
+            std::memcpy(&v, p + i, 8);
+            h = mix(h, v);
+        }
+        uint64_t rest = 0;
+        std::memcpy(&rest, p + i, rowBytes - i);
+        h = mix(h, rest);
+    }
+    return h;
+}
+
+void getCacheParameters(const libconfig::Config& config, cacheParameters& parameters) {
+    const libconfig::Setting& root = config.getRoot();
+    try {
+        const libconfig::Setting& c = root["application"]["cache"];
+        c.lookupValue("enabled", parameters.enabled);
+        c.lookupValue("memory", parameters.memory);
+        c.lookupValue("spillFile", parameters.spillFile);
+        c.lookupValue("spill", parameters.spill);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+}
+
+cache::cache(const cacheParameters& parameters)
+    : budget(static_cast<size_t>(std::max(parameters.memory, 0)) << 20), spillFile(parameters.spillFile) {
+    if (spillFile.empty() || parameters.spill <= 0)
+        return;
+    // the spill file is scratch space, its frames are only valid in this run
+    int fd = ::open(spillFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        std::cerr << "Error: could not open the cache file " << spillFile << ", spilling is disabled." << std::endl;
+        return;
+    }
+    mappingSize = static_cast<size_t>(parameters.spill) << 20;
+    void* m = ftruncate(fd, mappingSize) == 0 ? mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        std::cerr << "Error: could not map the cache file " << spillFile << ", spilling is disabled." << std::endl;
+        mappingSize = 0;
+        return;
+    }
+    mapping = static_cast<uint8_t*>(m);
+}
+
+cache::~cache() {
+    if (mapping != NULL) {
+        munmap(mapping, mappingSize);
+        unlink(spillFile.c_str());
+    }
+}
+
+bool cache::lookup(uint64_t key, laser::frame& points, std::vector<cv::Vec4i>& lines) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        entry e;
+        if (!unspill(key, e)) {
+            misses++;
+            return false;
+        }
+        // back into memory as the most recently used frame
+        bytes += e.bytes;
+        lru.push_front(std::move(e));
+        it = index.emplace(key, lru.begin()).first;
+        evict();
+    } else {
+        lru.splice(lru.begin(), lru, it->second);
+    }
+    hits++;
+
+    const entry& e = *it->second;
+    const uint64_t sequence = points.sequence;
+    points.x.assign(e.points.x.begin(), e.points.x.end());
+    points.y.assign(e.points.y.begin(), e.points.y.end());
+    points.r.assign(e.points.r.begin(), e.points.r.end());
+    points.g.assign(e.points.g.begin(), e.points.g.end());
+    points.b.assign(e.points.b.begin(), e.points.b.end());
+    points.width = e.points.width;
+    points.height = e.points.height;
+    points.sequence = sequence;
+    lines = e.lines;
+    return true;
+}
+
+void cache::insert(uint64_t key, const laser::frame& points, const std::vector<cv::Vec4i>& lines) {
+    if (index.count(key) != 0)
+        return;
+    entry e;
+    e.key = key;
+    e.points = points;
+    e.lines = lines;
+    e.bytes = sizeof(entry) + points.bytes() + lines.size() * sizeof(cv::Vec4i);
+    bytes += e.bytes;
+    lru.push_front(std::move(e));
+    index[key] = lru.begin();
+    spilled.erase(key);
+    evict();
+}
+
+void cache::clear() {
+    lru.clear();
+    index.clear();
+    spilled.clear();
+    bytes = 0;
+    spillOffset = 0;
+}
+
+void cache::evict() {
+    // the most recent frame stays, even if it alone is over the budget
+    while (bytes > budget && lru.size() > 1) {
+        const entry& e = lru.back();
+        if (mapping != NULL)
+            spill(e);
+        bytes -= e.bytes;
+        index.erase(e.key);
+        lru.pop_back();
+    }
+}
+
+void cache::spill(const entry& e) {
+    const size_t size = spillSize(e.points.size(), e.lines.size());
+    if (size > mappingSize)
+        return;
+    if (spillOffset + size > mappingSize) {
+        // the file is used as a ring: the oldest spilled frames are overwritten
+        spillOffset = 0;
+    }
+    // drop the spilled frames in the region that is overwritten
+    for (auto it = spilled.begin(); it != spilled.end();) {
+        if (it->second.offset < spillOffset + size && spillOffset < it->second.offset + it->second.bytes)
+            it = spilled.erase(it);
+        else
+            ++it;
+    }
+
+    uint8_t* p = mapping + spillOffset;
+    spillHeader h = {e.key, e.points.size(), e.lines.size(), e.points.width, e.points.height};
+    std::memcpy(p, &h, sizeof(h));
+    p += sizeof(h);
+    const size_t n = e.points.size();
+    std::memcpy(p, e.points.x.data(), n * sizeof(int16_t)); p += n * sizeof(int16_t);
+    std::memcpy(p, e.points.y.data(), n * sizeof(int16_t)); p += n * sizeof(int16_t);
+    std::memcpy(p, e.points.r.data(), n); p += n;
+    std::memcpy(p, e.points.g.data(), n); p += n;
+    std::memcpy(p, e.points.b.data(), n); p += n;
+    std::memcpy(p, e.lines.data(), e.lines.size() * sizeof(cv::Vec4i));
+    spilled[e.key] = {spillOffset, size};
+    spillOffset += size;
+}
+
+bool cache::unspill(uint64_t key, entry& e) {
+    auto it = spilled.find(key);
+    if (it == spilled.end())
+        return false;
+    const uint8_t* p = mapping + it->second.offset;
+    spillHeader h;
+    std::memcpy(&h, p, sizeof(h));
+    p += sizeof(h);
+    const size_t n = h.points;
+    e.key = key;
+    e.points.resize(n);
+    std::memcpy(e.points.x.data(), p, n * sizeof(int16_t)); p += n * sizeof(int16_t);
+    std::memcpy(e.points.y.data(), p, n * sizeof(int16_t)); p += n * sizeof(int16_t);
+    std::memcpy(e.points.r.data(), p, n); p += n;
+    std::memcpy(e.points.g.data(), p, n); p += n;
+    std::memcpy(e.points.b.data(), p, n); p += n;
+    e.points.width = h.width;
+    e.points.height = h.height;
+    e.lines.resize(h.lines);
+    std::memcpy(e.lines.data(), p, h.lines * sizeof(cv::Vec4i));
+    e.bytes = sizeof(entry) + e.points.bytes() + e.lines.size() * sizeof(cv::Vec4i);
+    spilled.erase(it);
+    return true;
+}
+
+void cache::printStatistics(std::ostream& os) const {
+    os << "Frame cache: " << hits << " hits, " << misses << " misses, " << index.size() << " frames in memory ("
+       << (bytes >> 20) << " MB), " << spilled.size() << " spilled." << std::endl;
+}
+
+}
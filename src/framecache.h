@@ -0,0 +1,85 @@
+#pragma once
+#include <list>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+#include "src/parameters.h"
+#include "src/pointframe.h"
+
+// Cache of vectorized frames for looping media: a frame whose pixels and
+// vectorization parameters were seen before is served without the OpenCV
+// pipeline. The key is a hash of both, so changed parameters never hit old
+// results.
+namespace framecache {
+    // 64 bit hash of the pixels, the size and the type of an image (also of views)
+    uint64_t hashImage(const cv::Mat& img);
+    inline uint64_t key(uint64_t image, uint64_t parameters) { return image ^ (parameters * 0x9e3779b97f4a7c15ull); }
+
+    struct cacheParameters {
+        bool enabled = true;
+        // [MB] in memory
+        int memory = 256;
+        // least recently used frames that do not fit into memory are moved to this
+        // memory mapped file, empty for none
+        std::string spillFile;
+        // [MB] size of the spill file
+        int spill = 1024;
+    };
+    void getCacheParameters(const libconfig::Config& config, cacheParameters& parameters);
+
+    class cache {
+    public:
+        cache(const cacheParameters& parameters);
+        ~cache();
+        cache(const cache&) = delete;
+        cache& operator=(const cache&) = delete;
+
+        // copies the cached points and lines of key into points and lines, keeps the
+        // sequence of points. Spilled frames are moved back into memory.
+        bool lookup(uint64_t key, laser::frame& points, std::vector<cv::Vec4i>& lines);
+        void insert(uint64_t key, const laser::frame& points, const std::vector<cv::Vec4i>& lines);
+        // drops all frames, e.g. when the parameters changed
+        void clear();
+
+        uint64_t getHits() const { return hits; }
+        uint64_t getMisses() const { return misses; }
+        size_t getFrames() const { return index.size() + spilled.size(); }
+        // [bytes] in memory
+        size_t getBytes() const { return bytes; }
+        void printStatistics(std::ostream& os) const;
+
+    private:
+        struct entry {
+            uint64_t key;
+            laser::frame points;
+            std::vector<cv::Vec4i> lines;
+            size_t bytes;
+        };
+        // location of a spilled frame in the mapping
+        struct spillEntry {
+            size_t offset;
+            size_t bytes;
+        };
+
+        void evict();
+        void spill(const entry& e);
+        bool unspill(uint64_t key, entry& e);
+
+        size_t budget;
+        size_t bytes = 0;
+        std::list<entry> lru; // most recently used first
+        std::unordered_map<uint64_t, std::list<entry>::iterator> index;
+
+        std::string spillFile;
+        uint8_t* mapping = NULL;
+        size_t mappingSize = 0;
+        size_t spillOffset = 0;
+        std::unordered_map<uint64_t, spillEntry> spilled;
+
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+}
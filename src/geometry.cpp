@@ -0,0 +1,171 @@
+#include "src/geometry.h"
+
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Dense>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace geometry {
+
+namespace {
+    template<bool projective>
+    inline void mapScalar(const float* m, float& x, float& y) {
+        const float u = m[0] * x + m[1] * y + m[2];
+        const float v = m[3] * x + m[4] * y + m[5];
+        if (projective) {
+            const float w = m[6] * x + m[7] * y + m[8];
+            const float iw = (w != 0 ? 1.0f / w : 0.0f);
+            x = u * iw;
+            y = v * iw;
+        } else {
+            x = u;
+            y = v;
+        }
+    }
+
+    inline int16_t saturate(float v) {
+        return static_cast<int16_t>(std::lround(std::min(std::max(v, -32768.0f), 32767.0f)));
+    }
+
+    template<bool projective>
+    void applyKernel(const float* m, int16_t* x, int16_t* y, size_t n) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+        const __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+        const __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+        for (; i + 8 <= n; i += 8) {
+            const __m256 px = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i))));
+            const __m256 py = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i))));
+            __m256 u = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m0, px), _mm256_mul_ps(m1, py)), m2);
+            __m256 v = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m3, px), _mm256_mul_ps(m4, py)), m5);
+            if (projective) {
+                const __m256 w = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(m6, px), _mm256_mul_ps(m7, py)), m8);
+                // points on the horizon go to 0 as in mapScalar()
+                const __m256 iw = _mm256_and_ps(_mm256_div_ps(_mm256_set1_ps(1.0f), w), _mm256_cmp_ps(w, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+                u = _mm256_mul_ps(u, iw);
+                v = _mm256_mul_ps(v, iw);
+            }
+            // saturate as saturate() does: beyond 2^31 the conversion gives INT_MIN
+            const __m256 lo = _mm256_set1_ps(-32768.0f), hi = _mm256_set1_ps(32767.0f);
+            u = _mm256_min_ps(_mm256_max_ps(u, lo), hi);
+            v = _mm256_min_ps(_mm256_max_ps(v, lo), hi);
+            // round, pack to 16 bit and undo the lane interleaving of the pack
+            __m256i ui = _mm256_packs_epi32(_mm256_cvtps_epi32(u), _mm256_cvtps_epi32(v));
+            ui = _mm256_permute4x64_epi64(ui, 0xd8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(x + i), _mm256_castsi256_si128(ui));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(y + i), _mm256_extracti128_si256(ui, 1));
+        }
+#elif defined(__SSE2__)
+        const __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+        const __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+        const __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+        for (; i + 4 <= n; i += 4) {
+            // sign extend 4 x 16 bit to 32 bit
+            const __m128i ix = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(x + i));
+            const __m128i iy = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + i));
+            const __m128 px = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(ix, ix), 16));
+            const __m128 py = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(iy, iy), 16));
+            __m128 u = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m0, px), _mm_mul_ps(m1, py)), m2);
+            __m128 v = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m3, px), _mm_mul_ps(m4, py)), m5);
+            if (projective) {
+                const __m128 w = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m6, px), _mm_mul_ps(m7, py)), m8);
+                const __m128 iw = _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), w), _mm_cmpneq_ps(w, _mm_setzero_ps()));
+                u = _mm_mul_ps(u, iw);
+                v = _mm_mul_ps(v, iw);
+            }
+            const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+            u = _mm_min_ps(_mm_max_ps(u, lo), hi);
+            v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+            const __m128i uv = _mm_packs_epi32(_mm_cvtps_epi32(u), _mm_cvtps_epi32(v));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(x + i), uv);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(y + i), _mm_unpackhi_epi64(uv, uv));
+        }
+#endif
+        for (; i < n; ++i) {
+            float fx = x[i], fy = y[i];
+            mapScalar<projective>(m, fx, fy);
+            x[i] = saturate(fx);
+            y[i] = saturate(fy);
+        }
+    }
+}
+
+projection projection::fromLayout(const layout& l, int width, int height) {
+    const float cx = width / 2.0f;
+    const float cy = height / 2.0f;
+    const float a = l.rotation * static_cast<float>(M_PI) / 180.0f;
+    const float c = std::cos(a), s = std::sin(a);
+
+    // frame -> normalized coordinates [-1, 1]
+    const projection toNormalized({1 / cx, 0, -1, 0, 1 / cy, -1, 0, 0, 1});
+    const projection keystone({1, 0, 0, 0, 1, 0, l.keystoneX, l.keystoneY, 1});
+    const projection rotation({c, -s, 0, s, c, 0, 0, 0, 1});
+    const projection scaling({l.mirrorFactX * l.scalingX, 0, 0, 0, l.mirrorFactY * l.scalingY, 0, 0, 0, 1});
+    const projection swap = (l.swapXY ? projection({0, 1, 0, 1, 0, 0, 0, 0, 1}) : projection());
+    // normalized -> frame coordinates
+    const projection toFrame({cx, 0, cx, 0, cy, cy, 0, 0, 1});
+
+    return toFrame * swap * scaling * rotation * keystone * toNormalized;
+}
+
+projection projection::toDevice(int width, int height) {
+    const float cx = width / 2.0f;
+    const float cy = height / 2.0f;
+    return projection({32767 / cx, 0, -32767, 0, -32767 / cy, 32767, 0, 0, 1});
+}
+
+projection projection::operator*(const projection& o) const {
+    typedef Eigen::Matrix<float, 3, 3, Eigen::RowMajor> matrix3;
+    projection r;
+    Eigen::Map<matrix3>(r.m.data()).noalias() = Eigen::Map<const matrix3>(m.data()) * Eigen::Map<const matrix3>(o.m.data());
+    return r;
+}
+
+void projection::map(float& x, float& y) const {
+    if (isAffine())
+        mapScalar<false>(m.data(), x, y);
+    else
+        mapScalar<true>(m.data(), x, y);
+}
+
+void projection::apply(laser::frame& points) const {
+    if (isAffine())
+        applyKernel<false>(m.data(), points.x.data(), points.y.data(), points.size());
+    else
+        applyKernel<true>(m.data(), points.x.data(), points.y.data(), points.size());
+}
+
+namespace {
+    // numbers may be given as int or float in the config file
+    bool lookupNumber(const libconfig::Setting& settings, const char* name, float& value) {
+        int i;
+        if (settings.lookupValue(name, value))
+            return true;
+        if (settings.lookupValue(name, i)) {
+            value = static_cast<float>(i);
+            return true;
+        }
+        return false;
+    }
+}
+
+int getLayout(const libconfig::Setting& settings, layout& l) {
+    float swapXY = l.swapXY;
+    lookupNumber(settings, "mirrorFactX", l.mirrorFactX);
+    lookupNumber(settings, "mirrorFactY", l.mirrorFactY);
+    lookupNumber(settings, "scalingX", l.scalingX);
+    lookupNumber(settings, "scalingY", l.scalingY);
+    if (lookupNumber(settings, "swapXY", swapXY))
+        l.swapXY = (swapXY != 0);
+    else
+        settings.lookupValue("swapXY", l.swapXY);
+    lookupNumber(settings, "rotation", l.rotation);
+    lookupNumber(settings, "keystoneX", l.keystoneX);
+    lookupNumber(settings, "keystoneY", l.keystoneY);
+    return 0;
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <cstddef>
+#include <libconfig.h++>
+
+#include "src/pointframe.h"
+
+namespace geometry {
+    // output geometry of one projector, as given in the lumax.layout section
+    struct layout {
+        float mirrorFactX = 1;
+        float mirrorFactY = 1;
+        float scalingX = 1;
+        float scalingY = 1;
+        bool swapXY = false;
+        // [deg] rotation around the center of the frame
+        float rotation = 0;
+        // perspective terms for off-axis projectors, in units of half the frame size
+        float keystoneX = 0;
+        float keystoneY = 0;
+    };
+
+    // row major 3x3 projective transformation of frame coordinates
+    class projection {
+    public:
+        projection() : m({1, 0, 0, 0, 1, 0, 0, 0, 1}) {}
+        projection(const std::array<float, 9>& m) : m(m) {}
+
+        // compile the layout into one matrix. The layout is applied around the
+        // center of a width x height frame: keystone, rotation, scaling/mirroring, swap.
+        static projection fromLayout(const layout& l, int width, int height);
+        // pixels of a width x height frame -> signed 16 bit device coordinates, y pointing up
+        static projection toDevice(int width, int height);
+
+        projection operator*(const projection& other) const;
+        bool isAffine() const { return m[6] == 0 && m[7] == 0 && m[8] == 1; }
+
+        void map(float& x, float& y) const;
+        // transform all coordinates of the frame in place, one pass with SIMD,
+        // affine matrices skip the divide. The results are rounded and saturated to 16 bit.
+        void apply(laser::frame& points) const;
+
+        std::array<float, 9> m;
+    };
+
+    // read a "layout" group
+    int getLayout(const libconfig::Setting& settings, layout& l);
+}
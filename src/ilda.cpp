@@ -0,0 +1,301 @@
+#include "src/ilda.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cmath>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace ilda {
+
+namespace {
+    // ILDA is big endian
+    void putWord(uint8_t* p, uint16_t value) {
+        p[0] = static_cast<uint8_t>(value >> 8);
+        p[1] = static_cast<uint8_t>(value & 0xff);
+    }
+
+    uint16_t getWord(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    // bytes per record of the formats 0 to 5
+    const size_t recordSize[6] = {8, 6, 3, 0, 10, 8};
+
+    // colors of the formats 0 and 1 before the file has a palette (format 2) of its own,
+    // the default palette of the ILDA standard
+    const size_t defaultColors = 64;
+    const uint8_t defaultPalette[3 * defaultColors] = {
+        255, 0, 0,     255, 16, 0,    255, 32, 0,    255, 48, 0,    255, 64, 0,    255, 80, 0,    255, 96, 0,    255, 112, 0,
+        255, 128, 0,   255, 144, 0,   255, 160, 0,   255, 176, 0,   255, 192, 0,   255, 208, 0,   255, 224, 0,   255, 240, 0,
+        255, 255, 0,   224, 255, 0,   192, 255, 0,   160, 255, 0,   128, 255, 0,   96, 255, 0,    64, 255, 0,    32, 255, 0,
+        0, 255, 0,     0, 255, 36,    0, 255, 73,    0, 255, 109,   0, 255, 146,   0, 255, 182,   0, 255, 219,   0, 255, 255,
+        0, 227, 255,   0, 198, 255,   0, 170, 255,   0, 142, 255,   0, 113, 255,   0, 85, 255,    0, 56, 255,    0, 28, 255,
+        0, 0, 255,     32, 0, 255,    64, 0, 255,    96, 0, 255,    128, 0, 255,   160, 0, 255,   192, 0, 255,   224, 0, 255,
+        255, 0, 255,   255, 32, 255,  255, 64, 255,  255, 96, 255,  255, 128, 255, 255, 160, 255, 255, 192, 255, 255, 224, 255,
+        255, 255, 255, 255, 224, 224, 255, 192, 192, 255, 160, 160, 255, 128, 128, 255, 96, 96,   255, 64, 64,   255, 32, 32
+    };
+
+    void putHeader(uint8_t* p, const std::string& name, const std::string& company, uint16_t records, uint16_t frameNumber, uint16_t totalFrames) {
+        std::memset(p, 0, headerSize);
+        std::memcpy(p, "ILDA", 4);
+        p[7] = 5; // format code
+        std::memcpy(p + 8, name.data(), std::min<size_t>(name.size(), 8));
+        std::memcpy(p + 16, company.data(), std::min<size_t>(company.size(), 8));
+        putWord(p + 24, records);
+        putWord(p + 26, frameNumber);
+        putWord(p + 28, totalFrames);
+    }
+}
+
+int writer::open(const std::string& fileName, const std::string& name_, const std::string& company_) {
+    close();
+    file.open(fileName, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Error: could not open " << fileName << " for writing." << std::endl;
+        return -1;
+    }
+    name = name_;
+    company = company_;
+    headers.clear();
+    return 0;
+}
+
+int writer::writeFrame(const laser::frame& points) {
+    if (!file.is_open())
+        return -1;
+    size_t n = points.size();
+    if (n > 0xffff) {
+        std::cerr << "Warning: ILDA frame " << headers.size() << " truncated to 65535 points." << std::endl;
+        n = 0xffff;
+    }
+    const size_t records = std::max<size_t>(n, 1);
+
+    buffer.resize(headerSize + records * pointSize);
+    // the frame number wraps, see the header
+    putHeader(buffer.data(), name, company, static_cast<uint16_t>(records), static_cast<uint16_t>(headers.size() & 0xffff), 0);
+    uint8_t* p = buffer.data() + headerSize;
+    if (n == 0) {
+        std::memset(p, 0, pointSize);
+        p[4] = lastPoint | blanked;
+    }
+    for (size_t i = 0; i < n; ++i, p += pointSize) {
+        putWord(p, static_cast<uint16_t>(points.x[i]));
+        putWord(p + 2, static_cast<uint16_t>(points.y[i]));
+        p[4] = (points.isBlank(i) ? blanked : 0) | (i + 1 == n ? lastPoint : 0);
+        p[5] = points.b[i];
+        p[6] = points.g[i];
+        p[7] = points.r[i];
+    }
+
+    headers.push_back(file.tellp());
+    file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+    return file ? 0 : -1;
+}
+
+int writer::close() {
+    if (!file.is_open())
+        return 0;
+    uint8_t header[headerSize];
+    const uint16_t total = static_cast<uint16_t>(std::min<size_t>(headers.size(), 0xffff));
+    putHeader(header, name, company, 0, total, total);
+    file.write(reinterpret_cast<const char*>(header), headerSize);
+
+    // total number of frames in every header
+    uint8_t word[2];
+    putWord(word, total);
+    for (std::streamoff offset : headers) {
+        file.seekp(offset + 28);
+        file.write(reinterpret_cast<const char*>(word), 2);
+    }
+    const bool ok = static_cast<bool>(file);
+    file.close();
+    return ok ? 0 : -1;
+}
+
+int reader::open(const std::string& fileName) {
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: could not open " << fileName << "." << std::endl;
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(headerSize)) {
+        std::cerr << "Error: " << fileName << " is not an ILDA file." << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    length = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: could not map " << fileName << " into memory." << std::endl;
+        length = 0;
+        return -1;
+    }
+    data = static_cast<const uint8_t*>(mapping);
+
+    // index the frames, the point data stays in the file
+    uint16_t palette = 0xffff;
+    size_t offset = 0;
+    while (offset + headerSize <= length) {
+        const uint8_t* h = data + offset;
+        if (std::memcmp(h, "ILDA", 4) != 0) {
+            std::cerr << "Warning: " << fileName << " is corrupt at byte " << offset << "." << std::endl;
+            break;
+        }
+        const uint8_t format = h[7];
+        const uint16_t records = getWord(h + 24);
+        if (records == 0)
+            break; // end of file
+        if (format > 5 || recordSize[format] == 0) {
+            std::cerr << "Warning: unsupported ILDA format " << (int)format << " in " << fileName << "." << std::endl;
+            break;
+        }
+        const size_t size = records * recordSize[format];
+        if (offset + headerSize + size > length) {
+            std::cerr << "Warning: " << fileName << " is truncated." << std::endl;
+            break;
+        }
+        if (format == 2) {
+            palettes.emplace_back(h + headerSize, h + headerSize + size);
+            palette = static_cast<uint16_t>(palettes.size() - 1);
+        } else {
+            if (frames.empty())
+                frameRate = parseFrameRate(std::string(reinterpret_cast<const char*>(h + 8), strnlen(reinterpret_cast<const char*>(h + 8), 8)));
+            frames.push_back({offset + headerSize, records, format, palette});
+            maxPoints = std::max<size_t>(maxPoints, records);
+        }
+        offset += headerSize + size;
+    }
+    // frames are read in order, seeking is the exception
+    madvise(mapping, length, MADV_SEQUENTIAL);
+    return 0;
+}
+
+void reader::close() {
+    if (data != NULL)
+        munmap(const_cast<uint8_t*>(data), length);
+    data = NULL;
+    length = 0;
+    frames.clear();
+    palettes.clear();
+    maxPoints = 0;
+    frameRate = 0;
+}
+
+int reader::readFrame(size_t i, laser::frame& points) const {
+    if (i >= frames.size())
+        return -1;
+    const entry& e = frames[i];
+    const size_t stride = recordSize[e.format];
+    // position of the status byte, the colors follow it
+    const size_t status = (e.format == 0 || e.format == 4) ? 6 : 4;
+    const bool indexed = e.format < 2;
+    const uint8_t* palette = defaultPalette;
+    size_t colors = defaultColors;
+    if (e.palette < palettes.size()) {
+        palette = palettes[e.palette].data();
+        colors = palettes[e.palette].size() / 3;
+    }
+
+    points.resize(e.records);
+    // device coordinates, no projection or color correction needed
+    points.width = 0;
+    points.height = 0;
+    const uint8_t* p = data + e.offset;
+    for (size_t k = 0; k < e.records; ++k, p += stride) {
+        points.x[k] = static_cast<int16_t>(getWord(p));
+        points.y[k] = static_cast<int16_t>(getWord(p + 2));
+        uint8_t r = 0, g = 0, b = 0;
+        if (!(p[status] & blanked)) {
+            if (!indexed) {
+                b = p[status + 1];
+                g = p[status + 2];
+                r = p[status + 3];
+            } else if (p[status + 1] < colors) {
+                r = palette[3 * p[status + 1]];
+                g = palette[3 * p[status + 1] + 1];
+                b = palette[3 * p[status + 1] + 2];
+            } else {
+                // not in the palette: white
+                r = g = b = 255;
+            }
+        }
+        points.r[k] = r;
+        points.g[k] = g;
+        points.b[k] = b;
+    }
+    return 0;
+}
+
+void playback::start() {
+    origin = std::chrono::steady_clock::now();
+    pausedAt = 0;
+}
+
+void playback::setPause(bool p) {
+    if (p == paused)
+        return;
+    if (p)
+        pausedAt = getPosition();
+    else
+        origin = std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(pausedAt));
+    paused = p;
+}
+
+void playback::seek(double seconds) {
+    const double duration = frames / fps;
+    double position = getPosition() + seconds;
+    if (loop && duration > 0)
+        position = std::fmod(std::fmod(position, duration) + duration, duration);
+    position = std::min(std::max(position, 0.0), duration);
+    if (paused)
+        pausedAt = position;
+    else
+        origin = std::chrono::steady_clock::now() - std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(position));
+}
+
+double playback::getPosition() const {
+    if (paused)
+        return pausedAt;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - origin).count();
+}
+
+long playback::getFrame() const {
+    if (frames == 0 || fps <= 0)
+        return -1;
+    long frame = static_cast<long>(std::floor(getPosition() * fps));
+    if (loop)
+        return frame % static_cast<long>(frames);
+    return frame < static_cast<long>(frames) ? frame : -1;
+}
+
+double playback::getTimeToNextFrame() const {
+    if (paused || fps <= 0)
+        return 0.01;
+    const double position = getPosition();
+    return (std::floor(position * fps) + 1) / fps - position;
+}
+
+std::string frameRateName(double fps) {
+    char name[16];
+    // the name field has 8 characters
+    std::snprintf(name, sizeof(name), fps < 100 ? "%.2ffps" : "%.1ffps", fps);
+    return std::string(name).substr(0, 8);
+}
+
+double parseFrameRate(const std::string& name) {
+    size_t suffix = name.find("fps");
+    if (suffix == std::string::npos || suffix == 0)
+        return 0;
+    return std::atof(name.substr(0, suffix).c_str());
+}
+
+}
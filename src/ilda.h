@@ -0,0 +1,117 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <chrono>
+
+#include "src/pointframe.h"
+
+namespace ilda {
+    // ILDA image data transfer format, we write format 5 (2D, true color)
+    const size_t headerSize = 32;
+    const size_t pointSize = 8;
+    // status byte of a point
+    const uint8_t lastPoint = 0x80;
+    const uint8_t blanked = 0x40;
+
+    // writes frames in device coordinates (signed 16 bit, y pointing up). The frame number
+    // in the header is 16 bit and wraps after 65536 frames (36 minutes at 30 fps), the
+    // total is capped at 65535. The frames are complete nevertheless, readers that scan
+    // the file as ilda::reader read all of them.
+    class writer {
+    public:
+        ~writer() { close(); }
+
+        // the name is stored in the header of every frame, e.g. the frame rate "25.00fps"
+        int open(const std::string& fileName, const std::string& name = "", const std::string& company = "LaserDsp");
+        // an empty frame is written as one blanked point, because a header
+        // without records marks the end of the file
+        int writeFrame(const laser::frame& points);
+        // write the end of file header and the total number of frames into every header
+        int close();
+
+        size_t getFrames() const { return headers.size(); }
+
+    private:
+        std::ofstream file;
+        std::string name;
+        std::string company;
+        // file offsets of the frame headers
+        std::vector<std::streamoff> headers;
+        std::vector<uint8_t> buffer;
+    };
+
+    // memory maps an ILDA file and indexes its frames at load. Reads formats
+    // 0, 1 (indexed color, palette from format 2 records, before the first one the
+    // default palette of the standard), 4 and 5.
+    class reader {
+    public:
+        reader() {}
+        ~reader() { close(); }
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        int open(const std::string& fileName);
+        void close();
+
+        size_t getFrames() const { return frames.size(); }
+        // the largest frame, reserve this many points to read without allocation
+        size_t getMaxPoints() const { return maxPoints; }
+        // frame rate stored in the frame name by the writer, 0 if unknown
+        double getFrameRate() const { return frameRate; }
+
+        // decode frame i into device coordinates, reuses the capacity of points
+        int readFrame(size_t i, laser::frame& points) const;
+
+    private:
+        struct entry {
+            size_t offset; // of the first point
+            uint16_t records;
+            uint8_t format;
+            uint16_t palette; // index into palettes
+        };
+
+        const uint8_t* data = NULL;
+        size_t length = 0;
+        std::vector<entry> frames;
+        std::vector<std::vector<uint8_t>> palettes; // rgb
+        size_t maxPoints = 0;
+        double frameRate = 0;
+    };
+
+    // wall clock position in a file at a fixed frame rate, with pause, seek and loop.
+    // The frame is derived from the elapsed time, so a late frame never delays the following ones.
+    class playback {
+    public:
+        playback(size_t frames, double fps, bool loop = true) : frames(frames), fps(fps), loop(loop) {}
+
+        void start();
+        void setPause(bool p);
+        bool isPaused() const { return paused; }
+        void setLoop(bool l) { loop = l; }
+        bool isLooping() const { return loop; }
+        // [s] relative to the current position
+        void seek(double seconds);
+
+        // frame to show now, -1 after the end if not looping
+        long getFrame() const;
+        // [s] until the next frame is due
+        double getTimeToNextFrame() const;
+        // [s] position in the file
+        double getPosition() const;
+
+    private:
+        size_t frames;
+        double fps;
+        bool loop;
+        bool paused = false;
+        std::chrono::steady_clock::time_point origin;
+        // [s] position when paused
+        double pausedAt = 0;
+    };
+
+    // "25.00fps" <-> 25, the frame rate is kept in the frame name
+    std::string frameRateName(double fps);
+    double parseFrameRate(const std::string& name);
+}
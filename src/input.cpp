@@ -0,0 +1,558 @@
+#include "src/input.h"
+
+#include <iostream>
+#include <filesystem>
+#include <algorithm>
+#include <climits>
+
+#include "src/vectorizer.h"
+#include "src/screen.h"
+
+namespace input {
+
+namespace {
+    // the file of image k of a numbered sequence: the pattern with its integer conversion
+    // (%d, %4d or %04d) replaced by k and %% by %. The pattern is never used as a printf
+    // format, false if it has not exactly one conversion or another one.
+    bool sequenceFile(const std::string& pattern, int k, std::string& name) {
+        name.clear();
+        int conversions = 0;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (pattern[i] != '%') {
+                name += pattern[i];
+                continue;
+            }
+            if (++i < pattern.size() && pattern[i] == '%') {
+                name += '%';
+                continue;
+            }
+            const bool zeros = i < pattern.size() && pattern[i] == '0';
+            size_t width = 0;
+            for (; i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9'; ++i)
+                width = 10 * width + (pattern[i] - '0');
+            if (i >= pattern.size() || pattern[i] != 'd' || width > 16 || ++conversions > 1)
+                return false;
+            std::string number = std::to_string(k);
+            if (number.size() < width)
+                number.insert(0, width - number.size(), zeros ? '0' : ' ');
+            name += number;
+        }
+        return conversions == 1;
+    }
+}
+
+bool imageSource::open() {
+    image = cv::imread(fileName);
+    if (image.empty()) {
+        std::cerr << "Error while reading the image " << fileName << "." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool imageSource::read(cv::Mat& img) {
+    if (done)
+        return false;
+    // the image is never written, every frame shares the decoded pixels
+    img = image;
+    done = true;
+    return true;
+}
+
+bool captureSource::open() {
+    if (device >= 0)
+        capture.open(device);
+    else
+        capture.open(fileName);
+    if (!capture.isOpened()) {
+        std::cerr << "Error while opening the " << getName() << "." << std::endl;
+        return false;
+    }
+    frameRate = capture.get(cv::CAP_PROP_FPS);
+    return true;
+}
+
+bool captureSource::read(cv::Mat& img) {
+    capture >> img;
+    return !img.empty();
+}
+
+bool captureSource::skip() {
+    // demuxes the packet, but neither decodes nor converts the frame
+    return capture.grab();
+}
+
+bool captureSource::rewind() {
+    if (device >= 0)
+        return false;
+    return capture.set(cv::CAP_PROP_POS_FRAMES, 0);
+}
+
+size_t captureSource::getFrameCount() const {
+    if (device >= 0)
+        return 0;
+    return static_cast<size_t>(std::max(0.0, capture.get(cv::CAP_PROP_FRAME_COUNT)));
+}
+
+bool sequenceSource::open() {
+    namespace fs = std::filesystem;
+    files.clear();
+    std::error_code error;
+    if (fs::is_directory(pattern, error)) {
+        for (const auto& entry : fs::directory_iterator(pattern, error)) {
+            std::string suffix = entry.path().extension().string();
+            std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+            if (suffix == ".png" || suffix == ".jpg" || suffix == ".jpeg" || suffix == ".bmp")
+                files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+    } else {
+        // numbered files, the numbering may start at 0 or 1
+        std::string name;
+        if (!sequenceFile(pattern, 0, name)) {
+            std::cerr << "Error: the sequence " << pattern << " needs exactly one number (%d or e.g. %04d), %% for a percent sign." << std::endl;
+            return false;
+        }
+        for (int i = 0; i < 2 && files.empty(); ++i) {
+            for (int k = i; sequenceFile(pattern, k, name) && fs::exists(name, error); ++k)
+                files.push_back(name);
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "Error: no images found for the sequence " << pattern << "." << std::endl;
+        return false;
+    }
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency() / 2);
+    std::cout << "Image sequence: " << files.size() << " images, decoded with " << threads << " threads." << std::endl;
+    nextFile = 0;
+    pending.clear();
+    schedule();
+    return true;
+}
+
+void sequenceSource::schedule() {
+    // keep one decode per thread in flight
+    while (pending.size() < threads && nextFile < files.size()) {
+        const std::string fileName = files[nextFile++];
+        pending.push_back(std::async(std::launch::async, [fileName] { return cv::imread(fileName); }));
+    }
+}
+
+bool sequenceSource::read(cv::Mat& img) {
+    while (!pending.empty()) {
+        img = pending.front().get();
+        pending.pop_front();
+        schedule();
+        if (!img.empty())
+            return true;
+        std::cerr << "Warning: could not decode an image of the sequence " << pattern << "." << std::endl;
+    }
+    return false;
+}
+
+bool sequenceSource::skip() {
+    if (pending.empty())
+        return false;
+    // the decode is already running, waits for it
+    pending.pop_front();
+    schedule();
+    return true;
+}
+
+bool sequenceSource::rewind() {
+    pending.clear(); // waits for the running decodes
+    nextFile = 0;
+    schedule();
+    return true;
+}
+
+bool shmSource::open() {
+    // the consumer owns the ring, producers attach when they start
+    if (ring.create(name, slots, slotSize) != 0)
+        return false;
+    if (slots < hold + 1)
+        std::cout << "Warning: with " << slots << " slots the producer has to drop frames, use at least " << hold + 1 << "." << std::endl;
+    std::cout << "Waiting for frames in the shared memory " << name << " (" << slots << " slots of " << slotSize << " bytes)." << std::endl;
+    return true;
+}
+
+bool shmSource::read(cv::Mat& img) {
+    std::shared_ptr<void> handle;
+    if (!borrow(img, handle))
+        return false;
+    // the producer may write the slot as soon as the handle is gone
+    if (handle)
+        img = img.clone();
+    return true;
+}
+
+bool shmSource::borrow(cv::Mat& img, std::shared_ptr<void>& handle) {
+    handle.reset();
+    int slot = -1;
+    uint32_t width = 0, height = 0, format = 0, stride = 0;
+    while (slot < 0) {
+        if (interrupted)
+            return false;
+        // a timeout keeps waiting, the producer may not be running yet
+        slot = ring.acquire(last, 100);
+        if (slot < 0)
+            continue;
+        // the header is written by another process, it is read once and checked as
+        // ring::publish() does, against the slot size this side created
+        const shmring::frameHeader& f = ring.getFrame(slot);
+        last = f.sequence.load(std::memory_order_acquire);
+        width = f.width;
+        height = f.height;
+        format = f.format;
+        stride = f.stride;
+        const uint64_t bytes = shmring::bytesPerPixel(format);
+        if (bytes == 0 || width == 0 || height == 0 || width > INT_MAX || height > INT_MAX
+            || stride < width * bytes || static_cast<uint64_t>(stride) * height > std::min(ring.getSlotSize(), slotSize)) {
+            if (!warned)
+                std::cerr << "Warning: skipping frames of the shared memory " << name << " that do not fit into their slot (" << width << "x" << height
+                          << ", format " << format << ", " << stride << " bytes per row)." << std::endl;
+            warned = true;
+            ring.release(slot);
+            slot = -1;
+        }
+    }
+    const int type = format == shmring::bgra ? CV_8UC4 : (format == shmring::gray ? CV_8UC1 : CV_8UC3);
+    img = cv::Mat(static_cast<int>(height), static_cast<int>(width), type, const_cast<uint8_t*>(ring.getPixels(slot)), stride);
+    if (format == shmring::gray) {
+        // the pipeline needs color, this is the only copy
+        cv::cvtColor(img, img, cv::COLOR_GRAY2BGR);
+        ring.release(slot);
+        return true;
+    }
+    // the slot stays busy until the last handle is released, from any thread
+    handle = std::shared_ptr<void>(const_cast<uint8_t*>(ring.getPixels(slot)), [this, slot](uint8_t*) { ring.release(slot); });
+    return true;
+}
+
+void shmSource::interrupt() {
+    interrupted = true;
+    if (ring.isOpen())
+        ring.wake();
+}
+
+bool rawSource::open() {
+    return file.open(fileName) == 0;
+}
+
+bool rawSource::read(cv::Mat& img) {
+    if (position >= file.getFrames())
+        return false;
+    img = file.getFrame(position++);
+    return true;
+}
+
+bool rawSource::skip() {
+    if (position >= file.getFrames())
+        return false;
+    position++;
+    return true;
+}
+
+double rawSource::getFrameRate() const {
+    const size_t n = file.getFrames();
+    if (n < 2 || file.getTimestamp(n - 1) == 0)
+        return 0;
+    return (n - 1) / (file.getTimestamp(n - 1) * 1e-9);
+}
+
+double rawSource::getFrameTime(uint64_t index) const {
+    // a loop lasts one average frame longer than the last timestamp
+    const size_t n = file.getFrames();
+    const double duration = file.getTimestamp(n - 1) * 1e-9 + 1 / getFrameRate();
+    return (index / n) * duration + file.getTimestamp(index % n) * 1e-9;
+}
+
+bool getInputType(const std::string& name, InputType& type) {
+    std::error_code fileError;
+    if (name == "camera") {
+        type = InputType::camera;
+    } else if (name == "shm" || name.compare(0, 4, "shm:") == 0) {
+        type = InputType::sharedmemory;
+    } else if (name == "screen") {
+        type = InputType::screen;
+    } else if (name == "compose") {
+        type = InputType::composite;
+    } else if (name.find('%') != std::string::npos || std::filesystem::is_directory(name, fileError)) {
+        type = InputType::sequence;
+    } else {
+        const size_t dot = name.rfind('.');
+        std::string suffix = (dot == std::string::npos) ? std::string() : name.substr(dot + 1);
+        std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+        if (suffix == "png" || suffix == "jpg" || suffix == "jpeg")
+            type = InputType::image;
+        else if (suffix == "mp4")
+            type = InputType::video;
+        else if (suffix == "raw")
+            type = InputType::replay;
+        else if (suffix == "svg")
+            type = InputType::vectorgraphic;
+        else if (suffix == "ild" || suffix == "lda")
+            type = InputType::precompiled;
+        else
+            return false;
+    }
+    return true;
+}
+
+const char* inputTypeName(InputType type) {
+    switch (type) {
+    case InputType::image: return "image";
+    case InputType::video: return "video";
+    case InputType::camera: return "camera";
+    case InputType::precompiled: return "ILDA";
+    case InputType::vectorgraphic: return "SVG";
+    case InputType::sequence: return "image sequence";
+    case InputType::screen: return "screen capture";
+    case InputType::sharedmemory: return "shared memory";
+    case InputType::replay: return "raw frames";
+    case InputType::composite: return "compositor";
+    }
+    return "unknown";
+}
+
+std::unique_ptr<source> createSource(const Parameters& parameters) {
+    return createSource(parameters, parameters.inputtype, parameters.inputFile);
+}
+
+std::unique_ptr<source> createSource(const Parameters& parameters, InputType type, const std::string& name) {
+    std::unique_ptr<source> src;
+    switch (type) {
+    case InputType::image:
+        src.reset(new imageSource(name));
+        break;
+    case InputType::video:
+        src.reset(new captureSource(name));
+        break;
+    case InputType::camera:
+        // open the default camera
+        src.reset(new captureSource(0));
+        break;
+    case InputType::sequence:
+        src.reset(new sequenceSource(name, parameters.sequenceFPS));
+        break;
+    case InputType::replay:
+        src.reset(new rawSource(name));
+        break;
+    case InputType::sharedmemory:
+        // shm or shm:/name
+        src.reset(new shmSource(name.size() > 4 ? name.substr(4) : parameters.shmName, parameters.shmSlots, parameters.shmSlotSize, parameters.prefetchDepth + 2));
+        break;
+    case InputType::screen:
+#ifdef X11_CAPTURE
+        // the prefetch ring, the frame in the render loop and the one being captured,
+        // no faster than the render loop can show them
+        src.reset(new screenSource(parameters.screenDisplay, parameters.screenArea, parameters.prefetchDepth + 2, parameters.maxFramesPerSecond));
+        break;
+#else
+        std::cerr << "Error: screen capture needs a build with X11_CAPTURE." << std::endl;
+        return NULL;
+#endif
+    default:
+        std::cerr << "Error: the input type has no image source." << std::endl;
+        return NULL;
+    }
+    if (!src->open())
+        src.reset();
+    return src;
+}
+
+prefetcher::prefetcher(std::unique_ptr<source> source, const std::array<int, 4>& crop, size_t depth, bool loop, bool paced)
+    : src(std::move(source)), crop(crop), depth(std::max<size_t>(depth, 1)), loop(loop) {
+    frameRate = src->getFrameRate();
+    // a camera delivers its frames in real time by itself
+    this->paced = paced && !src->isLive() && frameRate > 0;
+}
+
+void prefetcher::start() {
+    if (running)
+        return;
+    running = true;
+    finished = false;
+    worker = std::thread(&prefetcher::run, this);
+}
+
+void prefetcher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return;
+        running = false;
+    }
+    changed.notify_all();
+    // a source waiting for new frames would not see the stop
+    src->interrupt();
+    if (worker.joinable())
+        worker.join();
+    {
+        // the borrowed images go back to the source
+        std::lock_guard<std::mutex> lock(mutex);
+        frames.clear();
+        shown.reset();
+    }
+    if (recording.isOpen()) {
+        recording.close();
+        std::cout << "Recorded " << recording.getFrames() << " input frames";
+        if (recording.getDropped() > 0)
+            std::cout << ", " << recording.getDropped() << " dropped because the disk was too slow";
+        std::cout << "." << std::endl;
+    }
+}
+
+void prefetcher::setPause(bool pause) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pause == paused)
+        return;
+    paused = pause;
+    if (pause)
+        pausedAt = std::chrono::steady_clock::now();
+    else
+        clockStart += std::chrono::steady_clock::now() - pausedAt;
+    // the pause is not part of the render interval
+    lastNext = std::chrono::steady_clock::time_point();
+}
+
+void prefetcher::cancel() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+    }
+    changed.notify_all();
+    src->interrupt();
+}
+
+int prefetcher::record(const std::string& fileName) {
+    if (recording.open(fileName) != 0)
+        return -1;
+    std::cout << "Recording the input frames to " << fileName << std::endl;
+    return 0;
+}
+
+double prefetcher::playbackTime(double ahead) const {
+    if (!paced || !clockStarted)
+        return -1;
+    const auto now = paused ? pausedAt : std::chrono::steady_clock::now();
+    return std::max(0.0, std::chrono::duration<double>(now - clockStart).count() + ahead);
+}
+
+std::chrono::steady_clock::duration prefetcher::frameTime(uint64_t index) const {
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(src->getFrameTime(index)));
+}
+
+bool prefetcher::next(cv::Mat& img) {
+    std::unique_lock<std::mutex> lock(mutex);
+    // the consumer is done with the last frame
+    shown.reset();
+    changed.wait(lock, [&] { return !frames.empty() || finished || !running || cancelled; });
+    if (frames.empty() || cancelled)
+        return false;
+    if (src->isLive()) {
+        // only the newest frame of a camera is interesting
+        dropped += frames.size() - 1;
+        img = frames.back().img;
+        shown = std::move(frames.back().handle);
+        frames.clear();
+    } else if (paced) {
+        const auto now = std::chrono::steady_clock::now();
+        if (lastNext != std::chrono::steady_clock::time_point())
+            interval = 0.9 * interval + 0.1 * std::chrono::duration<double>(now - lastNext).count();
+        lastNext = now;
+        if (!clockStarted) {
+            // the first frame shown starts the clock
+            clockStart = now - frameTime(frames.front().index);
+            clockStarted = true;
+        }
+        // frames that have a due successor are too old
+        const double t = playbackTime();
+        while (frames.size() > 1 && src->getFrameTime(frames[1].index) <= t) {
+            frames.pop_front();
+            late++;
+        }
+        // ahead of the clock: wait until the frame is due
+        const auto at = clockStart + frameTime(frames.front().index);
+        changed.wait_until(lock, at, [&] { return !running || cancelled; });
+        img = frames.front().img;
+        shown = std::move(frames.front().handle);
+        frames.pop_front();
+    } else {
+        img = frames.front().img;
+        shown = std::move(frames.front().handle);
+        frames.pop_front();
+    }
+    changed.notify_all();
+    return true;
+}
+
+void prefetcher::run() {
+    const bool live = src->isLive();
+    // frames since the start, keeps on counting over loops
+    uint64_t index = 0;
+    while (true) {
+        double t;
+        {
+            // wait for space first, so the clock is read right before the decode
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!live) {
+                // a render loop slower than the video would find all but the last
+                // decoded frame too old, only decode for its next request
+                changed.wait(lock, [&] {
+                    return !running || (frames.size() < depth && (frames.empty() || !paced || interval * frameRate <= 1));
+                });
+            }
+            if (!running)
+                break;
+            // the frame that will be due when the render loop asks next
+            t = playbackTime(interval * frameRate > 1 ? interval : 0);
+        }
+        // behind the clock: the frames that are already too old are not decoded at all
+        bool ok = true;
+        while (ok && t >= 0 && src->getFrameTime(index + 1) <= t) {
+            ok = src->skip();
+            if (ok) {
+                index++;
+                dropped++;
+            }
+        }
+
+        // a new image for every frame, the consumer may still hold the last one
+        cv::Mat img;
+        std::shared_ptr<void> handle;
+        if (ok)
+            ok = src->borrow(img, handle);
+        if (!ok && loop && src->rewind())
+            ok = src->borrow(img, handle);
+        if (ok) {
+            // zero-copy view of the cropped region
+            img = vectorizer::crop(img, crop);
+            if (recording.isOpen()) {
+                // on the playback clock: when the frame is due, live frames when they were captured
+                const auto timestamp = (!live && frameRate > 0) ? frameTime(index) : std::chrono::steady_clock::now().time_since_epoch();
+                // the writer thread writes it later, borrowed memory is returned before
+                recording.push(handle ? img.clone() : img, std::chrono::duration_cast<std::chrono::nanoseconds>(timestamp).count());
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ok) {
+            finished = true;
+            changed.notify_all();
+            break;
+        }
+        if (!running)
+            break;
+        // never wait for the render loop with a camera, it keeps on running
+        if (live && frames.size() >= depth) {
+            frames.pop_front();
+            dropped++;
+        }
+        frames.push_back({index++, img, std::move(handle)});
+        changed.notify_all();
+    }
+}
+
+}
@@ -0,0 +1,251 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <opencv2/opencv.hpp>
+
+#include "src/parameters.h"
+#include "src/shmring.h"
+#include "src/rawframes.h"
+
+namespace input {
+    // a source of images, read() is called from the prefetch thread
+    class source {
+    public:
+        virtual ~source() {}
+        virtual bool open() = 0;
+        // decode the next frame into a new image, false at the end of the source
+        virtual bool read(cv::Mat& img) = 0;
+        // the next frame in memory of the source, e.g. a shared memory buffer, that is
+        // not reused before the handle is released. Sources without such memory read().
+        virtual bool borrow(cv::Mat& img, std::shared_ptr<void>& handle) { handle.reset(); return read(img); }
+        // advance one frame without decoding it where the source allows that
+        virtual bool skip() { cv::Mat img; return read(img); }
+        // called from another thread: a read() that waits for new data returns false
+        virtual void interrupt() {}
+        // start again from the first frame, false if that is not possible
+        virtual bool rewind() { return false; }
+        // live sources (cameras) only show their newest frame
+        virtual bool isLive() const { return false; }
+        // [1/s] native frame rate, 0 if unknown
+        virtual double getFrameRate() const { return 0; }
+        // [s] when frame index is shown after the start, counting on over loops. Only
+        // used for sources with a frame rate, called from both threads.
+        virtual double getFrameTime(uint64_t index) const { return index / getFrameRate(); }
+        // number of frames, 0 if unknown or endless
+        virtual size_t getFrameCount() const { return 0; }
+        virtual std::string getName() const = 0;
+    };
+
+    // a single image, decoded once
+    class imageSource : public source {
+    public:
+        imageSource(const std::string& fileName) : fileName(fileName) {}
+        bool open() override;
+        bool read(cv::Mat& img) override;
+        bool rewind() override { done = false; return true; }
+        size_t getFrameCount() const override { return 1; }
+        std::string getName() const override { return "image " + fileName; }
+
+    private:
+        std::string fileName;
+        cv::Mat image;
+        bool done = false;
+    };
+
+    // video files and cameras
+    class captureSource : public source {
+    public:
+        captureSource(const std::string& fileName) : fileName(fileName), device(-1) {}
+        captureSource(int device) : device(device) {}
+        bool open() override;
+        bool read(cv::Mat& img) override;
+        bool skip() override;
+        bool rewind() override;
+        bool isLive() const override { return device >= 0; }
+        double getFrameRate() const override { return frameRate; }
+        size_t getFrameCount() const override;
+        std::string getName() const override { return device >= 0 ? "camera " + std::to_string(device) : "video " + fileName; }
+
+    protected:
+        std::string fileName;
+        int device;
+        cv::VideoCapture capture;
+        // read at open, the capture is only used by the prefetch thread
+        double frameRate = 0;
+    };
+
+    // numbered images ("frames/img_%04d.png", exactly one %d, %Nd or %0Nd and %% for
+    // a percent sign) or all images of a directory in alphabetical order, decoded in
+    // parallel ahead of read()
+    class sequenceSource : public source {
+    public:
+        sequenceSource(const std::string& pattern, double frameRate = 0, unsigned threads = 0)
+            : pattern(pattern), frameRate(frameRate), threads(threads) {}
+        bool open() override;
+        bool read(cv::Mat& img) override;
+        bool skip() override;
+        bool rewind() override;
+        double getFrameRate() const override { return frameRate; }
+        size_t getFrameCount() const override { return files.size(); }
+        std::string getName() const override { return "sequence " + pattern; }
+
+    private:
+        void schedule();
+
+        std::string pattern;
+        double frameRate;
+        unsigned threads;
+        std::vector<std::string> files;
+        size_t nextFile = 0;
+        std::deque<std::future<cv::Mat>> pending;
+    };
+
+    // frames published by other processes into a shared memory ring (see shmring.h).
+    // borrow() uses them in place without copying, the producer does not write the
+    // slot before the handle is released; read() copies. Up to hold frames are
+    // borrowed at a time, the producer needs one slot more.
+    class shmSource : public source {
+    public:
+        shmSource(const std::string& name, uint32_t slots, uint64_t slotSize, size_t hold)
+            : name(name), slots(slots), slotSize(slotSize), hold(hold) {}
+        bool open() override;
+        bool read(cv::Mat& img) override;
+        bool borrow(cv::Mat& img, std::shared_ptr<void>& handle) override;
+        void interrupt() override;
+        bool isLive() const override { return true; }
+        std::string getName() const override { return "shared memory " + name; }
+
+    private:
+        std::string name;
+        uint32_t slots;
+        uint64_t slotSize;
+        size_t hold;
+        shmring::ring ring;
+        uint64_t last = 0;
+        std::atomic<bool> interrupted{false};
+        // about a frame that does not fit into its slot
+        bool warned = false;
+    };
+
+    // bit-exact replay of input frames recorded with prefetcher::record(), straight
+    // from the mapped file, at the recorded timing
+    class rawSource : public source {
+    public:
+        rawSource(const std::string& fileName) : fileName(fileName) {}
+        bool open() override;
+        bool read(cv::Mat& img) override;
+        bool skip() override;
+        bool rewind() override { position = 0; return true; }
+        double getFrameRate() const override;
+        double getFrameTime(uint64_t index) const override;
+        size_t getFrameCount() const override { return file.getFrames(); }
+        std::string getName() const override { return "raw frames " + fileName; }
+
+    private:
+        std::string fileName;
+        rawframes::reader file;
+        size_t position = 0;
+    };
+
+    // the input type of a file name (by its suffix, a % pattern or a directory) or of camera,
+    // screen, shm[:/name] and compose. False if it is unknown.
+    bool getInputType(const std::string& name, InputType& type);
+    // e.g. "image sequence", for messages
+    const char* inputTypeName(InputType type);
+
+    // the source for the input of the parameters, opened. NULL on errors.
+    std::unique_ptr<source> createSource(const Parameters& parameters);
+    // the same for another input with the settings of the parameters
+    std::unique_ptr<source> createSource(const Parameters& parameters, InputType type, const std::string& name);
+
+    // decodes and crops ahead of the render loop in a background thread, so the
+    // decoding does not show up in the frame time. Sources with a frame rate are
+    // paced against the wall clock: frames that are due are shown, frames that are
+    // already too old are skipped without decoding.
+    class prefetcher {
+    public:
+        prefetcher(std::unique_ptr<source> src, const std::array<int, 4>& crop, size_t depth = 4, bool loop = true, bool paced = true);
+        ~prefetcher() { stop(); }
+
+        void start();
+        void stop();
+
+        // the next frame in order, the newest frame for live sources. Waits only if
+        // no frame is decoded yet, false at the end of a source that does not loop.
+        // Paced sources wait until the frame is due and return the newest due frame.
+        // The image may be borrowed from the source, it is valid until the following
+        // next() or stop().
+        bool next(cv::Mat& img);
+
+        // stops the playback clock
+        void setPause(bool pause);
+
+        // ends a waiting and all later next() with false, safe from any thread,
+        // e.g. on a signal. stop() still has to be called.
+        void cancel();
+
+        // writes every frame after the crop with its time on the playback clock to a
+        // raw frame file for a later replay, from a background thread. Call before start().
+        int record(const std::string& fileName);
+
+        source& getSource() { return *src; }
+        bool isPaced() const { return paced; }
+        // frames that were never shown without being decoded: skipped behind the
+        // clock or replaced by a newer camera frame
+        uint64_t getDropped() const { return dropped; }
+        // decoded frames that were already too old when the render loop asked
+        uint64_t getLate() const { return late; }
+
+    private:
+        struct entry {
+            uint64_t index;
+            cv::Mat img;
+            // of a borrowed image
+            std::shared_ptr<void> handle;
+        };
+
+        void run();
+        // [s] position of the playback clock in ahead seconds, -1 before the first
+        // frame was shown or if the source is not paced
+        double playbackTime(double ahead = 0) const;
+        std::chrono::steady_clock::duration frameTime(uint64_t index) const;
+
+        std::unique_ptr<source> src;
+        std::array<int, 4> crop;
+        size_t depth;
+        bool loop;
+        bool paced;
+        double frameRate;
+
+        std::thread worker;
+        mutable std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<entry> frames;
+        // of the frame the consumer works on
+        std::shared_ptr<void> shown;
+        bool running = false;
+        bool finished = false;
+        bool cancelled = false;
+        // playback clock: time at which frame 0 was due and start of the pause
+        std::chrono::steady_clock::time_point clockStart, pausedAt;
+        bool clockStarted = false;
+        bool paused = false;
+        // [s] average time between the calls of next()
+        std::chrono::steady_clock::time_point lastNext;
+        double interval = 0;
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> late{0};
+        rawframes::recorder recording;
+    };
+}
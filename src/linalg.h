@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <initializer_list>
+#include <Eigen/Dense>
+
+// Dense matrices with one contiguous row major buffer, the products and the least
+// squares solves are done by Eigen on a mapping of that buffer, without copying.
+// Same interface as math::matrix of the GameLibrary, which keeps every row in an
+// allocation of its own.
+namespace linalg {
+    template<typename T>
+    class matrix {
+    public:
+        typedef Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> eigenMatrix;
+
+        matrix() {}
+        matrix(size_t rows, size_t cols, T value = 0) : m(rows), n(cols), values(rows * cols, value) {}
+        matrix(std::initializer_list<std::initializer_list<T>> rows) {
+            for (const auto& row : rows)
+                push_back(row);
+        }
+
+        size_t rows() const { return m; }
+        size_t cols() const { return n; }
+        T& operator()(size_t i, size_t j) { return values[i * n + j]; }
+        const T& operator()(size_t i, size_t j) const { return values[i * n + j]; }
+        T* data() { return values.data(); }
+        const T* data() const { return values.data(); }
+
+        // appends a row, the first row sets the number of columns
+        void push_back(std::initializer_list<T> row) { push_back(row.begin(), row.size()); }
+        void push_back(const std::vector<T>& row) { push_back(row.data(), row.size()); }
+
+        Eigen::Map<eigenMatrix> map() { return Eigen::Map<eigenMatrix>(values.data(), m, n); }
+        Eigen::Map<const eigenMatrix> map() const { return Eigen::Map<const eigenMatrix>(values.data(), m, n); }
+
+        matrix operator*(const matrix& other) const {
+            matrix r(m, other.n);
+            r.map().noalias() = map() * other.map();
+            return r;
+        }
+
+    private:
+        void push_back(const T* row, size_t size) {
+            if (m == 0)
+                n = size;
+            // short rows are padded with zeros, long rows are cut
+            values.resize((m + 1) * n, 0);
+            std::copy(row, row + std::min(size, n), values.begin() + m * n);
+            m++;
+        }
+
+        size_t m = 0;
+        size_t n = 0;
+        std::vector<T> values;
+    };
+
+    // least squares solution x of A * x = b
+    template<typename T>
+    std::vector<T> linFit(const std::vector<T>& b, const matrix<T>& A) {
+        typedef Eigen::Matrix<T, Eigen::Dynamic, 1> eigenVector;
+        std::vector<T> x(A.cols());
+        Eigen::Map<eigenVector>(x.data(), x.size()) =
+            A.map().colPivHouseholderQr().solve(Eigen::Map<const eigenVector>(b.data(), b.size()));
+        return x;
+    }
+
+    // coefficients c0 + c1 * x + ... + cn * x^n of the polynomial of the given degree
+    // through the points, one point (x, y) per row
+    template<typename T>
+    std::vector<T> polyFit(const matrix<T>& points, size_t degree) {
+        matrix<T> A(points.rows(), degree + 1);
+        std::vector<T> b(points.rows());
+        for (size_t i = 0; i < points.rows(); ++i) {
+            T p = 1;
+            for (size_t j = 0; j <= degree; ++j) {
+                A(i, j) = p;
+                p *= points(i, 0);
+            }
+            b[i] = points(i, 1);
+        }
+        return linFit(b, A);
+    }
+}
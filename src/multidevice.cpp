@@ -0,0 +1,350 @@
+#include "src/multidevice.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+
+#include "src/trace.h"
+
+namespace output {
+
+namespace {
+    // where the points of a frame are stored
+    typedef std::array<const void*, 5> storage;
+
+    storage getStorage(const laser::frame& f) {
+        return {f.x.data(), f.y.data(), f.r.data(), f.g.data(), f.b.data()};
+    }
+
+    // locks the vectors of the frame into memory that moved away from before, i.e. that
+    // were allocated or grown since
+    void lockMoved(const laser::frame& f, const storage& before) {
+        const storage now = getStorage(f);
+        if (now[0] != before[0])
+            realtime::lockMemory(f.x.data(), f.x.capacity() * sizeof(int16_t));
+        if (now[1] != before[1])
+            realtime::lockMemory(f.y.data(), f.y.capacity() * sizeof(int16_t));
+        if (now[2] != before[2])
+            realtime::lockMemory(f.r.data(), f.r.capacity());
+        if (now[3] != before[3])
+            realtime::lockMemory(f.g.data(), f.g.capacity());
+        if (now[4] != before[4])
+            realtime::lockMemory(f.b.data(), f.b.capacity());
+    }
+
+    // Liang-Barsky clipping of the segment a -> b against [x0, x1] x [y0, y1]
+    bool clipSegment(float& ax, float& ay, float& bx, float& by, float x0, float y0, float x1, float y1) {
+        float t0 = 0, t1 = 1;
+        const float dx = bx - ax, dy = by - ay;
+        const float p[4] = {-dx, dx, -dy, dy};
+        const float q[4] = {ax - x0, x1 - ax, ay - y0, y1 - ay};
+        for (int i = 0; i < 4; ++i) {
+            if (p[i] == 0) {
+                if (q[i] < 0)
+                    return false;
+            } else {
+                float t = q[i] / p[i];
+                if (p[i] < 0)
+                    t0 = std::max(t0, t);
+                else
+                    t1 = std::min(t1, t);
+                if (t0 > t1)
+                    return false;
+            }
+        }
+        const float sx = ax, sy = ay;
+        ax = sx + t0 * dx;
+        ay = sy + t0 * dy;
+        bx = sx + t1 * dx;
+        by = sy + t1 * dy;
+        return true;
+    }
+}
+
+void splitFrame(const laser::frame& points, const region& r, laser::frame& result) {
+    result.clear();
+    result.width = points.width;
+    result.height = points.height;
+    result.sequence = points.sequence;
+    // replicate, device coordinates have no frame size to take the region from
+    if ((r[0] <= 0 && r[1] <= 0 && r[2] >= 1 && r[3] >= 1) || points.width == 0) {
+        result.append(points);
+        return;
+    }
+
+    const float x0 = r[0] * points.width, y0 = r[1] * points.height;
+    const float x1 = r[2] * points.width, y1 = r[3] * points.height;
+    const float sx = points.width / std::max(x1 - x0, 1.0f);
+    const float sy = points.height / std::max(y1 - y0, 1.0f);
+    bool hasLast = false;
+    int lastX = 0, lastY = 0;
+    for (size_t i = 1; i < points.size(); ++i) {
+        // blank moves are regenerated below
+        if (points.isBlank(i))
+            continue;
+        float ax = points.x[i - 1], ay = points.y[i - 1], bx = points.x[i], by = points.y[i];
+        if (!clipSegment(ax, ay, bx, by, x0, y0, x1, y1))
+            continue;
+        const int sax = std::lround((ax - x0) * sx), say = std::lround((ay - y0) * sy);
+        const int sbx = std::lround((bx - x0) * sx), sby = std::lround((by - y0) * sy);
+        const int red = points.r[i], green = points.g[i], blue = points.b[i];
+        if (!hasLast || sax != lastX || say != lastY) {
+            // blank move to the start of the visible part
+            if (hasLast)
+                result.push(lastX, lastY, 0, 0, 0);
+            result.push(sax, say, 0, 0, 0);
+            result.push(sax, say, red, green, blue);
+        }
+        result.push(sbx, sby, red, green, blue);
+        lastX = sbx;
+        lastY = sby;
+        hasLast = true;
+    }
+}
+
+void deviceGroup::addDevice(std::unique_ptr<backend> dac, const region& r) {
+    std::unique_ptr<device> d(new device());
+    d->dac = std::move(dac);
+    d->r = r;
+    devices.push_back(std::move(d));
+}
+
+void deviceGroup::enableRecording(const recorderParameters& parameters) {
+    for (size_t i = 0; i < devices.size(); ++i) {
+        std::string fileName = parameters.file;
+        if (devices.size() > 1) {
+            const size_t dot = fileName.rfind('.');
+            const std::string suffix = "-" + std::to_string(i);
+            fileName = (dot == std::string::npos) ? fileName + suffix : fileName.substr(0, dot) + suffix + fileName.substr(dot);
+        }
+        devices[i]->rec.reset(new recorder(fileName, parameters));
+    }
+}
+
+void deviceGroup::start() {
+    if (running)
+        return;
+    running = true;
+    for (auto& d : devices)
+        if (d->rec && d->rec->start() != 0)
+            d->rec.reset();
+    for (auto& d : devices)
+        d->worker = std::thread(&deviceGroup::run, this, std::ref(*d));
+}
+
+void deviceGroup::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return;
+        running = false;
+    }
+    frameReady.notify_all();
+    framePrepared.notify_all();
+    frameSent.notify_all();
+    for (auto& d : devices) {
+        if (d->worker.joinable())
+            d->worker.join();
+        d->dac->stop();
+        if (d->rec)
+            d->rec->stop();
+    }
+}
+
+void deviceGroup::present(const laser::frame& points) {
+    std::shared_ptr<laser::frame> f;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        f.swap(recycled);
+    }
+    // the workers only take the current frame, so nobody can grab the recycled one meanwhile
+    if (!f || f.use_count() > 1)
+        f = std::make_shared<laser::frame>(rt.lockMemory ? rt.bufferPoints : 0);
+    else
+        std::atomic_thread_fence(std::memory_order_acquire); // pairs with the release of the last worker
+    // reuses the capacity of the recycled frame
+    const storage before = rt.lockMemory ? getStorage(*f) : storage();
+    *f = points;
+    // the device threads read the frame
+    if (rt.lockMemory)
+        lockMoved(*f, before);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        recycled = frame;
+        frame = f;
+        generation++;
+        presented = std::chrono::steady_clock::now();
+    }
+    frameReady.notify_all();
+}
+
+bool deviceGroup::allPrepared(uint64_t g) const {
+    for (auto& d : devices)
+        if (d->prepared < g)
+            return false;
+    return true;
+}
+
+bool deviceGroup::allSent(uint64_t g) const {
+    for (auto& d : devices)
+        if (d->sent < g)
+            return false;
+    return true;
+}
+
+bool deviceGroup::flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    const uint64_t g = generation;
+    frameSent.wait_for(lock, timeout, [&]{ return !running || allSent(g); });
+    return allSent(g);
+}
+
+void deviceGroup::run(device& d) {
+    typedef std::chrono::steady_clock clock;
+    // the failures are reported, the device runs on without
+    realtime::pinThread(rt.outputCPUs);
+    realtime::setPriority(rt.outputPriority);
+    if (rt.lockMemory) {
+        d.buffer.reserve(rt.bufferPoints);
+        lockMoved(d.buffer, storage());
+    }
+
+    uint64_t done = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        const auto idle = clock::now();
+        frameReady.wait(lock, [&]{ return !running || generation > done; });
+        if (!running)
+            break;
+        const uint64_t g = generation;
+        if (done != 0 && g > done + 1)
+            d.dropped += g - done - 1;
+        std::shared_ptr<const laser::frame> f = frame;
+        // a frame that arrived while the device was busy is due from the end of the frame before
+        const auto due = std::max(presented, idle);
+        lock.unlock();
+
+        // every device works on its own copy
+        const storage before = rt.lockMemory ? getStorage(d.buffer) : storage();
+        splitFrame(*f, d.r, d.buffer);
+        if (f->width != 0) {
+            if (f->width != d.projWidth || f->height != d.projHeight) {
+                d.proj = geometry::projection::toDevice(f->width, f->height) * geometry::projection::fromLayout(d.dac->getLayout(), f->width, f->height);
+                d.projWidth = f->width;
+                d.projHeight = f->height;
+            }
+            d.proj.apply(d.buffer);
+            color::apply(d.dac->getColorTable(), d.buffer);
+        }
+        if (rt.lockMemory)
+            lockMoved(d.buffer, before);
+
+        lock.lock();
+        d.prepared = g;
+        framePrepared.notify_all();
+        // present synchronously with the other devices, but do not wait forever for a slow one
+        if (!framePrepared.wait_for(lock, syncTimeout, [&]{ return !running || allPrepared(g); }))
+            d.syncMisses++;
+        if (!running)
+            break;
+        lock.unlock();
+
+        if (d.rec)
+            d.rec->push(d.buffer);
+        {
+            trace::scope span(d.buffer.sequence, trace::submit);
+            d.dac->sendFrame(d.buffer, scanSpeed);
+        }
+        // the deadline holds up to the acknowledgement of the DAC, all waiting included
+        const std::chrono::duration<double, std::milli> latency = clock::now() - due;
+        d.maxLatency = std::max(d.maxLatency, latency.count());
+        const double deadline = rt.deadline != 0 ? rt.deadline : 2000.0 * d.buffer.size() / std::max(scanSpeed, 1) + 2;
+        if (rt.deadline >= 0 && latency.count() > deadline)
+            d.deadlineMisses++;
+        done = g;
+        lock.lock();
+        d.sent = g;
+        frameSent.notify_all();
+    }
+}
+
+void deviceGroup::printStatistics(std::ostream& os) const {
+    for (size_t i = 0; i < devices.size(); ++i) {
+        os << "Device " << i << ": " << devices[i]->dropped << " frames dropped, " << devices[i]->syncMisses << " sync misses, ";
+        os << devices[i]->deadlineMisses.load() << " deadline misses (longest " << devices[i]->maxLatency << " ms)." << std::endl;
+        devices[i]->dac->printStatistics(os);
+        if (devices[i]->rec)
+            devices[i]->rec->printStatistics(os);
+    }
+}
+
+uint64_t deviceGroup::getDeadlineMisses() const {
+    uint64_t misses = 0;
+    for (auto& d : devices)
+        misses += d->deadlineMisses.load();
+    return misses;
+}
+
+namespace {
+    // global layout and color correction, overwritten by the device's own settings
+    void setupDevice(const libconfig::Setting& root, const libconfig::Setting* device, backend& dac) {
+        color::correction corr;
+        geometry::layout l;
+        if (root.exists("lumax")) {
+            if (root["lumax"].exists("color-correction"))
+                color::getCorrection(root["lumax"]["color-correction"], corr);
+            if (root["lumax"].exists("layout"))
+                geometry::getLayout(root["lumax"]["layout"], l);
+        }
+        if (device != NULL && device->exists("color-correction"))
+            color::getCorrection((*device)["color-correction"], corr);
+        if (device != NULL && device->exists("layout"))
+            geometry::getLayout((*device)["layout"], l);
+        dac.setColorTable(color::buildLookupTable(corr));
+        dac.setLayout(l);
+    }
+}
+
+int createDeviceGroup(const std::string& type, const libconfig::Config& config, deviceGroup& group) {
+    const libconfig::Setting& root = config.getRoot();
+    if (!root.exists("lumax") || !root["lumax"].exists("devices")) {
+        std::unique_ptr<backend> dac;
+        if (createBackend(type, config, dac) != 0)
+            return -1;
+        if (dac) {
+            setupDevice(root, NULL, *dac);
+            group.addDevice(std::move(dac));
+        }
+        return 0;
+    }
+
+    const libconfig::Setting& devices = root["lumax"]["devices"];
+    for (int i = 0; i < devices.getLength(); ++i) {
+        const libconfig::Setting& settings = devices[i];
+        int card = i + 1;
+        std::string deviceType = type;
+        settings.lookupValue("card", card);
+        settings.lookupValue("backend", deviceType);
+
+        std::unique_ptr<backend> dac;
+        if (createBackend(deviceType, config, dac, card) != 0)
+            return -1;
+        if (!dac)
+            continue;
+
+        setupDevice(root, &settings, *dac);
+
+        region r = {0, 0, 1, 1};
+        if (settings.exists("region") && settings["region"].getLength() == 4) {
+            for (int k = 0; k < 4; ++k)
+                r[k] = settings["region"][k];
+        }
+        std::cout << "Device " << group.size() << ": " << dac->getName() << " (card " << card << "), region (";
+        std::cout << r[0] << ", " << r[1] << ", " << r[2] << ", " << r[3] << ")" << std::endl;
+        group.addDevice(std::move(dac), r);
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include <ostream>
+#include <libconfig.h++>
+
+#include "src/pointframe.h"
+#include "src/output.h"
+#include "src/geometry.h"
+#include "src/recorder.h"
+#include "src/realtime.h"
+
+namespace output {
+    // part of the frame a device shows, normalized to [0, 1] (x0, y0, x1, y1).
+    // The default covers the full frame, i.e. the frame is replicated.
+    typedef std::array<float, 4> region;
+
+    // clip the point path to the region and stretch the region to the full frame
+    void splitFrame(const laser::frame& points, const region& r, laser::frame& result);
+
+    // drives several devices from one frame. Every device has its own worker thread
+    // and point buffer, a slow device does not hold back the others for longer than
+    // the sync timeout.
+    class deviceGroup {
+    public:
+        deviceGroup(int scanSpeed = 20000, std::chrono::milliseconds syncTimeout = std::chrono::milliseconds(50))
+            : scanSpeed(scanSpeed), syncTimeout(syncTimeout) {}
+        ~deviceGroup() { stop(); }
+
+        void addDevice(std::unique_ptr<backend> dac, const region& r = {0, 0, 1, 1});
+        // record the final frames of every device, with more than one device the
+        // device number is appended to the file name. Call before start().
+        void enableRecording(const recorderParameters& parameters);
+        // CPUs, scheduler and locked buffers of the device threads and their deadline.
+        // Call before start().
+        void setRealtime(const realtime::realtimeParameters& parameters) { rt = parameters; }
+        size_t size() const { return devices.size(); }
+        backend& getDevice(size_t i) { return *devices[i]->dac; }
+
+        void start();
+        void stop();
+        // hand a new frame to all devices, does not block on the devices. Frames in pixel
+        // coordinates get the region, layout and color correction of every device, frames
+        // already in device coordinates (width 0, e.g. from an ILDA file) are sent as they are.
+        void present(const laser::frame& points);
+        // waits until every device has sent the frame presented last, false on the timeout
+        bool flush(std::chrono::milliseconds timeout);
+        void printStatistics(std::ostream& os) const;
+        // frames of all devices acknowledged by their DAC later than the deadline after present()
+        uint64_t getDeadlineMisses() const;
+
+    private:
+        struct device {
+            std::unique_ptr<backend> dac;
+            region r;
+            std::thread worker;
+            laser::frame buffer;
+            std::unique_ptr<recorder> rec;
+            // layout and device coordinates compiled for the current frame size
+            geometry::projection proj;
+            int projWidth = 0;
+            int projHeight = 0;
+            uint64_t prepared = 0;
+            // generation handed to the DAC last
+            uint64_t sent = 0;
+            // frames that were replaced by a newer frame before the device got to them
+            uint64_t dropped = 0;
+            // frames presented without waiting for all other devices
+            uint64_t syncMisses = 0;
+            // frames sent later than the deadline, read by other threads while running
+            std::atomic<uint64_t> deadlineMisses{0};
+            // [ms] longest time from present() (or the end of the frame before) until sent
+            double maxLatency = 0;
+        };
+
+        void run(device& d);
+        bool allPrepared(uint64_t generation) const;
+        bool allSent(uint64_t generation) const;
+
+        int scanSpeed;
+        std::chrono::milliseconds syncTimeout;
+        realtime::realtimeParameters rt;
+        std::vector<std::unique_ptr<device>> devices;
+
+        std::mutex mutex;
+        std::condition_variable frameReady;
+        std::condition_variable framePrepared;
+        std::condition_variable frameSent;
+        std::shared_ptr<laser::frame> frame;
+        // the frame before, reused by present() once no device holds it anymore
+        std::shared_ptr<laser::frame> recycled;
+        uint64_t generation = 0;
+        std::chrono::steady_clock::time_point presented;
+        bool running = false;
+    };
+
+    // create all devices listed in lumax.devices (or a single device if there is no list)
+    // with their own layout, color correction and region
+    int createDeviceGroup(const std::string& type, const libconfig::Config& config, deviceGroup& group);
+}
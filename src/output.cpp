@@ -0,0 +1,207 @@
+#include "src/output.h"
+
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+
+namespace output {
+
+void backend::printStatistics(std::ostream& os) const {
+    os << "Output " << getName() << ": " << stats.frames << " frames, " << stats.points << " points, ";
+    os << stats.underruns << " underruns (" << stats.underrunTime * 1000 << "ms starved), ";
+    os << stats.blockedTime * 1000 << "ms blocked." << std::endl;
+}
+
+#ifdef LUMAX_OUTPUT
+bool lumaxBackend::open() {
+    handle = Lumax_OpenDevice(cardNumber, 0);
+    std::cout << "Lumax_OpenDevice returned handle: 0x" << std::hex << (unsigned long)handle << std::dec << std::endl;
+    return handle != NULL;
+}
+
+void lumaxBackend::stop() {
+    if (handle != NULL)
+        Lumax_StopFrame(handle);
+}
+
+void lumaxBackend::close() {
+    if (handle != NULL) {
+        Lumax_CloseDevice(handle);
+        handle = NULL;
+    }
+}
+
+int lumaxBackend::sendFrame(const laser::frame& points, int scanSpeed) {
+    auto start = std::chrono::steady_clock::now();
+    // signed device coordinates and 8 bit colors -> unsigned 16 bit channels
+    const size_t n = points.size();
+    native.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        TLumax_Point& p = native[i];
+        p.Ch1 = static_cast<uint16_t>(points.x[i] + 32768);
+        p.Ch2 = static_cast<uint16_t>(points.y[i] + 32768);
+        p.Ch3 = static_cast<uint16_t>(points.r[i] << 8);
+        p.Ch4 = static_cast<uint16_t>(points.g[i] << 8);
+        p.Ch5 = static_cast<uint16_t>(points.b[i] << 8);
+        p.Ch6 = p.Ch7 = p.Ch8 = p.TTL = 0;
+    }
+
+    int timeToWait = 0, bufferChanged = 0;
+    Lumax_WaitForBuffer(handle, 100, &timeToWait, &bufferChanged);
+    int ret = Lumax_SendFrame(handle, native.data(), static_cast<int>(n), scanSpeed, 0, &timeToWait);
+
+    stats.blockedTime += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.frames++;
+    stats.points += n;
+    return ret;
+}
+#endif
+
+simulatedBackend::clock::time_point simulatedBackend::now() const {
+    return parameters.realTime ? clock::now() : virtualNow;
+}
+
+void simulatedBackend::waitUntil(clock::time_point t) {
+    if (parameters.realTime)
+        std::this_thread::sleep_until(t);
+    else if (t > virtualNow)
+        virtualNow = t;
+}
+
+bool simulatedBackend::open() {
+    virtualNow = clock::now();
+    returned = clock::time_point();
+    playbackEnd = now();
+    playing = false;
+    return true;
+}
+
+void simulatedBackend::stop() {
+    playbackEnd = now();
+    playing = false;
+}
+
+void simulatedBackend::close() {
+    if (parameters.streamFile != std::string() && !writeStream(parameters.streamFile))
+        std::cerr << "Error while writing the point stream to " << parameters.streamFile << "." << std::endl;
+}
+
+int simulatedBackend::sendFrame(const laser::frame& points, int scanSpeed) {
+    typedef std::chrono::duration<double> seconds;
+    // the virtual clock also runs while the caller renders the next frame, a slow caller
+    // starves the device as it would the hardware
+    if (!parameters.realTime && returned != clock::time_point()) {
+        if (parameters.renderTime >= 0)
+            virtualNow += std::chrono::duration_cast<clock::duration>(seconds(parameters.renderTime));
+        else
+            virtualNow += clock::now() - returned;
+    }
+    const clock::time_point arrival = now();
+    const int n = static_cast<int>(points.size());
+    scanSpeed = std::max(scanSpeed, 1);
+
+    // the device played everything it had before this frame arrived
+    if (playing && arrival > playbackEnd) {
+        stats.underruns++;
+        stats.underrunTime += seconds(arrival - playbackEnd).count();
+    }
+    if (arrival > playbackEnd)
+        playbackEnd = arrival;
+
+    // wait until the frame fits into the device buffer (or the buffer is empty)
+    const int bufferSize = std::max(parameters.bufferSize, 1);
+    double queued = seconds(playbackEnd - arrival).count() * scanSpeed;
+    if (queued > 0 && queued + n > bufferSize) {
+        double excess = std::min<double>(queued + n - bufferSize, queued);
+        waitUntil(arrival + std::chrono::duration_cast<clock::duration>(seconds(excess / scanSpeed)));
+    }
+
+    // the USB transfer itself
+    double transfer = parameters.usbLatency + static_cast<double>(n) * parameters.bytesPerPoint / parameters.usbBandwidth;
+    const clock::time_point transferred = now() + std::chrono::duration_cast<clock::duration>(seconds(transfer));
+    waitUntil(transferred);
+    stats.blockedTime += seconds(now() - arrival).count();
+
+    // points start playing once transferred and once the queued points are done
+    playbackEnd = std::max(playbackEnd, transferred) + std::chrono::duration_cast<clock::duration>(seconds(static_cast<double>(n) / scanSpeed));
+    playing = n > 0;
+
+    if (parameters.maxRecordedPoints > 0 && stream.size() + n <= parameters.maxRecordedPoints) {
+        frameOffsets.push_back(stream.size());
+        stream.append(points);
+    }
+
+    stats.frames++;
+    stats.points += n;
+    returned = clock::now();
+    return 0;
+}
+
+bool simulatedBackend::writeStream(const std::string& fileName) const {
+    std::ofstream file(fileName);
+    if (!file.is_open())
+        return false;
+    file << "frame,x,y,r,g,b" << std::endl;
+    for (size_t f = 0; f < frameOffsets.size(); ++f) {
+        size_t end = (f + 1 < frameOffsets.size() ? frameOffsets[f + 1] : stream.size());
+        for (size_t i = frameOffsets[f]; i < end; ++i)
+            file << f << "," << stream.x[i] << "," << stream.y[i] << "," << (int)stream.r[i] << "," << (int)stream.g[i] << "," << (int)stream.b[i] << "\n";
+    }
+    return true;
+}
+
+void getSimulationParameters(const libconfig::Config& config, simulationParameters& parameters) {
+    const libconfig::Setting& root = config.getRoot();
+    try {
+        const libconfig::Setting& simulation = root["output"]["simulation"];
+        double usbLatency = parameters.usbLatency * 1.0e6;
+        unsigned int maxRecordedPoints = static_cast<unsigned int>(parameters.maxRecordedPoints);
+        simulation.lookupValue("bufferSize", parameters.bufferSize);
+        // given in microseconds in the config file
+        if (simulation.lookupValue("usbLatency", usbLatency))
+            parameters.usbLatency = usbLatency / 1.0e6;
+        simulation.lookupValue("usbBandwidth", parameters.usbBandwidth);
+        simulation.lookupValue("bytesPerPoint", parameters.bytesPerPoint);
+        simulation.lookupValue("realTime", parameters.realTime);
+        // given in milliseconds in the config file
+        double renderTime = parameters.renderTime * 1.0e3;
+        if (simulation.lookupValue("renderTime", renderTime))
+            parameters.renderTime = renderTime < 0 ? -1 : renderTime / 1.0e3;
+        if (simulation.lookupValue("maxRecordedPoints", maxRecordedPoints))
+            parameters.maxRecordedPoints = maxRecordedPoints;
+        simulation.lookupValue("streamFile", parameters.streamFile);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+}
+
+int createBackend(const std::string& type, const libconfig::Config& config, std::unique_ptr<backend>& dac, int card) {
+    dac.reset();
+    if (type == "simulated") {
+        simulationParameters parameters;
+        getSimulationParameters(config, parameters);
+        dac.reset(new simulatedBackend(parameters));
+    } else if (type == "lumax") {
+#ifdef LUMAX_OUTPUT
+        int NumOfCards = Lumax_GetPhysicalDevices();
+        std::cout << "Number of MiniLumax devices: " <<  NumOfCards << std::endl;
+        if (NumOfCards < card)
+            return 0;
+        dac.reset(new lumaxBackend(card));
+#else
+        std::cerr << "Compiled without Lumax support." << std::endl;
+        return 0;
+#endif
+    } else {
+        std::cerr << "Error: unknown output backend " << type << "." << std::endl;
+        return -1;
+    }
+
+    if (!dac->open()) {
+        std::cerr << "I/O Error while opening the " << dac->getName() << " device." << std::endl;
+        dac.reset();
+        return -1;
+    }
+    return 0;
+}
+
+}
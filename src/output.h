@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+#include <cstdint>
+#include <ostream>
+#include <libconfig.h++>
+
+#include "GameLibrary/renderer.h"
+#include "src/pointframe.h"
+#include "src/color.h"
+#include "src/geometry.h"
+
+namespace output {
+    // statistics every backend keeps about the frames it was handed
+    struct statistics {
+        uint64_t frames = 0;
+        uint64_t points = 0;
+        // the device ran out of points before the next frame arrived
+        uint64_t underruns = 0;
+        // [s] total time the device was starved
+        double underrunTime = 0;
+        // [s] total time sendFrame() blocked waiting for buffer space or the transfer
+        double blockedTime = 0;
+    };
+
+    // interface for everything that can take a frame of laser points
+    class backend {
+    public:
+        virtual ~backend() {}
+        virtual bool open() = 0;
+        virtual void stop() = 0;
+        virtual void close() = 0;
+        // hand a frame in device coordinates to the device, blocks as long as the device would
+        virtual int sendFrame(const laser::frame& points, int scanSpeed) = 0;
+        virtual std::string getName() const = 0;
+
+        // color correction of this device, applied to the frame before sendFrame()
+        virtual void setColorTable(const color::lookupTable& table) { colorTable = table; }
+        const color::lookupTable& getColorTable() const { return colorTable; }
+        // output geometry of this device, applied to the frame before sendFrame()
+        virtual void setLayout(const geometry::layout& l) { deviceLayout = l; }
+        const geometry::layout& getLayout() const { return deviceLayout; }
+
+        const statistics& getStatistics() const { return stats; }
+        void printStatistics(std::ostream& os) const;
+
+    protected:
+        statistics stats;
+        color::lookupTable colorTable = color::identityTable();
+        geometry::layout deviceLayout;
+    };
+
+#ifdef LUMAX_OUTPUT
+    // MiniLumax hardware
+    class lumaxBackend : public backend {
+    public:
+        lumaxBackend(int cardNumber = 1) : cardNumber(cardNumber) {}
+        ~lumaxBackend() { close(); }
+        bool open() override;
+        void stop() override;
+        void close() override;
+        int sendFrame(const laser::frame& points, int scanSpeed) override;
+        std::string getName() const override { return "lumax"; }
+
+    private:
+        int cardNumber;
+        void* handle = NULL;
+        // native points, reused for every frame
+        std::vector<TLumax_Point> native;
+    };
+#endif
+
+    // timing parameters of the simulated DAC, defaults are close to a MiniLumax
+    struct simulationParameters {
+        // number of points the device can buffer
+        int bufferSize = 16384;
+        // [s] fixed cost of one USB transfer
+        double usbLatency = 0.001;
+        // [bytes/s] usable USB bandwidth
+        double usbBandwidth = 1.0e6;
+        // size of one point on the wire (9 16 bit channels)
+        int bytesPerPoint = 18;
+        // sleep like the hardware would, otherwise advance a virtual clock
+        bool realTime = true;
+        // [s] time the caller spends between two frames (rendering, preparing), only for
+        // the virtual clock; < 0 advances it by the wall time between two sendFrame() calls
+        double renderTime = -1;
+        // keep a copy of every point sent, 0 disables recording
+        size_t maxRecordedPoints = 0;
+        // write the recorded stream to this file when the device is closed
+        std::string streamFile;
+    };
+
+    // software model of a DAC: buffer fill level, point rate and USB latency
+    class simulatedBackend : public backend {
+    public:
+        simulatedBackend(const simulationParameters& parameters = simulationParameters()) : parameters(parameters) {}
+        bool open() override;
+        void stop() override;
+        void close() override;
+        int sendFrame(const laser::frame& points, int scanSpeed) override;
+        std::string getName() const override { return "simulated"; }
+
+        // the recorded point stream and the index of the first point of every frame
+        const laser::frame& getStream() const { return stream; }
+        const std::vector<size_t>& getFrameOffsets() const { return frameOffsets; }
+        // write the recorded stream as csv (frame, x, y, r, g, b)
+        bool writeStream(const std::string& fileName) const;
+
+    private:
+        typedef std::chrono::steady_clock clock;
+        clock::time_point now() const;
+        void waitUntil(clock::time_point t);
+
+        simulationParameters parameters;
+        // virtual clock, only used if realTime == false
+        clock::time_point virtualNow;
+        // wall time sendFrame() last returned, NULL time before the first frame
+        clock::time_point returned;
+        // time the last queued point leaves the device
+        clock::time_point playbackEnd;
+        bool playing = false;
+
+        laser::frame stream;
+        std::vector<size_t> frameOffsets;
+    };
+
+    // read the simulation settings from the "output" section of the config file
+    void getSimulationParameters(const libconfig::Config& config, simulationParameters& parameters);
+
+    // create and open a backend by name ("lumax" or "simulated"). Returns -1 if the
+    // device could not be opened, dac stays empty if there is no such device.
+    int createBackend(const std::string& type, const libconfig::Config& config, std::unique_ptr<backend>& dac, int card = 1);
+}
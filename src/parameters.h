@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <string>
+#include <libconfig.h++>
+
+// InputType structure 
+enum InputType {
+    image, video, camera, precompiled, vectorgraphic, sequence, screen, sharedmemory, replay, composite
+};
+
+// parameters of the vectorization, changed with the keyboard while running. Copyable,
+// so other threads get consistent snapshots of them, see snapshot.h
+struct vectorizerParameters {
+    // opencv specific
+    int fillShortBlanks;
+    int lightThreshold;
+    int interThreshold;
+    int minLineLength;
+    int maxLineGap;
+    int blursize;
+    int upperThreshold;
+    int lowerThreshold;
+    int rResolution;
+    float thetaResolution;
+    bool blankMoves = false;
+    bool colorBoost = true;
+};
+
+// all relevant paramters
+struct Parameters : vectorizerParameters {
+    // input handling
+    std::array<int, 4> crop = {0, 0, 0, 0};
+    InputType inputtype = InputType::image;
+    std::string inputFile;
+    // decoded frames kept ahead of the render loop
+    int prefetchDepth = 4;
+    // screen capture: X display ("" for $DISPLAY) and rectangle x, y, width, height
+    std::string screenDisplay;
+    std::array<int, 4> screenArea = {0, 0, 0, 0};
+    // frames of other processes: shared memory name, number of slots and bytes per slot
+    std::string shmName = "/laser-display";
+    int shmSlots = 8;
+    int shmSlotSize = 1920 * 1080 * 4;
+    // [1/s] frame rate of image sequences, 0 shows every image without pacing
+    double sequenceFPS = 0;
+    std::string configFile;
+    libconfig::Config config;
+
+    // output handling
+    std::string outputBackend = "lumax";
+    // compile the input offline into this ILDA file instead of showing it
+    std::string compileFile;
+    // search the vectorizer parameters on the input and write the best into the config file
+    bool autotune = false;
+    // record the emitted frames into this ILDA file
+    std::string recordFile;
+    // record the input frames after the crop into this raw frame file
+    std::string saveInputFile;
+
+    // renderer options
+    int width;
+    int height;
+
+    bool doColorCorrection = false;
+
+    // SVG input: maximal deviation of the flattened curves and the longer side of the frame
+    float svgTolerance = 2;
+    int svgResolution = 4096;
+
+    // SDL specific
+    int maxFramesPerSecond = 20;
+    // no frame rate cap and no video pacing
+    bool benchmark = false;
+    // no window, no vsync and no SDL at all: the loop runs at maxFramesPerSecond
+    bool headless = false;
+    // [s] throughput statistics of the headless mode are printed at this interval
+    int statsInterval = 5;
+
+    // per frame tracing, see trace.h
+    bool trace = false;
+    std::string traceFile = "trace.json";
+};
@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace laser {
+    // allocator for SIMD friendly buffers
+    template<typename T, size_t Alignment = 64>
+    struct alignedAllocator {
+        typedef T value_type;
+        template<typename U> struct rebind { typedef alignedAllocator<U, Alignment> other; };
+
+        alignedAllocator() {}
+        template<typename U> alignedAllocator(const alignedAllocator<U, Alignment>&) {}
+
+        T* allocate(size_t n) {
+            size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+            void* p = std::aligned_alloc(Alignment, bytes);
+            if (p == nullptr)
+                throw std::bad_alloc();
+            return static_cast<T*>(p);
+        }
+        void deallocate(T* p, size_t) { std::free(p); }
+
+        template<typename U> bool operator==(const alignedAllocator<U, Alignment>&) const { return true; }
+        template<typename U> bool operator!=(const alignedAllocator<U, Alignment>&) const { return false; }
+    };
+
+    template<typename T>
+    using alignedVector = std::vector<T, alignedAllocator<T>>;
+
+    // one frame of laser points as structure of arrays: 16 bit coordinates and
+    // 8 bit color planes. A point with all colors zero is a blank move.
+    // Until the output projection is applied the coordinates are pixels of the
+    // width x height source frame, afterwards they are signed device coordinates
+    // (-32767 ... 32767, y pointing up).
+    class frame {
+    public:
+        frame(size_t capacity = 0) { reserve(capacity); }
+
+        void reserve(size_t n) {
+            x.reserve(n); y.reserve(n);
+            r.reserve(n); g.reserve(n); b.reserve(n);
+        }
+        void resize(size_t n) {
+            x.resize(n); y.resize(n);
+            r.resize(n); g.resize(n); b.resize(n);
+        }
+        void clear() {
+            x.clear(); y.clear();
+            r.clear(); g.clear(); b.clear();
+        }
+        size_t size() const { return x.size(); }
+        bool empty() const { return x.empty(); }
+
+        void push(int x_, int y_, int r_, int g_, int b_) {
+            x.push_back(static_cast<int16_t>(x_));
+            y.push_back(static_cast<int16_t>(y_));
+            r.push_back(static_cast<uint8_t>(r_));
+            g.push_back(static_cast<uint8_t>(g_));
+            b.push_back(static_cast<uint8_t>(b_));
+        }
+        bool isBlank(size_t i) const { return r[i] == 0 && g[i] == 0 && b[i] == 0; }
+
+        // append all points of another frame
+        void append(const frame& other) {
+            x.insert(x.end(), other.x.begin(), other.x.end());
+            y.insert(y.end(), other.y.begin(), other.y.end());
+            r.insert(r.end(), other.r.begin(), other.r.end());
+            g.insert(g.end(), other.g.begin(), other.g.end());
+            b.insert(b.end(), other.b.begin(), other.b.end());
+        }
+
+        // memory used by the points
+        size_t bytes() const { return size() * (2 * sizeof(int16_t) + 3 * sizeof(uint8_t)); }
+
+        alignedVector<int16_t> x;
+        alignedVector<int16_t> y;
+        alignedVector<uint8_t> r;
+        alignedVector<uint8_t> g;
+        alignedVector<uint8_t> b;
+
+        // dimensions of the source frame, 0 if the points are already in device coordinates
+        int width = 0;
+        int height = 0;
+        // id of the captured image the points were generated from, see trace.h
+        uint64_t sequence = 0;
+    };
+}
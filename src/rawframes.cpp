@@ -0,0 +1,212 @@
+#include "src/rawframes.h"
+
+#include <iostream>
+#include <cstring>
+#include <cstddef>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace rawframes {
+
+namespace {
+    const char magic[8] = {'L', 'D', 'R', 'A', 'W', 'F', 'R', '1'};
+    const size_t block = 64;
+
+    size_t padded(size_t n) {
+        return (n + block - 1) / block * block;
+    }
+
+    // file header: magic, number of frames
+    struct fileHeader {
+        char magic[8];
+        uint64_t frames;
+        uint8_t reserved[block - 16];
+    };
+
+    struct frameHeader {
+        uint64_t timestamp;
+        uint32_t width;
+        uint32_t height;
+        int32_t type;
+        uint32_t stride;
+        uint64_t size;
+        uint8_t reserved[block - 32];
+    };
+
+    static_assert(sizeof(fileHeader) == block && sizeof(frameHeader) == block, "headers are one block");
+}
+
+int writer::open(const std::string& fileName) {
+    close();
+    file = std::fopen(fileName.c_str(), "wb");
+    if (file == NULL) {
+        std::cerr << "Error: could not open " << fileName << " for writing." << std::endl;
+        return -1;
+    }
+    fileHeader h = {};
+    std::memcpy(h.magic, magic, sizeof(magic));
+    std::fwrite(&h, sizeof(h), 1, file);
+    frames = 0;
+    return 0;
+}
+
+int writer::writeFrame(const cv::Mat& img, uint64_t timestamp) {
+    if (file == NULL)
+        return -1;
+    // rows of a cropped view are not contiguous, they are written packed
+    const size_t stride = img.cols * img.elemSize();
+    if (frames == 0)
+        first = timestamp;
+    frameHeader h = {};
+    h.timestamp = timestamp - first;
+    h.width = img.cols;
+    h.height = img.rows;
+    h.type = img.type();
+    h.stride = stride;
+    h.size = padded(stride * img.rows);
+    std::fwrite(&h, sizeof(h), 1, file);
+    for (int y = 0; y < img.rows; ++y)
+        std::fwrite(img.ptr<uint8_t>(y), 1, stride, file);
+    static const uint8_t zeros[block] = {};
+    std::fwrite(zeros, 1, h.size - stride * img.rows, file);
+    if (std::ferror(file)) {
+        std::cerr << "Error while writing the raw frames." << std::endl;
+        return -1;
+    }
+    frames++;
+    return 0;
+}
+
+int writer::close() {
+    if (file == NULL)
+        return 0;
+    std::fseek(file, offsetof(fileHeader, frames), SEEK_SET);
+    std::fwrite(&frames, sizeof(frames), 1, file);
+    const int result = std::fclose(file) == 0 ? 0 : -1;
+    file = NULL;
+    return result;
+}
+
+int recorder::open(const std::string& fileName) {
+    close();
+    if (file.open(fileName) != 0)
+        return -1;
+    result = 0;
+    written = 0;
+    dropped = 0;
+    running = true;
+    worker = std::thread(&recorder::run, this);
+    return 0;
+}
+
+bool recorder::push(const cv::Mat& img, uint64_t timestamp) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running || pending.size() >= depth) {
+            dropped++;
+            return false;
+        }
+        pending.emplace_back(img, timestamp);
+    }
+    changed.notify_one();
+    return true;
+}
+
+int recorder::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!running)
+            return 0;
+        running = false;
+    }
+    changed.notify_one();
+    worker.join();
+    if (file.close() != 0)
+        result = -1;
+    return result;
+}
+
+void recorder::run() {
+    while (true) {
+        std::pair<cv::Mat, uint64_t> frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return !pending.empty() || !running; });
+            // the frames that are left are written before the file is closed
+            if (pending.empty())
+                break;
+            frame = std::move(pending.front());
+            pending.pop_front();
+        }
+        if (file.writeFrame(frame.first, frame.second) != 0)
+            result = -1;
+        else
+            written++;
+    }
+}
+
+int reader::open(const std::string& fileName) {
+    close();
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: could not open " << fileName << "." << std::endl;
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(fileHeader))) {
+        std::cerr << "Error: " << fileName << " is not a raw frame file." << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    length = st.st_size;
+    // copy on write: the pixels are never written, but OpenCV wants non-const data
+    void* mapping = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: could not map " << fileName << "." << std::endl;
+        length = 0;
+        return -1;
+    }
+    data = static_cast<uint8_t*>(mapping);
+    if (std::memcmp(data, magic, sizeof(magic)) != 0) {
+        std::cerr << "Error: " << fileName << " is not a raw frame file." << std::endl;
+        close();
+        return -1;
+    }
+
+    size_t offset = sizeof(fileHeader);
+    while (offset + sizeof(frameHeader) <= length) {
+        frameHeader h;
+        std::memcpy(&h, data + offset, sizeof(h));
+        const size_t size = static_cast<size_t>(h.stride) * h.height;
+        if (h.size < size || offset + sizeof(h) + h.size > length)
+            break;
+        index.push_back({h.timestamp, static_cast<int>(h.width), static_cast<int>(h.height), h.type, h.stride, data + offset + sizeof(h)});
+        offset += sizeof(h) + h.size;
+    }
+    if (index.empty()) {
+        std::cerr << "Error: " << fileName << " has no frames." << std::endl;
+        close();
+        return -1;
+    }
+    std::cout << "Raw frames: " << index.size() << " frames, " << index.back().timestamp / 1e9 << " s" << std::endl;
+    return 0;
+}
+
+void reader::close() {
+    if (data != NULL)
+        munmap(data, length);
+    data = NULL;
+    length = 0;
+    index.clear();
+}
+
+cv::Mat reader::getFrame(size_t i) const {
+    const entry& e = index[i];
+    return cv::Mat(e.height, e.width, e.type, const_cast<uint8_t*>(e.pixels), e.stride);
+}
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+
+// Raw container of decoded input frames for reproducible runs: a 64 byte file
+// header and for every frame a 64 byte header (timestamp, size, OpenCV type,
+// bytes per row) followed by the pixels, padded to 64 bytes, so the frames can be
+// used straight from a memory mapping.
+namespace rawframes {
+    class writer {
+    public:
+        writer() {}
+        ~writer() { close(); }
+        writer(const writer&) = delete;
+        writer& operator=(const writer&) = delete;
+
+        int open(const std::string& fileName);
+        // timestamp [ns] of any clock, stored relative to the first frame
+        int writeFrame(const cv::Mat& img, uint64_t timestamp);
+        // writes the number of frames into the file header
+        int close();
+        uint64_t getFrames() const { return frames; }
+        bool isOpen() const { return file != NULL; }
+
+    private:
+        FILE* file = NULL;
+        uint64_t frames = 0;
+        uint64_t first = 0;
+    };
+
+    // writes the frames from a background thread, so the thread that captures them
+    // never waits for the disk. Up to depth frames wait for the disk, further ones
+    // are dropped.
+    class recorder {
+    public:
+        recorder(size_t depth = 16) : depth(depth) {}
+        ~recorder() { close(); }
+        recorder(const recorder&) = delete;
+        recorder& operator=(const recorder&) = delete;
+
+        // open the file and start the writer thread
+        int open(const std::string& fileName);
+        // the pixels are written later and must not change until then, memory that is
+        // reused (e.g. borrowed from a source) has to be copied. False if dropped.
+        bool push(const cv::Mat& img, uint64_t timestamp);
+        // writes the frames that are left and closes the file
+        int close();
+        bool isOpen() const { return running; }
+
+        uint64_t getFrames() const { return written; }
+        uint64_t getDropped() const { return dropped; }
+
+    private:
+        void run();
+
+        writer file;
+        size_t depth;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::deque<std::pair<cv::Mat, uint64_t>> pending;
+        std::atomic<bool> running{false};
+        int result = 0;
+        std::atomic<uint64_t> written{0};
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    class reader {
+    public:
+        reader() {}
+        ~reader() { close(); }
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        // maps the file and indexes the frames, a file of an interrupted recording
+        // is read up to its last complete frame
+        int open(const std::string& fileName);
+        void close();
+
+        size_t getFrames() const { return index.size(); }
+        // [ns] relative to the first frame
+        uint64_t getTimestamp(size_t i) const { return index[i].timestamp; }
+        // the pixels in the mapping, without copying
+        cv::Mat getFrame(size_t i) const;
+
+    private:
+        struct entry {
+            uint64_t timestamp;
+            int width;
+            int height;
+            int type;
+            size_t stride;
+            const uint8_t* pixels;
+        };
+
+        uint8_t* data = NULL;
+        size_t length = 0;
+        std::vector<entry> index;
+    };
+}
@@ -0,0 +1,89 @@
+#include "src/realtime.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+namespace realtime {
+
+namespace {
+    void readCPUs(const libconfig::Setting& settings, const char* name, std::vector<int>& cpus) {
+        if (!settings.exists(name))
+            return;
+        const libconfig::Setting& list = settings[name];
+        cpus.clear();
+        for (int i = 0; i < list.getLength(); ++i)
+            cpus.push_back(list[i]);
+    }
+}
+
+int pinThread(const std::vector<int>& cpus) {
+    if (cpus.empty())
+        return 0;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            std::cerr << "Invalid CPU " << cpu << ", the thread is not pinned." << std::endl;
+            return -1;
+        }
+        CPU_SET(cpu, &set);
+    }
+    const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (error != 0) {
+        std::cerr << "Could not pin the thread to its CPUs: " << std::strerror(error) << std::endl;
+        return -1;
+    }
+    return 0;
+#else
+    std::cerr << "Pinning threads to CPUs is not supported on this system." << std::endl;
+    return -1;
+#endif
+}
+
+int setPriority(int priority) {
+    if (priority <= 0)
+        return 0;
+    sched_param param;
+    std::memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    const int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (error == EPERM) {
+        std::cerr << "SCHED_FIFO is not permitted (needs CAP_SYS_NICE or an rtprio limit), keeping the normal scheduler." << std::endl;
+        return -1;
+    } else if (error != 0) {
+        std::cerr << "Could not set SCHED_FIFO priority " << priority << ": " << std::strerror(error) << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int lockMemory(const void* address, size_t bytes) {
+    if (address == NULL || bytes == 0)
+        return 0;
+    if (mlock(address, bytes) != 0) {
+        std::cerr << "Could not lock " << bytes << " bytes into memory: " << std::strerror(errno) << " (see ulimit -l)" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+void getRealtimeParameters(const libconfig::Config& config, realtimeParameters& parameters) {
+    const libconfig::Setting& root = config.getRoot();
+    try {
+        const libconfig::Setting& rt = root["application"]["realtime"];
+        readCPUs(rt, "outputCPUs", parameters.outputCPUs);
+        readCPUs(rt, "workerCPUs", parameters.workerCPUs);
+        rt.lookupValue("outputPriority", parameters.outputPriority);
+        rt.lookupValue("lockMemory", parameters.lockMemory);
+        rt.lookupValue("bufferPoints", parameters.bufferPoints);
+        rt.lookupValue("opencvThreads", parameters.opencvThreads);
+        rt.lookupValue("deadline", parameters.deadline);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+}
+
+}
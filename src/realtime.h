@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <libconfig.h++>
+
+// Scheduling of the threads that have deadlines: the output threads feed the DACs and
+// must not be delayed by the vectorization or the desktop, so they can get their own
+// CPUs and the SCHED_FIFO scheduler. All functions work on the calling thread, threads
+// started later inherit its CPUs.
+namespace realtime {
+    struct realtimeParameters {
+        // CPUs of the output threads and of everything else (main loop, input, OpenCV),
+        // empty lists keep all CPUs
+        std::vector<int> outputCPUs;
+        std::vector<int> workerCPUs;
+        // SCHED_FIFO priority of the output threads (1 ... 99), 0 keeps the normal scheduler
+        int outputPriority = 0;
+        // lock the frames the output threads work on into memory, again whenever they grow
+        bool lockMemory = false;
+        // points per frame the buffers are locked with at the start
+        int bufferPoints = 20000;
+        // threads of OpenCV's parallel loops, 0 keeps the OpenCV default
+        int opencvThreads = 0;
+        // [ms] a frame must be acknowledged by the DAC this long after it was presented (or
+        // after the frame before if the device was busy). 0 allows twice the scan time of
+        // the frame plus 2 ms: the DAC needs at most one scan time to make room for it and
+        // less for the transfer. < 0 counts no misses.
+        double deadline = 0;
+    };
+
+    // 0 on success, -1 if the system does not allow it (a message is printed)
+    int pinThread(const std::vector<int>& cpus);
+    int setPriority(int priority);
+    int lockMemory(const void* address, size_t bytes);
+
+    void getRealtimeParameters(const libconfig::Config& config, realtimeParameters& parameters);
+}
@@ -0,0 +1,107 @@
+#include "src/recorder.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+namespace output {
+
+recorder::recorder(const std::string& fileName, const recorderParameters& parameters)
+    : fileName(fileName), maxPoints(std::max(parameters.maxPoints, 1)), slots(std::max(parameters.frames, 2)) {
+    for (auto& slot : slots)
+        slot.reserve(maxPoints);
+}
+
+int recorder::start() {
+    if (running)
+        return 0;
+    if (file.open(fileName, "record") != 0)
+        return -1;
+    running = true;
+    worker = std::thread(&recorder::run, this);
+    std::cout << "Recording the output to " << fileName << std::endl;
+    return 0;
+}
+
+void recorder::stop() {
+    if (!running)
+        return;
+    running = false;
+    if (worker.joinable())
+        worker.join();
+    if (file.close() != 0 && failed == 0)
+        std::cerr << "Error: could not finish the recording " << fileName << "." << std::endl;
+}
+
+bool recorder::push(const laser::frame& points) {
+    if (!running)
+        return false;
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= slots.size()) {
+        // the disk is behind, the output must not wait for it
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // copy within the reserved capacity
+    laser::frame& slot = slots[h % slots.size()];
+    const size_t n = std::min(points.size(), maxPoints);
+    if (n < points.size())
+        truncated.fetch_add(1, std::memory_order_relaxed);
+    slot.x.assign(points.x.begin(), points.x.begin() + n);
+    slot.y.assign(points.y.begin(), points.y.begin() + n);
+    slot.r.assign(points.r.begin(), points.r.begin() + n);
+    slot.g.assign(points.g.begin(), points.g.begin() + n);
+    slot.b.assign(points.b.begin(), points.b.begin() + n);
+    slot.width = points.width;
+    slot.height = points.height;
+    slot.sequence = points.sequence;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+void recorder::run() {
+    while (true) {
+        // read the state before the ring, so the frames pushed before stop() are written
+        const bool stopping = !running.load(std::memory_order_acquire);
+        const size_t h = head.load(std::memory_order_acquire);
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == h) {
+            if (stopping)
+                break;
+            // polling keeps push() free of any locks or wakeups
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            continue;
+        }
+        for (; t != h; ++t) {
+            // after a write error (e.g. a full disk) the ring is only emptied
+            if (failed > 0) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+            } else if (file.writeFrame(slots[t % slots.size()]) != 0) {
+                std::cerr << "Error: could not write to " << fileName << ", the recording stops." << std::endl;
+                failed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                recorded.fetch_add(1, std::memory_order_relaxed);
+            }
+            tail.store(t + 1, std::memory_order_release);
+        }
+    }
+}
+
+void recorder::printStatistics(std::ostream& os) const {
+    os << "Recorder " << fileName << ": " << recorded << " frames recorded, " << dropped << " dropped, ";
+    os << truncated << " truncated, " << failed << " failed to write." << std::endl;
+}
+
+void getRecorderParameters(const libconfig::Config& config, recorderParameters& parameters) {
+    const libconfig::Setting& root = config.getRoot();
+    try {
+        const libconfig::Setting& rec = root["output"]["recorder"];
+        rec.lookupValue("enabled", parameters.enabled);
+        rec.lookupValue("file", parameters.file);
+        rec.lookupValue("frames", parameters.frames);
+        rec.lookupValue("maxPoints", parameters.maxPoints);
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+}
+
+}
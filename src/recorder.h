@@ -0,0 +1,70 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <libconfig.h++>
+
+#include "src/pointframe.h"
+#include "src/ilda.h"
+
+namespace output {
+    // size of the ring of the recorder, the memory is allocated once
+    struct recorderParameters {
+        bool enabled = false;
+        std::string file = "record.ild";
+        // frames the disk may fall behind before frames are dropped
+        int frames = 64;
+        // points per frame, longer frames are truncated
+        int maxPoints = 20000;
+    };
+
+    // copies the final frames of one device into a preallocated ring and writes them
+    // to an ILDA file from a background thread. push() never blocks and never allocates.
+    // Recordings longer than 65536 frames wrap the frame numbers, see ilda::writer.
+    class recorder {
+    public:
+        recorder(const std::string& fileName, const recorderParameters& parameters = recorderParameters());
+        ~recorder() { stop(); }
+
+        // open the file and start the writer thread
+        int start();
+        // write the frames that are left and close the file
+        void stop();
+
+        // called from the output thread with the frame in device coordinates,
+        // drops the frame if the ring is full
+        bool push(const laser::frame& points);
+
+        uint64_t getRecorded() const { return recorded; }
+        uint64_t getDropped() const { return dropped; }
+        uint64_t getTruncated() const { return truncated; }
+        // frames lost to a write error, nothing is written after the first one
+        uint64_t getFailed() const { return failed; }
+        void printStatistics(std::ostream& os) const;
+
+    private:
+        void run();
+
+        std::string fileName;
+        size_t maxPoints;
+        // single producer (output thread), single consumer (writer thread)
+        std::vector<laser::frame> slots;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+
+        std::atomic<bool> running{false};
+        std::thread worker;
+        ilda::writer file;
+
+        std::atomic<uint64_t> recorded{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> truncated{0};
+        std::atomic<uint64_t> failed{0};
+    };
+
+    // read the "output.recorder" group
+    void getRecorderParameters(const libconfig::Config& config, recorderParameters& parameters);
+}
@@ -0,0 +1,204 @@
+#include "src/screen.h"
+
+#ifdef X11_CAPTURE
+#include <iostream>
+#include <algorithm>
+
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+
+namespace input {
+
+namespace {
+    // XShmAttach fails asynchronously, e.g. for a display on another machine, the error
+    // only arrives with the next round trip
+    bool attachFailed = false;
+
+    int onAttachError(Display*, XErrorEvent*) {
+        attachFailed = true;
+        return 0;
+    }
+}
+
+struct screenSource::buffer {
+    XImage* image = NULL;
+    XShmSegmentInfo info = {};
+    bool attached = false;
+};
+
+screenSource::screenSource(const std::string& displayName, const std::array<int, 4>& area, size_t buffers, double maxFPS)
+    : displayName(displayName), area(area), numberOfBuffers(std::max<size_t>(buffers, 2)),
+      period(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(maxFPS > 0 ? 1.0 / maxFPS : 0))) {}
+
+screenSource::~screenSource() {
+    close();
+}
+
+std::string screenSource::getName() const {
+    return "screen " + (displayName.empty() ? std::string("(default display)") : displayName);
+}
+
+bool screenSource::open() {
+    close();
+    display = XOpenDisplay(displayName.empty() ? NULL : displayName.c_str());
+    if (display == NULL) {
+        std::cerr << "Error while opening the X display " << displayName << "." << std::endl;
+        return false;
+    }
+    root = DefaultRootWindow(display);
+    XWindowAttributes attributes = {};
+    XGetWindowAttributes(display, root, &attributes);
+
+    // constrain the capture rectangle to the screen
+    area[0] = std::min(std::max(area[0], 0), attributes.width - 1);
+    area[1] = std::min(std::max(area[1], 0), attributes.height - 1);
+    if (area[2] <= 0 || area[0] + area[2] > attributes.width)
+        area[2] = attributes.width - area[0];
+    if (area[3] <= 0 || area[1] + area[3] > attributes.height)
+        area[3] = attributes.height - area[1];
+
+    shm = XShmQueryExtension(display);
+    if (shm) {
+        for (size_t i = 0; i < numberOfBuffers; ++i) {
+            std::unique_ptr<buffer> b(new buffer);
+            b->image = XShmCreateImage(display, attributes.visual, attributes.depth, ZPixmap, NULL, &b->info, area[2], area[3]);
+            if (b->image == NULL || b->image->bits_per_pixel != 32) {
+                std::cerr << "Error: screen capture needs a 24 or 32 bit display." << std::endl;
+                if (b->image != NULL)
+                    XDestroyImage(b->image);
+                close();
+                return false;
+            }
+            b->info.shmid = shmget(IPC_PRIVATE, b->image->bytes_per_line * b->image->height, IPC_CREAT | 0600);
+            if (b->info.shmid < 0) {
+                std::cerr << "Error while allocating the shared memory for the screen capture." << std::endl;
+                XDestroyImage(b->image);
+                close();
+                return false;
+            }
+            b->info.shmaddr = b->image->data = static_cast<char*>(shmat(b->info.shmid, NULL, 0));
+            if (b->info.shmaddr == reinterpret_cast<char*>(-1)) {
+                std::cerr << "Error while attaching the shared memory for the screen capture." << std::endl;
+                shmctl(b->info.shmid, IPC_RMID, NULL);
+                b->image->data = NULL;
+                XDestroyImage(b->image);
+                close();
+                return false;
+            }
+            b->info.readOnly = False;
+            attachFailed = false;
+            XErrorHandler handler = XSetErrorHandler(onAttachError);
+            b->attached = XShmAttach(display, &b->info);
+            XSync(display, False);
+            XSetErrorHandler(handler);
+            b->attached = b->attached && !attachFailed;
+            // the segment is freed with the last detach, also if the process dies
+            shmctl(b->info.shmid, IPC_RMID, NULL);
+            const bool attached = b->attached;
+            buffers.push_back(std::move(b));
+            if (!attached) {
+                releaseBuffers();
+                shm = false;
+                break;
+            }
+            idle.push_back(buffers.back().get());
+        }
+    }
+    if (!shm)
+        std::cout << "Warning: the X display has no shared memory, the screen capture copies every frame." << std::endl;
+    std::cout << "Screen capture: " << area[2] << "x" << area[3] << " at (" << area[0] << ", " << area[1] << ")" << std::endl;
+    return true;
+}
+
+bool screenSource::pace() {
+    std::unique_lock<std::mutex> lock(mutex);
+    returned.wait_until(lock, due, [&] { return interrupted; });
+    due = std::max(due, std::chrono::steady_clock::now()) + period;
+    return !interrupted;
+}
+
+bool screenSource::read(cv::Mat& img) {
+    if (display == NULL)
+        return false;
+    if (shm) {
+        std::shared_ptr<void> handle;
+        if (!borrow(img, handle))
+            return false;
+        // the buffer is reused as soon as the handle is gone
+        img = img.clone();
+        return true;
+    }
+    if (!pace())
+        return false;
+    XImage* image = XGetImage(display, root, area[0], area[1], area[2], area[3], AllPlanes, ZPixmap);
+    if (image == NULL)
+        return false;
+    img = cv::Mat(image->height, image->width, CV_8UC4, image->data, image->bytes_per_line).clone();
+    XDestroyImage(image);
+    return true;
+}
+
+bool screenSource::borrow(cv::Mat& img, std::shared_ptr<void>& handle) {
+    if (display == NULL || !shm) {
+        handle.reset();
+        return read(img);
+    }
+    if (!pace())
+        return false;
+    buffer* b = NULL;
+    {
+        // all buffers in use: the consumers hold more frames than planned
+        std::unique_lock<std::mutex> lock(mutex);
+        returned.wait(lock, [&] { return !idle.empty() || interrupted; });
+        if (interrupted)
+            return false;
+        b = idle.back();
+        idle.pop_back();
+    }
+    // the buffer goes back to the idle ones with its last handle
+    handle = std::shared_ptr<void>(b, [this](buffer* b) {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(b);
+        returned.notify_all();
+    });
+    if (!XShmGetImage(display, root, b->image, area[0], area[1], AllPlanes)) {
+        handle.reset();
+        return false;
+    }
+    img = cv::Mat(b->image->height, b->image->width, CV_8UC4, b->image->data, b->image->bytes_per_line);
+    return true;
+}
+
+void screenSource::interrupt() {
+    std::lock_guard<std::mutex> lock(mutex);
+    interrupted = true;
+    returned.notify_all();
+}
+
+void screenSource::releaseBuffers() {
+    // no handle may be left, the prefetcher releases them before the source
+    for (auto& b : buffers) {
+        if (b->attached)
+            XShmDetach(display, &b->info);
+        // the pixels are in the shared memory, not on the heap
+        b->image->data = NULL;
+        XDestroyImage(b->image);
+        if (b->info.shmaddr != NULL)
+            shmdt(b->info.shmaddr);
+    }
+    buffers.clear();
+    idle.clear();
+}
+
+void screenSource::close() {
+    releaseBuffers();
+    if (display != NULL)
+        XCloseDisplay(display);
+    display = NULL;
+}
+
+}
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "src/input.h"
+
+#ifdef X11_CAPTURE
+// Xlib types, the X11 headers are only included in screen.cpp because their
+// macros (None, Status, Bool, ...) collide with OpenCV
+struct _XDisplay;
+
+namespace input {
+    // Captures a rectangle of the X11 screen over one persistent connection, at most
+    // maxFPS times per second. borrow() grabs into MIT-SHM images that are wrapped as
+    // BGRA cv::Mat without copying, a buffer is only reused after its handle was
+    // released; buffers has to cover the prefetch ring, the frame in the render loop
+    // and the one being captured, otherwise the capture waits. read() copies. Falls
+    // back to XGetImage with a copy if the display has no shared memory or can not
+    // attach it (e.g. a remote display).
+    class screenSource : public source {
+    public:
+        // area: x, y, width, height of the root window, width/height 0 up to the border.
+        // maxFPS 0 grabs whenever a frame is asked for.
+        screenSource(const std::string& displayName, const std::array<int, 4>& area, size_t buffers, double maxFPS = 0);
+        ~screenSource();
+
+        bool open() override;
+        bool read(cv::Mat& img) override;
+        bool borrow(cv::Mat& img, std::shared_ptr<void>& handle) override;
+        void interrupt() override;
+        bool isLive() const override { return true; }
+        std::string getName() const override;
+
+    private:
+        struct buffer;
+        // waits for the next capture time, false if interrupted
+        bool pace();
+        void releaseBuffers();
+        void close();
+
+        std::string displayName;
+        std::array<int, 4> area;
+        size_t numberOfBuffers;
+        std::chrono::steady_clock::duration period;
+        std::chrono::steady_clock::time_point due;
+        _XDisplay* display = NULL;
+        unsigned long root = 0;
+        bool shm = false;
+        std::vector<std::unique_ptr<buffer>> buffers;
+        // buffers without a handle, returned by the handles from any thread
+        std::mutex mutex;
+        std::condition_variable returned;
+        std::vector<buffer*> idle;
+        bool interrupted = false;
+    };
+}
+#endif
@@ -0,0 +1,282 @@
+#include "src/segments.h"
+
+#include <limits>
+// the vector kernels are compiled for their instruction set and chosen at runtime,
+// a build without -march runs them on every x86 CPU that has them
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SEGMENTS_X86
+#include <immintrin.h>
+#endif
+
+namespace segments {
+
+namespace {
+    // the query points: the point, or the first and the second point of the line.
+    // Case 2 * q + e is the distance of query point q to the endpoint e of a candidate.
+    template<int Q>
+    struct query {
+        int32_t x[Q];
+        int32_t y[Q];
+    };
+
+    struct result {
+        size_t index;
+        int64_t distance;
+        int which;
+    };
+
+    // candidates [begin, end) one at a time, updates best only for a strictly shorter distance
+    template<int Q>
+    void scan(const query<Q>& q, const block& c, size_t begin, size_t end, result& best) {
+        for (size_t i = begin; i < end; ++i) {
+            for (int p = 0; p < Q; ++p) {
+                const int64_t d1 = static_cast<int64_t>(c.x1[i] - q.x[p]) * (c.x1[i] - q.x[p]) + static_cast<int64_t>(c.y1[i] - q.y[p]) * (c.y1[i] - q.y[p]);
+                const int64_t d2 = static_cast<int64_t>(c.x2[i] - q.x[p]) * (c.x2[i] - q.x[p]) + static_cast<int64_t>(c.y2[i] - q.y[p]) * (c.y2[i] - q.y[p]);
+                if (d1 < best.distance)
+                    best = {i, d1, 2 * p};
+                if (d2 < best.distance)
+                    best = {i, d2, 2 * p + 1};
+            }
+        }
+    }
+
+#ifdef SEGMENTS_X86
+    // lane results of the vector loop: the shortest distance, on ties the lower index
+    void reduce(const int32_t* distance, const int32_t* index, const int32_t* which, int lanes, result& best) {
+        for (int l = 0; l < lanes; ++l) {
+            const size_t i = static_cast<size_t>(index[l]);
+            if (distance[l] < best.distance || (distance[l] == best.distance && i < best.index))
+                best = {i, distance[l], which[l]};
+        }
+    }
+
+    // the candidates in blocks of 8, returns the number done, the rest is left to scan()
+    template<int Q>
+    __attribute__((target("avx2"))) size_t batchAVX2(const query<Q>& q, const block& c, result& best) {
+        const size_t n = c.size();
+        size_t i = 0;
+        if (n < 8)
+            return 0;
+        __m256i qx[Q], qy[Q];
+        for (int p = 0; p < Q; ++p) {
+            qx[p] = _mm256_set1_epi32(q.x[p]);
+            qy[p] = _mm256_set1_epi32(q.y[p]);
+        }
+        __m256i bestDistance = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+        __m256i bestIndex = _mm256_setzero_si256();
+        __m256i bestWhich = _mm256_setzero_si256();
+        __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i step = _mm256_set1_epi32(8);
+        for (; i + 8 <= n; i += 8) {
+            const __m256i cx[2] = {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.x1.data() + i)),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.x2.data() + i))};
+            const __m256i cy[2] = {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.y1.data() + i)),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c.y2.data() + i))};
+            // shortest of the 2 or 4 endpoint distances of every candidate, first case on ties
+            __m256i distance = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
+            __m256i which = _mm256_setzero_si256();
+            for (int p = 0; p < Q; ++p) {
+                for (int e = 0; e < 2; ++e) {
+                    const __m256i dx = _mm256_sub_epi32(cx[e], qx[p]);
+                    const __m256i dy = _mm256_sub_epi32(cy[e], qy[p]);
+                    const __m256i d = _mm256_add_epi32(_mm256_mullo_epi32(dx, dx), _mm256_mullo_epi32(dy, dy));
+                    const __m256i shorter = _mm256_cmpgt_epi32(distance, d);
+                    distance = _mm256_blendv_epi8(distance, d, shorter);
+                    which = _mm256_blendv_epi8(which, _mm256_set1_epi32(2 * p + e), shorter);
+                }
+            }
+            const __m256i shorter = _mm256_cmpgt_epi32(bestDistance, distance);
+            bestDistance = _mm256_blendv_epi8(bestDistance, distance, shorter);
+            bestIndex = _mm256_blendv_epi8(bestIndex, index, shorter);
+            bestWhich = _mm256_blendv_epi8(bestWhich, which, shorter);
+            index = _mm256_add_epi32(index, step);
+        }
+        alignas(32) int32_t d[8], idx[8], w[8];
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d), bestDistance);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(idx), bestIndex);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(w), bestWhich);
+        reduce(d, idx, w, 8, best);
+        return i;
+    }
+
+    // the same in blocks of 4
+    template<int Q>
+    __attribute__((target("sse4.1"))) size_t batchSSE41(const query<Q>& q, const block& c, result& best) {
+        const size_t n = c.size();
+        size_t i = 0;
+        if (n < 4)
+            return 0;
+        __m128i qx[Q], qy[Q];
+        for (int p = 0; p < Q; ++p) {
+            qx[p] = _mm_set1_epi32(q.x[p]);
+            qy[p] = _mm_set1_epi32(q.y[p]);
+        }
+        __m128i bestDistance = _mm_set1_epi32(std::numeric_limits<int32_t>::max());
+        __m128i bestIndex = _mm_setzero_si128();
+        __m128i bestWhich = _mm_setzero_si128();
+        __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+        const __m128i step = _mm_set1_epi32(4);
+        for (; i + 4 <= n; i += 4) {
+            const __m128i cx[2] = {_mm_loadu_si128(reinterpret_cast<const __m128i*>(c.x1.data() + i)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.x2.data() + i))};
+            const __m128i cy[2] = {_mm_loadu_si128(reinterpret_cast<const __m128i*>(c.y1.data() + i)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i*>(c.y2.data() + i))};
+            __m128i distance = _mm_set1_epi32(std::numeric_limits<int32_t>::max());
+            __m128i which = _mm_setzero_si128();
+            for (int p = 0; p < Q; ++p) {
+                for (int e = 0; e < 2; ++e) {
+                    const __m128i dx = _mm_sub_epi32(cx[e], qx[p]);
+                    const __m128i dy = _mm_sub_epi32(cy[e], qy[p]);
+                    const __m128i d = _mm_add_epi32(_mm_mullo_epi32(dx, dx), _mm_mullo_epi32(dy, dy));
+                    const __m128i shorter = _mm_cmpgt_epi32(distance, d);
+                    distance = _mm_blendv_epi8(distance, d, shorter);
+                    which = _mm_blendv_epi8(which, _mm_set1_epi32(2 * p + e), shorter);
+                }
+            }
+            const __m128i shorter = _mm_cmpgt_epi32(bestDistance, distance);
+            bestDistance = _mm_blendv_epi8(bestDistance, distance, shorter);
+            bestIndex = _mm_blendv_epi8(bestIndex, index, shorter);
+            bestWhich = _mm_blendv_epi8(bestWhich, which, shorter);
+            index = _mm_add_epi32(index, step);
+        }
+        alignas(16) int32_t d[4], idx[4], w[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(d), bestDistance);
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx), bestIndex);
+        _mm_store_si128(reinterpret_cast<__m128i*>(w), bestWhich);
+        reduce(d, idx, w, 4, best);
+        return i;
+    }
+#endif
+
+    // the widest instruction set of the CPU, detected once
+    instructions detect() {
+#ifdef SEGMENTS_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return instructions::avx2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return instructions::sse41;
+#endif
+        return instructions::scalar;
+    }
+
+    template<int Q>
+    result nearestKernel(const query<Q>& q, const block& c, instructions set) {
+        const size_t n = c.size();
+        result best = {n, std::numeric_limits<int64_t>::max(), 0};
+        size_t i = 0;
+#ifdef SEGMENTS_X86
+        if (set == instructions::avx2)
+            i = batchAVX2(q, c, best);
+        else if (set == instructions::sse41)
+            i = batchSSE41(q, c, best);
+#endif
+        // the rest has higher indices, these never win a tie
+        scan(q, c, i, n, best);
+        return best;
+    }
+
+    match toMatch(const result& r) {
+        return {r.index, r.distance, r.which >= 2, (r.which & 1) != 0};
+    }
+}
+
+void block::clear() {
+    x1.clear();
+    y1.clear();
+    x2.clear();
+    y2.clear();
+}
+
+void block::reserve(size_t n) {
+    x1.reserve(n);
+    y1.reserve(n);
+    x2.reserve(n);
+    y2.reserve(n);
+}
+
+void block::push(int32_t ax, int32_t ay, int32_t bx, int32_t by) {
+    x1.push_back(ax);
+    y1.push_back(ay);
+    x2.push_back(bx);
+    y2.push_back(by);
+}
+
+void block::erase(size_t i) {
+    x1.erase(x1.begin() + i);
+    y1.erase(y1.begin() + i);
+    x2.erase(x2.begin() + i);
+    y2.erase(y2.begin() + i);
+}
+
+void block::swapRemove(size_t i) {
+    x1[i] = x1.back();
+    y1[i] = y1.back();
+    x2[i] = x2.back();
+    y2[i] = y2.back();
+    x1.pop_back();
+    y1.pop_back();
+    x2.pop_back();
+    y2.pop_back();
+}
+
+instructions getInstructions() {
+    static const instructions supported = detect();
+    return supported;
+}
+
+bool isSupported(instructions set) {
+    return set <= getInstructions();
+}
+
+match nearest(int32_t x, int32_t y, const block& candidates) {
+    return toMatch(nearestKernel<1>({{x}, {y}}, candidates, getInstructions()));
+}
+
+match nearest(const cv::Vec4i& line, const block& candidates) {
+    return toMatch(nearestKernel<2>({{line[0], line[2]}, {line[1], line[3]}}, candidates, getInstructions()));
+}
+
+match nearest(int32_t x, int32_t y, const block& candidates, instructions set) {
+    return toMatch(nearestKernel<1>({{x}, {y}}, candidates, isSupported(set) ? set : getInstructions()));
+}
+
+match nearest(const cv::Vec4i& line, const block& candidates, instructions set) {
+    return toMatch(nearestKernel<2>({{line[0], line[2]}, {line[1], line[3]}}, candidates, isSupported(set) ? set : getInstructions()));
+}
+
+match nearestScalar(int32_t x, int32_t y, const block& candidates) {
+    return nearest(x, y, candidates, instructions::scalar);
+}
+
+match nearestScalar(const cv::Vec4i& line, const block& candidates) {
+    return nearest(line, candidates, instructions::scalar);
+}
+
+template<typename T, typename Segment>
+void order(const view<T, Segment>& lines) {
+    if (lines.size() < 2)
+        return;
+    // the candidates and their segments are removed in step, so the indices stay equal
+    block candidates;
+    candidates.assign(lines.subview(1, lines.size() - 1));
+    std::vector<typename std::remove_const<Segment>::type> pending(lines.begin() + 1, lines.end());
+    int32_t x = toGrid(lines.x2(0)), y = toGrid(lines.y2(0));
+    for (size_t k = 1; k < lines.size(); ++k) {
+        const match m = nearest(x, y, candidates);
+        lines[k] = pending[m.index];
+        if (m.flip)
+            lines.flip(k);
+        x = toGrid(lines.x2(k));
+        y = toGrid(lines.y2(k));
+        candidates.erase(m.index);
+        pending.erase(pending.begin() + m.index);
+    }
+}
+
+template void order(const view<short>& lines);
+template void order(const view<int>& lines);
+template void order(const view<float>& lines);
+template void order(const view<int, attributed>& lines);
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <utility>
+#include <type_traits>
+#include <opencv2/opencv.hpp>
+
+// Line segments for the ordering: typed views of contiguous segment storage and batched
+// endpoint distances, one query against a block of candidates stored as structure of
+// arrays, 8 (AVX2) or 4 (SSE4.1) candidates at a time, as the CPU supports at runtime.
+// Coordinates of one block must lie within a range of 32768 (e.g. the pixels of a
+// frame), so the squared distances fit into 32 bit.
+namespace segments {
+    // Non-owning view of contiguous segments (x1, y1, x2, y2) of the coordinate type T,
+    // e.g. the output of cv::HoughLinesP (cv::Vec4i), cv::Vec4s or cv::Vec4f. The segments
+    // are used as what they are, without copies and without casts to other types.
+    template<typename T, typename Segment = cv::Vec<T, 4>>
+    class view {
+    public:
+        typedef T coordinate;
+        typedef Segment segment;
+
+        view() {}
+        view(Segment* data, size_t count) : segments(data), count(count) {}
+        template<typename Allocator>
+        view(std::vector<typename std::remove_const<Segment>::type, Allocator>& v) : segments(v.data()), count(v.size()) {}
+        template<typename Allocator>
+        view(const std::vector<typename std::remove_const<Segment>::type, Allocator>& v) : segments(v.data()), count(v.size()) {}
+
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        Segment& operator[](size_t i) const { return segments[i]; }
+        Segment* begin() const { return segments; }
+        Segment* end() const { return segments + count; }
+        view subview(size_t offset, size_t n) const { return view(segments + offset, n); }
+
+        T x1(size_t i) const { return segments[i][0]; }
+        T y1(size_t i) const { return segments[i][1]; }
+        T x2(size_t i) const { return segments[i][2]; }
+        T y2(size_t i) const { return segments[i][3]; }
+        // swaps the endpoints of segment i
+        void flip(size_t i) const {
+            std::swap(segments[i][0], segments[i][2]);
+            std::swap(segments[i][1], segments[i][3]);
+        }
+
+    private:
+        Segment* segments = NULL;
+        size_t count = 0;
+    };
+
+    // a segment with an attribute that moves with it, e.g. the color of its path
+    typedef cv::Vec<int, 5> attributed;
+
+    // exact squared distances: 64 bit for integer coordinates, double for floating point
+    template<typename T>
+    using accumulator = typename std::conditional<std::is_integral<T>::value, int64_t, double>::type;
+
+    template<typename T>
+    inline int32_t toGrid(T v) { return static_cast<int32_t>(v); }
+    inline int32_t toGrid(float v) { return static_cast<int32_t>(std::lround(v)); }
+    inline int32_t toGrid(double v) { return static_cast<int32_t>(std::lround(v)); }
+
+    struct block {
+        std::vector<int32_t> x1, y1, x2, y2;
+
+        size_t size() const { return x1.size(); }
+        void clear();
+        void reserve(size_t n);
+        void push(int32_t ax, int32_t ay, int32_t bx, int32_t by);
+        void push(const cv::Vec4i& l) { push(l[0], l[1], l[2], l[3]); }
+        // floating point coordinates are rounded to the grid
+        template<typename T, typename Segment>
+        void assign(const view<T, Segment>& lines) {
+            clear();
+            reserve(lines.size());
+            for (size_t i = 0; i < lines.size(); ++i)
+                push(toGrid(lines.x1(i)), toGrid(lines.y1(i)), toGrid(lines.x2(i)), toGrid(lines.y2(i)));
+        }
+        void assign(const std::vector<cv::Vec4i>& lines) { assign(view<const int, const cv::Vec4i>(lines)); }
+        // removes candidate i, the order of the others is kept
+        void erase(size_t i);
+        // removes candidate i by moving the last candidate into its place
+        void swapRemove(size_t i);
+    };
+
+    struct match {
+        // of the nearest candidate, size() of the block if it is empty
+        size_t index;
+        // squared
+        int64_t distance;
+        // measured from the second point of the query line
+        bool fromEnd;
+        // the nearest point of the candidate is its second point, it is traversed backwards
+        bool flip;
+    };
+
+    // squared distances between the endpoints of the segments p and q of any type, in
+    // the order p1-q1, p1-q2, p2-q1, p2-q2 (as Algorithms::lineDistanceSquare)
+    template<typename Segment, typename T = typename std::decay<decltype(std::declval<const Segment&>()[0])>::type>
+    std::array<accumulator<T>, 4> distanceSquare(const Segment& p, const Segment& q) {
+        auto d = [](T ax, T ay, T bx, T by) {
+            const accumulator<T> dx = static_cast<accumulator<T>>(bx) - ax, dy = static_cast<accumulator<T>>(by) - ay;
+            return dx * dx + dy * dy;
+        };
+        return {d(p[0], p[1], q[0], q[1]), d(p[0], p[1], q[2], q[3]), d(p[2], p[3], q[0], q[1]), d(p[2], p[3], q[2], q[3])};
+    }
+
+    // nearest endpoint of all candidates to the point (x, y). Ties go to the lower index
+    // and to the first point of a candidate.
+    match nearest(int32_t x, int32_t y, const block& candidates);
+    // nearest pair of endpoints of the query line and all candidates. Ties go to the
+    // lower index and to the pair first in the order of distanceSquare().
+    match nearest(const cv::Vec4i& line, const block& candidates);
+
+    // kernels of nearest(), ordered by width
+    enum class instructions { scalar, sse41, avx2 };
+    // the widest kernel the CPU supports, the one of nearest()
+    instructions getInstructions();
+    bool isSupported(instructions set);
+    // nearest() with the kernel of set, the widest supported one if the CPU lacks set
+    match nearest(int32_t x, int32_t y, const block& candidates, instructions set);
+    match nearest(const cv::Vec4i& line, const block& candidates, instructions set);
+
+    // one candidate at a time, the reference of the batched versions
+    match nearestScalar(int32_t x, int32_t y, const block& candidates);
+    match nearestScalar(const cv::Vec4i& line, const block& candidates);
+
+    // orders the segments in place for short blank moves: starting with the first segment,
+    // the segment with the endpoint nearest to the end of the previous one follows, flipped
+    // if its second point is nearer. Ties go to the segment that came first.
+    // Instantiated for cv::Vec4s, cv::Vec4i, cv::Vec4f and attributed.
+    template<typename T, typename Segment>
+    void order(const view<T, Segment>& lines);
+    inline void order(std::vector<cv::Vec4i>& lines) { order(view<int>(lines)); }
+}
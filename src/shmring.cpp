@@ -0,0 +1,262 @@
+#include "src/shmring.h"
+
+#include <iostream>
+#include <new>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <climits>
+#include <thread>
+#include <chrono>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+namespace shmring {
+
+namespace {
+    const size_t alignment = 64;
+
+    size_t align(size_t n) {
+        return (n + alignment - 1) / alignment * alignment;
+    }
+
+    uint64_t monotonicNow() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+    }
+
+    // the futex works across processes on the shared mapping, elsewhere the
+    // consumer polls
+    void signalWait(std::atomic<uint32_t>& word, uint32_t value, int timeoutMs) {
+#ifdef __linux__
+        timespec ts = {timeoutMs / 1000, (timeoutMs % 1000) * 1000000L};
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, value, &ts, NULL, 0);
+#else
+        if (word.load(std::memory_order_acquire) == value)
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+#endif
+    }
+
+    void signalWake(std::atomic<uint32_t>& word) {
+        word.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+    }
+}
+
+size_t bytesPerPixel(uint32_t fmt) {
+    switch (fmt) {
+    case bgr: return 3;
+    case bgra: return 4;
+    case gray: return 1;
+    default: return 0;
+    }
+}
+
+int ring::create(const std::string& shmName, uint32_t slots, uint64_t slotSize) {
+    close();
+    if (slots < 2 || slots > maxSlots) {
+        std::cerr << "Error: the shared memory ring needs 2 to " << maxSlots << " slots." << std::endl;
+        return -1;
+    }
+    // never takes over the ring of another consumer, its producers would feed both
+    int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno == EEXIST) {
+        std::cerr << "Error: the shared memory " << shmName << " exists already. Another laser display uses it, or a crashed run"
+                  << " left it behind: then remove /dev/shm" << shmName << "." << std::endl;
+        return -1;
+    }
+    if (fd < 0) {
+        std::cerr << "Error while creating the shared memory " << shmName << ": " << std::strerror(errno) << "." << std::endl;
+        return -1;
+    }
+    slotStride = align(sizeof(frameHeader)) + align(slotSize);
+    size = align(sizeof(header)) + slots * slotStride;
+    if (ftruncate(fd, size) != 0) {
+        std::cerr << "Error while allocating " << size << " bytes of shared memory." << std::endl;
+        ::close(fd);
+        shm_unlink(shmName.c_str());
+        return -1;
+    }
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error while mapping the shared memory " << shmName << "." << std::endl;
+        shm_unlink(shmName.c_str());
+        return -1;
+    }
+    base = static_cast<uint8_t*>(mapping);
+    name = shmName;
+    owner = true;
+
+    head = new (base) header;
+    head->version = version;
+    head->slots = slots;
+    head->reserved = 0;
+    head->slotSize = slotSize;
+    head->published.store(0);
+    head->signal.store(0);
+    head->busy.store(0);
+    head->dropped.store(0);
+    for (uint32_t i = 0; i < slots; ++i) {
+        frameHeader* f = new (base + align(sizeof(header)) + i * slotStride) frameHeader;
+        f->sequence.store(0);
+    }
+    // producers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    head->magic = magic;
+    return 0;
+}
+
+int ring::attach(const std::string& shmName) {
+    close();
+    int fd = shm_open(shmName.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+        std::cerr << "Error: no shared memory " << shmName << ", is the laser display running?" << std::endl;
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(header)) {
+        std::cerr << "Error: the shared memory " << shmName << " is not initialized." << std::endl;
+        ::close(fd);
+        return -1;
+    }
+    size = st.st_size;
+    void* mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error while mapping the shared memory " << shmName << "." << std::endl;
+        return -1;
+    }
+    base = static_cast<uint8_t*>(mapping);
+    head = reinterpret_cast<header*>(base);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (head->magic != magic || head->version != version) {
+        std::cerr << "Error: the shared memory " << shmName << " is not a frame ring of version " << version << "." << std::endl;
+        close();
+        return -1;
+    }
+    slotStride = align(sizeof(frameHeader)) + align(head->slotSize);
+    name = shmName;
+    owner = false;
+    // continue the numbering of an earlier producer
+    sequence = head->published.load(std::memory_order_acquire) >> 8;
+    return 0;
+}
+
+void ring::close() {
+    if (base != NULL)
+        munmap(base, size);
+    if (owner)
+        shm_unlink(name.c_str());
+    base = NULL;
+    head = NULL;
+    owner = false;
+    writing = -1;
+}
+
+frameHeader& ring::frame(int slot) const {
+    return *reinterpret_cast<frameHeader*>(base + align(sizeof(header)) + slot * slotStride);
+}
+
+uint8_t* ring::beginFrame() {
+    const uint64_t published = head->published.load(std::memory_order_acquire);
+    const int newest = published == 0 ? -1 : static_cast<int>(published & 0xff);
+    // the slot after the last written one that is neither the newest frame nor in use
+    for (uint32_t i = 1; i <= head->slots; ++i) {
+        const int slot = (writing < 0 ? newest + i : writing + i) % head->slots;
+        if (slot == newest || (head->busy.load() & (1ull << slot)))
+            continue;
+        // invalidate, then check again: a consumer that marked the slot busy in
+        // between sees the invalid sequence and lets it go
+        frame(slot).sequence.store(0);
+        if (head->busy.load() & (1ull << slot))
+            continue;
+        writing = slot;
+        return base + align(sizeof(header)) + slot * slotStride + align(sizeof(frameHeader));
+    }
+    head->dropped.fetch_add(1, std::memory_order_relaxed);
+    writing = -1;
+    return NULL;
+}
+
+bool ring::publish(uint32_t width, uint32_t height, uint32_t fmt, uint32_t stride) {
+    if (writing < 0)
+        return false;
+    if (bytesPerPixel(fmt) == 0 || stride < width * bytesPerPixel(fmt) || static_cast<uint64_t>(stride) * height > head->slotSize) {
+        std::cerr << "Error: the frame does not fit into a slot of " << head->slotSize << " bytes." << std::endl;
+        return false;
+    }
+    frameHeader& f = frame(writing);
+    f.timestamp = monotonicNow();
+    f.width = width;
+    f.height = height;
+    f.format = fmt;
+    f.stride = stride;
+    ++sequence;
+    f.sequence.store(sequence, std::memory_order_release);
+    head->published.store(sequence << 8 | writing, std::memory_order_release);
+    signalWake(head->signal);
+    return true;
+}
+
+uint64_t ring::getSlotSize() const {
+    return head->slotSize;
+}
+
+int ring::acquire(uint64_t last, int timeoutMs) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    while (true) {
+        const uint32_t signal = head->signal.load(std::memory_order_acquire);
+        const uint64_t published = head->published.load(std::memory_order_acquire);
+        const uint64_t seq = published >> 8;
+        if (seq > last) {
+            const int slot = static_cast<int>(published & 0xff);
+            head->busy.fetch_or(1ull << slot);
+            // the producer may have started to overwrite the slot before it saw the mark
+            if (frame(slot).sequence.load() == seq)
+                return slot;
+            release(slot);
+            continue;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
+            return -1;
+        const int remaining = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+        signalWait(head->signal, signal, remaining);
+        // woken without a new frame
+        if (head->signal.load(std::memory_order_acquire) != signal && (head->published.load(std::memory_order_acquire) >> 8) <= last)
+            return -1;
+    }
+}
+
+void ring::release(int slot) {
+    head->busy.fetch_and(~(1ull << slot));
+}
+
+const frameHeader& ring::getFrame(int slot) const {
+    return frame(slot);
+}
+
+const uint8_t* ring::getPixels(int slot) const {
+    return base + align(sizeof(header)) + slot * slotStride + align(sizeof(frameHeader));
+}
+
+uint64_t ring::getDropped() const {
+    return head->dropped.load(std::memory_order_relaxed);
+}
+
+void ring::wake() {
+    signalWake(head->signal);
+}
+
+}
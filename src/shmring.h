@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Frame ingest from other processes over a POSIX shared memory ring. The laser
+// display creates the ring, producers attach to it and publish frames into free
+// slots; the consumer uses the pixels in place. Only depends on the standard
+// library so producers can include it as is.
+namespace shmring {
+    const uint32_t magic = 0x4c445352; // "LDSR"
+    const uint32_t version = 1;
+
+    enum format : uint32_t {
+        bgr = 0,  // 3 bytes per pixel
+        bgra = 1, // 4 bytes per pixel
+        gray = 2  // 1 byte per pixel
+    };
+    size_t bytesPerPixel(uint32_t fmt);
+
+    // in front of the pixels of every slot
+    struct frameHeader {
+        // sequence of the frame in the slot, 0 while the producer writes
+        std::atomic<uint64_t> sequence;
+        // [ns] CLOCK_MONOTONIC at publish
+        uint64_t timestamp;
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;
+        // bytes per row
+        uint32_t stride;
+    };
+
+    // at the start of the shared memory
+    struct header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slots;
+        uint32_t reserved;
+        // capacity of a slot in bytes
+        uint64_t slotSize;
+        // newest frame: sequence << 8 | slot, 0 before the first frame
+        std::atomic<uint64_t> published;
+        // futex word, incremented with every published frame
+        std::atomic<uint32_t> signal;
+        // slots used by the consumer, the producer does not write them (bit mask)
+        std::atomic<uint64_t> busy;
+        // frames the producer could not publish because all slots were in use
+        std::atomic<uint64_t> dropped;
+    };
+
+    const uint32_t maxSlots = 64;
+
+    class ring {
+    public:
+        ring() {}
+        ~ring() { close(); }
+        ring(const ring&) = delete;
+        ring& operator=(const ring&) = delete;
+
+        // consumer: creates the shared memory (name starts with '/')
+        int create(const std::string& name, uint32_t slots, uint64_t slotSize);
+        // producer: maps the shared memory of a running consumer
+        int attach(const std::string& name);
+        void close();
+        bool isOpen() const { return base != NULL; }
+
+        // producer: a free slot to draw into, NULL if all slots are in use. The
+        // frame is visible to the consumer after publish().
+        uint8_t* beginFrame();
+        bool publish(uint32_t width, uint32_t height, uint32_t fmt, uint32_t stride);
+        uint64_t getSlotSize() const;
+
+        // consumer: waits up to timeout for a frame newer than last and marks its slot
+        // as busy until release(). Returns the slot, -1 on timeout or wake().
+        int acquire(uint64_t last, int timeoutMs);
+        void release(int slot);
+        const frameHeader& getFrame(int slot) const;
+        const uint8_t* getPixels(int slot) const;
+        uint64_t getDropped() const;
+        // lets a waiting acquire() return
+        void wake();
+
+    private:
+        frameHeader& frame(int slot) const;
+
+        std::string name;
+        bool owner = false;
+        uint8_t* base = NULL;
+        size_t size = 0;
+        size_t slotStride = 0;
+        header* head = NULL;
+        // producer: slot of the current frame and sequence of the last one
+        int writing = -1;
+        uint64_t sequence = 0;
+    };
+}
@@ -0,0 +1,122 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+// Immutable, versioned snapshots of a value, e.g. the vectorizer parameters changed by
+// the keyboard. One thread publishes a new snapshot by swapping an atomic pointer, any
+// number of readers pin the newest one without locks, one frame at a time. Replaced
+// snapshots are freed by the publisher once no reader has them pinned (hazard pointers).
+namespace snapshot {
+    template<typename T>
+    class publisher {
+    public:
+        struct version {
+            // starts at 1 and grows with every publish(), a key for results computed with value
+            uint64_t number;
+            T value;
+        };
+        static const int maxReaders = 16;
+
+        publisher(const T& initial) : current(new version{1, initial}) {
+            for (int i = 0; i < maxReaders; ++i) {
+                hazards[i].store(NULL);
+                used[i].store(false);
+            }
+        }
+        ~publisher() {
+            delete current.load();
+            for (version* v : retired)
+                delete v;
+        }
+        publisher(const publisher&) = delete;
+        publisher& operator=(const publisher&) = delete;
+
+        // a copy of value becomes the newest snapshot, returns its number. From the
+        // publishing thread only.
+        uint64_t publish(const T& value) {
+            version* next = new version{current.load(std::memory_order_relaxed)->number + 1, value};
+            retired.push_back(current.exchange(next));
+            reclaim();
+            return next->number;
+        }
+        // the newest snapshot, without pinning. From the publishing thread only, it alone
+        // frees snapshots.
+        const version& latest() const { return *current.load(std::memory_order_acquire); }
+
+        // a slot for a reader thread, -1 if all are taken
+        int addReader() {
+            for (int i = 0; i < maxReaders; ++i) {
+                bool expected = false;
+                if (used[i].compare_exchange_strong(expected, true))
+                    return i;
+            }
+            return -1;
+        }
+        void removeReader(int slot) {
+            hazards[slot].store(NULL);
+            used[slot].store(false);
+        }
+
+        // pins the newest snapshot for the reader until release() or the next acquire()
+        const version& acquire(int slot) {
+            version* v = current.load();
+            while (true) {
+                hazards[slot].store(v);
+                // published in between: the pin may have come too late for v
+                version* newest = current.load();
+                if (newest == v)
+                    return *v;
+                v = newest;
+            }
+        }
+        void release(int slot) { hazards[slot].store(NULL, std::memory_order_release); }
+
+        // replaced snapshots that are still pinned
+        size_t getRetired() const { return retired.size(); }
+
+    private:
+        void reclaim() {
+            // the hazards are read after the exchange: a reader that does not show up
+            // here sees the new snapshot on its next load
+            retired.erase(std::remove_if(retired.begin(), retired.end(), [&](version* v) {
+                for (int i = 0; i < maxReaders; ++i)
+                    if (hazards[i].load() == v)
+                        return false;
+                delete v;
+                return true;
+            }), retired.end());
+        }
+
+        std::atomic<version*> current;
+        std::array<std::atomic<version*>, maxReaders> hazards;
+        std::array<std::atomic<bool>, maxReaders> used;
+        // publishing thread only
+        std::vector<version*> retired;
+    };
+
+    // the reader slot of one worker thread
+    template<typename T>
+    class reader {
+    public:
+        reader(publisher<T>& p) : source(p), slot(p.addReader()) {}
+        ~reader() {
+            if (slot >= 0)
+                source.removeReader(slot);
+        }
+        reader(const reader&) = delete;
+        reader& operator=(const reader&) = delete;
+
+        bool isValid() const { return slot >= 0; }
+        // a consistent snapshot for one frame, valid until the next acquire() or release()
+        const typename publisher<T>::version& acquire() { return source.acquire(slot); }
+        void release() { source.release(slot); }
+
+    private:
+        publisher<T>& source;
+        int slot;
+    };
+}
@@ -0,0 +1,211 @@
+#include "src/strokefont.h"
+
+#include <vector>
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+
+#include "src/segments.h"
+
+namespace strokefont {
+
+namespace {
+    // The strokes of a glyph: points as two digits x y on a grid of 5 x 7 (capitals
+    // 0 ... 6, descenders to 7), a space starts a new stroke.
+    struct definition {
+        char c;
+        const char* strokes;
+    };
+
+    const definition definitions[] = {
+        {'A', "0602204246 0343"},
+        {'B', "06003041423344453606 0333"},
+        {'C', "4130100105163645"},
+        {'D', "00304145360600"},
+        {'E', "40000646 0333"},
+        {'F', "400006 0333"},
+        {'G', "41301001051636454323"},
+        {'H', "0006 4046 0343"},
+        {'I', "1030 2026 1636"},
+        {'J', "4045361605"},
+        {'K', "0006 4004 1346"},
+        {'L', "000646"},
+        {'M', "0600234046"},
+        {'N', "06004640"},
+        {'O', "103041453616050110"},
+        {'P', "06003041423303"},
+        {'Q', "103041453616050110 2446"},
+        {'R', "06003041423303 2346"},
+        {'S', "413010010212334445361605"},
+        {'T', "0040 2026"},
+        {'U', "000516364540"},
+        {'V', "002640"},
+        {'W', "0016233640"},
+        {'X', "0046 4006"},
+        {'Y', "002340 2326"},
+        {'Z', "00400646"},
+        {'0', "103041453616050110 4105"},
+        {'1', "112026 1636"},
+        {'2', "01103041420646"},
+        {'3', "0110304142334445361605 1333"},
+        {'4', "36300444"},
+        {'5', "400003334445361605"},
+        {'6', "4130100105163645443303"},
+        {'7', "004016"},
+        {'8', "13020110304142331304051636454433"},
+        {'9', "4313020110304145361605"},
+        {'.', "2526"},
+        {',', "2517"},
+        {'!', "2024 2526"},
+        {'?', "01103041422324 2526"},
+        {'-', "1333"},
+        {'+', "1333 2224"},
+        {'=', "0242 0444"},
+        {'*', "1135 3115 0343"},
+        {'/', "0640"},
+        {':', "2122 2425"},
+        {'\'', "2022"},
+        {'"', "1012 3032"},
+        {'(', "30212536"},
+        {')', "10212516"},
+        {'<', "410345"},
+        {'>', "014305"},
+        {'_', "0646"},
+    };
+
+    // the strokes as segments, ordered for short blank moves as the lines of a frame
+    glyph build(const char* strokes) {
+        std::vector<cv::Vec4i> lines;
+        int minX = 4, maxX = 0;
+        std::vector<std::array<int, 2>> stroke;
+        for (const char* s = strokes; ; ++s) {
+            if (*s == ' ' || *s == '\0') {
+                for (size_t i = 1; i < stroke.size(); ++i)
+                    lines.push_back(cv::Vec4i(stroke[i - 1][0], stroke[i - 1][1], stroke[i][0], stroke[i][1]));
+                stroke.clear();
+                if (*s == '\0')
+                    break;
+                continue;
+            }
+            const int x = s[0] - '0', y = s[1] - '0';
+            stroke.push_back({x, y});
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            ++s;
+        }
+        segments::order(lines);
+
+        glyph g;
+        g.advance = std::max(maxX - minX, 0) + 2;
+        g.points.reserve(2 * lines.size() + 2);
+        bool hasLast = false;
+        int lastX = 0, lastY = 0;
+        for (const cv::Vec4i& l : lines) {
+            // glyphs start at their left edge
+            const int x1 = l[0] - minX, x2 = l[2] - minX;
+            if (!hasLast || x1 != lastX || l[1] != lastY) {
+                if (hasLast)
+                    g.points.push(lastX, lastY, 0, 0, 0);
+                g.points.push(x1, l[1], 0, 0, 0);
+                g.points.push(x1, l[1], 255, 255, 255);
+            }
+            g.points.push(x2, l[3], 255, 255, 255);
+            lastX = x2;
+            lastY = l[3];
+            hasLast = true;
+        }
+        return g;
+    }
+
+    // the glyph scaled and moved to (x, y), lit in the color
+    void append(const glyph& gl, float x, float y, float scale, int r, int g, int b, laser::frame& points) {
+        if (gl.points.empty())
+            return;
+        if (!points.empty())
+            points.push(points.x.back(), points.y.back(), 0, 0, 0);
+        for (size_t i = 0; i < gl.points.size(); ++i) {
+            const int px = static_cast<int>(std::lround(x + gl.points.x[i] * scale));
+            const int py = static_cast<int>(std::lround(y + gl.points.y[i] * scale));
+            if (gl.points.isBlank(i))
+                points.push(px, py, 0, 0, 0);
+            else
+                points.push(px, py, r, g, b);
+        }
+    }
+}
+
+font::font() {
+    for (size_t i = 0; i < glyphs.size(); ++i)
+        glyphs[i].advance = 4; // space and characters without a glyph of their own
+    for (const definition& d : definitions)
+        glyphs[d.c - ' '] = build(d.strokes);
+}
+
+const glyph& font::get(char c) const {
+    c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    if (c == ' ')
+        return glyphs[0];
+    if (c < ' ' || c > '~' || glyphs[c - ' '].points.empty())
+        return glyphs['?' - ' '];
+    return glyphs[c - ' '];
+}
+
+int font::measure(const std::string& text) const {
+    int width = 0;
+    for (char c : text)
+        width += get(c).advance;
+    return width;
+}
+
+void font::render(const std::string& text, float x, float y, float height, int r, int g, int b, laser::frame& points) const {
+    const float scale = height / capHeight;
+    for (char c : text) {
+        const glyph& gl = get(c);
+        append(gl, x, y, scale, r, g, b, points);
+        x += gl.advance * scale;
+    }
+}
+
+ticker::ticker(const font& f, const tickerParameters& parameters)
+    : f(f), parameters(parameters), textWidth(f.measure(parameters.text)) {}
+
+void ticker::render(double seconds, laser::frame& points) const {
+    if (parameters.text.empty())
+        return;
+    const float left = parameters.x * points.width, width = parameters.width * points.width;
+    const float top = parameters.y * points.height, height = parameters.height * points.height;
+    const float scale = height / capHeight;
+    // enters at the right edge and leaves at the left one, then starts over
+    const double distance = width + textWidth * scale;
+    const double offset = std::fmod(seconds * parameters.speed * width, distance);
+    float x = static_cast<float>(left + width - offset);
+    for (char c : parameters.text) {
+        const glyph& gl = f.get(c);
+        const float advance = gl.advance * scale;
+        if (x >= left + width)
+            break;
+        // only whole glyphs, a glyph is drawn 2 units narrower than its advance
+        if (x >= left && x + advance - 2 * scale <= left + width)
+            append(gl, x, top, scale, parameters.color[0], parameters.color[1], parameters.color[2], points);
+        x += advance;
+    }
+}
+
+void getTickerParameters(const libconfig::Config& config, tickerParameters& parameters) {
+    const libconfig::Setting& root = config.getRoot();
+    try {
+        const libconfig::Setting& t = root["application"]["ticker"];
+        t.lookupValue("text", parameters.text);
+        t.lookupValue("x", parameters.x);
+        t.lookupValue("y", parameters.y);
+        t.lookupValue("width", parameters.width);
+        t.lookupValue("height", parameters.height);
+        t.lookupValue("speed", parameters.speed);
+        if (t.exists("color") && t["color"].getLength() == 3) {
+            for (int k = 0; k < 3; ++k)
+                parameters.color[k] = t["color"][k];
+        }
+    } catch(const libconfig::SettingNotFoundException &nfex) {} // Ignore
+}
+
+}
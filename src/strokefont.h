@@ -0,0 +1,71 @@
+#pragma once
+#include <array>
+#include <string>
+#include <libconfig.h++>
+
+#include "src/pointframe.h"
+
+// Text on the laser: a single stroke font (as the Hershey fonts) whose glyphs are ordered
+// and turned into point lists once. Rendering text only concatenates and scales the
+// cached glyphs, no rasterisation and no line detection.
+namespace strokefont {
+    // font units: x to the right, y down, capitals from 0 to 6 on the baseline
+    const int capHeight = 6;
+
+    struct glyph {
+        // starts with a blank point at the first stroke, blank moves only between strokes
+        // that are not connected. Lit points have the color 255, 255, 255.
+        laser::frame points;
+        // to the next glyph, in font units
+        int advance = 0;
+    };
+
+    class font {
+    public:
+        // builds the glyphs of all printable ASCII characters
+        font();
+
+        // lower case letters are shown as capitals, characters without a glyph as '?'
+        const glyph& get(char c) const;
+        // in font units
+        int measure(const std::string& text) const;
+
+        // appends the text with its top left corner at (x, y), capitals height high (in
+        // the coordinates of points), with a blank move from the last point
+        void render(const std::string& text, float x, float y, float height, int r, int g, int b, laser::frame& points) const;
+
+    private:
+        std::array<glyph, 95> glyphs;
+    };
+
+    struct tickerParameters {
+        // nothing is shown without text
+        std::string text;
+        // window of the frame the text scrolls through, normalized to [0, 1]
+        float x = 0;
+        float y = 0.85f;
+        float width = 1;
+        // of the capitals
+        float height = 0.08f;
+        // [window widths / s]
+        float speed = 0.25f;
+        std::array<int, 3> color = {255, 255, 255};
+    };
+
+    // a text scrolling from right to left through a window, endlessly
+    class ticker {
+    public:
+        ticker(const font& f, const tickerParameters& parameters);
+
+        // appends the glyphs inside the window at the time [s] to points, placed by the
+        // frame size of points
+        void render(double seconds, laser::frame& points) const;
+
+    private:
+        const font& f;
+        tickerParameters parameters;
+        int textWidth;
+    };
+
+    void getTickerParameters(const libconfig::Config& config, tickerParameters& parameters);
+}
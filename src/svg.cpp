@@ -0,0 +1,760 @@
+#include "src/svg.h"
+
+#include <opencv2/opencv.hpp>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cmath>
+
+#include "src/segments.h"
+
+namespace svg {
+
+namespace {
+    typedef std::array<float, 2> point;
+    // a b c d e f: x' = a * x + c * y + e, y' = b * x + d * y + f
+    typedef std::array<float, 6> affine;
+    const affine identity = {1, 0, 0, 1, 0, 0};
+    const float pi = 3.14159265358979f;
+
+    // first n, then m
+    affine multiply(const affine& m, const affine& n) {
+        return {m[0] * n[0] + m[2] * n[1], m[1] * n[0] + m[3] * n[1],
+                m[0] * n[2] + m[2] * n[3], m[1] * n[2] + m[3] * n[3],
+                m[0] * n[4] + m[2] * n[5] + m[4], m[1] * n[4] + m[3] * n[5] + m[5]};
+    }
+
+    point map(const affine& m, float x, float y) {
+        return {m[0] * x + m[2] * y + m[4], m[1] * x + m[3] * y + m[5]};
+    }
+
+    // largest stretch of the transformation, for the tolerance of arcs
+    float scaleOf(const affine& m) {
+        return std::max(std::sqrt(m[0] * m[0] + m[1] * m[1]), std::sqrt(m[2] * m[2] + m[3] * m[3]));
+    }
+
+    struct color {
+        bool set = false;
+        bool none = false;
+        uint8_t r = 255, g = 255, b = 255;
+    };
+
+    // inherited by the children of an element
+    struct style {
+        affine transform = identity;
+        color stroke;
+        color fill;
+        bool hidden = false;
+    };
+
+    typedef std::vector<std::pair<std::string, std::string>> attributes;
+
+    const std::string* find(const attributes& attr, const char* name) {
+        for (auto& a : attr)
+            if (a.first == name)
+                return &a.second;
+        return NULL;
+    }
+
+    float number(const attributes& attr, const char* name, float fallback = 0) {
+        const std::string* value = find(attr, name);
+        return value != NULL ? std::strtof(value->c_str(), NULL) : fallback;
+    }
+
+    // numbers in path data and point lists: separated by whitespace and/or commas,
+    // "1.5.5" and "1-2" are two numbers
+    bool nextNumber(const char*& p, float& value) {
+        while (*p != 0 && (std::isspace(static_cast<unsigned char>(*p)) || *p == ','))
+            ++p;
+        char* end;
+        value = std::strtof(p, &end);
+        if (end == p)
+            return false;
+        p = end;
+        return true;
+    }
+
+    // arc flags may be written without separators
+    bool nextFlag(const char*& p, bool& flag) {
+        while (*p != 0 && (std::isspace(static_cast<unsigned char>(*p)) || *p == ','))
+            ++p;
+        if (*p != '0' && *p != '1')
+            return false;
+        flag = (*p == '1');
+        ++p;
+        return true;
+    }
+
+    uint8_t channel(float v) {
+        return static_cast<uint8_t>(std::min(std::max(v, 0.0f), 255.0f));
+    }
+
+    color parseColor(std::string value) {
+        color c;
+        value.erase(0, value.find_first_not_of(" \t"));
+        value.erase(value.find_last_not_of(" \t") + 1);
+        if (value.empty() || value == "inherit")
+            return c;
+        c.set = true;
+        if (value == "none" || value == "transparent") {
+            c.none = true;
+            return c;
+        }
+        if (value[0] == '#') {
+            unsigned int hex = std::strtoul(value.c_str() + 1, NULL, 16);
+            if (value.size() == 4) {
+                c.r = static_cast<uint8_t>(((hex >> 8) & 0xf) * 17);
+                c.g = static_cast<uint8_t>(((hex >> 4) & 0xf) * 17);
+                c.b = static_cast<uint8_t>((hex & 0xf) * 17);
+            } else {
+                c.r = static_cast<uint8_t>((hex >> 16) & 0xff);
+                c.g = static_cast<uint8_t>((hex >> 8) & 0xff);
+                c.b = static_cast<uint8_t>(hex & 0xff);
+            }
+        } else if (value.compare(0, 4, "rgb(") == 0) {
+            const char* p = value.c_str() + 4;
+            float v[3] = {255, 255, 255};
+            for (int i = 0; i < 3 && nextNumber(p, v[i]); ++i) {
+                if (*p == '%') {
+                    v[i] *= 2.55f;
+                    ++p;
+                }
+            }
+            c.r = channel(v[0]);
+            c.g = channel(v[1]);
+            c.b = channel(v[2]);
+        } else {
+            static const std::unordered_map<std::string, uint32_t> names = {
+                {"black", 0x000000}, {"white", 0xffffff}, {"red", 0xff0000}, {"lime", 0x00ff00},
+                {"green", 0x008000}, {"blue", 0x0000ff}, {"yellow", 0xffff00}, {"cyan", 0x00ffff},
+                {"aqua", 0x00ffff}, {"magenta", 0xff00ff}, {"fuchsia", 0xff00ff}, {"orange", 0xffa500},
+                {"purple", 0x800080}, {"gray", 0x808080}, {"grey", 0x808080}, {"pink", 0xffc0cb}
+            };
+            auto it = names.find(value);
+            // unknown names and currentColor are drawn white
+            uint32_t hex = (it != names.end()) ? it->second : 0xffffff;
+            c.r = static_cast<uint8_t>((hex >> 16) & 0xff);
+            c.g = static_cast<uint8_t>((hex >> 8) & 0xff);
+            c.b = static_cast<uint8_t>(hex & 0xff);
+        }
+        return c;
+    }
+
+    affine parseTransform(const std::string& value) {
+        affine m = identity;
+        const char* p = value.c_str();
+        while (*p != 0) {
+            while (*p != 0 && !std::isalpha(static_cast<unsigned char>(*p)))
+                ++p;
+            const char* name = p;
+            while (std::isalpha(static_cast<unsigned char>(*p)))
+                ++p;
+            const std::string function(name, p);
+            while (*p != 0 && *p != '(')
+                ++p;
+            if (*p == 0)
+                break;
+            ++p;
+            float v[6] = {0, 0, 0, 0, 0, 0};
+            int n = 0;
+            while (n < 6 && nextNumber(p, v[n]))
+                ++n;
+            while (*p != 0 && *p != ')')
+                ++p;
+
+            affine t = identity;
+            if (function == "matrix" && n == 6) {
+                t = {v[0], v[1], v[2], v[3], v[4], v[5]};
+            } else if (function == "translate") {
+                t[4] = v[0];
+                t[5] = (n > 1) ? v[1] : 0;
+            } else if (function == "scale") {
+                t[0] = v[0];
+                t[3] = (n > 1) ? v[1] : v[0];
+            } else if (function == "rotate") {
+                const float a = v[0] * pi / 180;
+                const affine r = {std::cos(a), std::sin(a), -std::sin(a), std::cos(a), 0, 0};
+                if (n == 3)
+                    t = multiply(multiply({1, 0, 0, 1, v[1], v[2]}, r), {1, 0, 0, 1, -v[1], -v[2]});
+                else
+                    t = r;
+            } else if (function == "skewX") {
+                t[2] = std::tan(v[0] * pi / 180);
+            } else if (function == "skewY") {
+                t[1] = std::tan(v[0] * pi / 180);
+            }
+            // the transformations of the list are applied from right to left
+            m = multiply(m, t);
+        }
+        return m;
+    }
+
+    // flattens the geometry of one element into polylines in frame coordinates
+    class flattener {
+    public:
+        flattener(document& doc, const affine& m, const color& c, float tolerance)
+            : doc(doc), m(m), c(c), tolerance(tolerance) {}
+
+        void moveTo(float x, float y) {
+            finish();
+            current.points.push_back(map(m, x, y));
+            start = {x, y};
+            last = {x, y};
+        }
+
+        void lineTo(float x, float y) {
+            if (current.points.empty())
+                current.points.push_back(map(m, last[0], last[1]));
+            current.points.push_back(map(m, x, y));
+            last = {x, y};
+        }
+
+        void cubicTo(float x1, float y1, float x2, float y2, float x, float y) {
+            if (current.points.empty())
+                current.points.push_back(map(m, last[0], last[1]));
+            // affine transformations keep Bezier curves, flatten in frame coordinates
+            cubic(map(m, last[0], last[1]), map(m, x1, y1), map(m, x2, y2), map(m, x, y), 0);
+            last = {x, y};
+        }
+
+        void quadTo(float x1, float y1, float x, float y) {
+            // degree elevation
+            cubicTo(last[0] + 2.0f / 3 * (x1 - last[0]), last[1] + 2.0f / 3 * (y1 - last[1]),
+                    x + 2.0f / 3 * (x1 - x), y + 2.0f / 3 * (y1 - y), x, y);
+        }
+
+        // elliptical arc in center parametrization, angles in radians
+        void ellipse(float cx, float cy, float rx, float ry, float phi, float theta, float delta, bool connect) {
+            // the sagitta of every chord stays below the tolerance
+            const float radius = std::max(rx, ry) * scaleOf(m);
+            float step = (radius > tolerance) ? 2 * std::acos(1 - tolerance / radius) : pi / 2;
+            step = std::max(std::min(step, pi / 4), 1e-3f);
+            const int n = std::max(1, static_cast<int>(std::ceil(std::fabs(delta) / step)));
+            const float cosPhi = std::cos(phi), sinPhi = std::sin(phi);
+            for (int i = connect ? 1 : 0; i <= n; ++i) {
+                const float t = theta + delta * i / n;
+                const float x = cx + rx * std::cos(t) * cosPhi - ry * std::sin(t) * sinPhi;
+                const float y = cy + rx * std::cos(t) * sinPhi + ry * std::sin(t) * cosPhi;
+                if (i == 0)
+                    moveTo(x, y);
+                else
+                    lineTo(x, y);
+            }
+        }
+
+        // SVG arc command, endpoint to center parametrization (SVG spec, appendix F.6)
+        void arcTo(float rx, float ry, float angle, bool largeArc, bool sweep, float x, float y) {
+            rx = std::fabs(rx);
+            ry = std::fabs(ry);
+            if (rx == 0 || ry == 0) {
+                lineTo(x, y);
+                return;
+            }
+            const float phi = angle * pi / 180;
+            const float cosPhi = std::cos(phi), sinPhi = std::sin(phi);
+            const float dx = (last[0] - x) / 2, dy = (last[1] - y) / 2;
+            const float x1 = cosPhi * dx + sinPhi * dy;
+            const float y1 = -sinPhi * dx + cosPhi * dy;
+            // scale the radii up if they are too small
+            const float lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+            if (lambda > 1) {
+                rx *= std::sqrt(lambda);
+                ry *= std::sqrt(lambda);
+            }
+            const float num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+            const float den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+            float k = (den > 0) ? std::sqrt(std::max(0.0f, num / den)) : 0;
+            if (largeArc == sweep)
+                k = -k;
+            const float cx1 = k * rx * y1 / ry;
+            const float cy1 = -k * ry * x1 / rx;
+            const float cx = cosPhi * cx1 - sinPhi * cy1 + (last[0] + x) / 2;
+            const float cy = sinPhi * cx1 + cosPhi * cy1 + (last[1] + y) / 2;
+            const float theta = std::atan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+            float delta = std::atan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - theta;
+            if (sweep && delta < 0)
+                delta += 2 * pi;
+            else if (!sweep && delta > 0)
+                delta -= 2 * pi;
+            if (current.points.empty())
+                current.points.push_back(map(m, last[0], last[1]));
+            ellipse(cx, cy, rx, ry, phi, theta, delta, true);
+            last = {x, y};
+        }
+
+        void close() {
+            if (!current.points.empty())
+                lineTo(start[0], start[1]);
+            finish();
+            last = start;
+        }
+
+        void finish() {
+            if (current.points.size() > 1) {
+                current.r = c.r;
+                current.g = c.g;
+                current.b = c.b;
+                doc.paths.push_back(std::move(current));
+            }
+            current = polyline();
+        }
+
+        const point& getLast() const { return last; }
+        const point& getStart() const { return start; }
+
+    private:
+        void cubic(const point& p0, const point& p1, const point& p2, const point& p3, int depth) {
+            // distance of the control points from the chord
+            const float dx = p3[0] - p0[0], dy = p3[1] - p0[1];
+            const float length = std::sqrt(dx * dx + dy * dy);
+            float d1, d2;
+            if (length > 1e-6f) {
+                d1 = std::fabs((p1[0] - p3[0]) * dy - (p1[1] - p3[1]) * dx) / length;
+                d2 = std::fabs((p2[0] - p3[0]) * dy - (p2[1] - p3[1]) * dx) / length;
+            } else {
+                d1 = std::hypot(p1[0] - p0[0], p1[1] - p0[1]);
+                d2 = std::hypot(p2[0] - p0[0], p2[1] - p0[1]);
+            }
+            if (std::max(d1, d2) <= tolerance || depth >= 16) {
+                current.points.push_back(p3);
+                return;
+            }
+            // de Casteljau at t = 0.5
+            const point p01 = {(p0[0] + p1[0]) / 2, (p0[1] + p1[1]) / 2};
+            const point p12 = {(p1[0] + p2[0]) / 2, (p1[1] + p2[1]) / 2};
+            const point p23 = {(p2[0] + p3[0]) / 2, (p2[1] + p3[1]) / 2};
+            const point p012 = {(p01[0] + p12[0]) / 2, (p01[1] + p12[1]) / 2};
+            const point p123 = {(p12[0] + p23[0]) / 2, (p12[1] + p23[1]) / 2};
+            const point mid = {(p012[0] + p123[0]) / 2, (p012[1] + p123[1]) / 2};
+            cubic(p0, p01, p012, mid, depth + 1);
+            cubic(mid, p123, p23, p3, depth + 1);
+        }
+
+        document& doc;
+        affine m;
+        color c;
+        float tolerance;
+        polyline current;
+        point start = {0, 0};
+        point last = {0, 0};
+    };
+
+    void parsePath(const std::string& d, flattener& f) {
+        const char* p = d.c_str();
+        char command = 0;
+        point control = {0, 0}; // last control point for S and T
+        char previous = 0;
+        while (true) {
+            while (*p != 0 && (std::isspace(static_cast<unsigned char>(*p)) || *p == ','))
+                ++p;
+            if (*p == 0)
+                break;
+            if (std::isalpha(static_cast<unsigned char>(*p)))
+                command = *p++;
+            else if (command == 0)
+                break;
+
+            const bool relative = std::islower(static_cast<unsigned char>(command));
+            const float ox = relative ? f.getLast()[0] : 0;
+            const float oy = relative ? f.getLast()[1] : 0;
+            float v[7];
+            bool ok = true;
+            switch (std::toupper(static_cast<unsigned char>(command))) {
+            case 'M':
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1]))) {
+                    f.moveTo(ox + v[0], oy + v[1]);
+                    // following pairs are line commands
+                    command = relative ? 'l' : 'L';
+                }
+                break;
+            case 'L':
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1])))
+                    f.lineTo(ox + v[0], oy + v[1]);
+                break;
+            case 'H':
+                if ((ok = nextNumber(p, v[0])))
+                    f.lineTo(ox + v[0], f.getLast()[1]);
+                break;
+            case 'V':
+                if ((ok = nextNumber(p, v[0])))
+                    f.lineTo(f.getLast()[0], oy + v[0]);
+                break;
+            case 'C':
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1]) && nextNumber(p, v[2]) && nextNumber(p, v[3]) && nextNumber(p, v[4]) && nextNumber(p, v[5]))) {
+                    f.cubicTo(ox + v[0], oy + v[1], ox + v[2], oy + v[3], ox + v[4], oy + v[5]);
+                    control = {ox + v[2], oy + v[3]};
+                }
+                break;
+            case 'S':
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1]) && nextNumber(p, v[2]) && nextNumber(p, v[3]))) {
+                    // reflection of the last control point
+                    point c1 = f.getLast();
+                    if (std::strchr("CcSs", previous) != NULL && previous != 0)
+                        c1 = {2 * f.getLast()[0] - control[0], 2 * f.getLast()[1] - control[1]};
+                    f.cubicTo(c1[0], c1[1], ox + v[0], oy + v[1], ox + v[2], oy + v[3]);
+                    control = {ox + v[0], oy + v[1]};
+                }
+                break;
+            case 'Q':
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1]) && nextNumber(p, v[2]) && nextNumber(p, v[3]))) {
+                    f.quadTo(ox + v[0], oy + v[1], ox + v[2], oy + v[3]);
+                    control = {ox + v[0], oy + v[1]};
+                }
+                break;
+            case 'T':
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1]))) {
+                    point c1 = f.getLast();
+                    if (std::strchr("QqTt", previous) != NULL && previous != 0)
+                        c1 = {2 * f.getLast()[0] - control[0], 2 * f.getLast()[1] - control[1]};
+                    f.quadTo(c1[0], c1[1], ox + v[0], oy + v[1]);
+                    control = c1;
+                }
+                break;
+            case 'A': {
+                bool largeArc = false, sweep = false;
+                if ((ok = nextNumber(p, v[0]) && nextNumber(p, v[1]) && nextNumber(p, v[2]) && nextFlag(p, largeArc) && nextFlag(p, sweep) && nextNumber(p, v[3]) && nextNumber(p, v[4])))
+                    f.arcTo(v[0], v[1], v[2], largeArc, sweep, ox + v[3], oy + v[4]);
+                break;
+            }
+            case 'Z':
+                f.close();
+                command = 0;
+                break;
+            default:
+                ok = false;
+            }
+            if (!ok) {
+                std::cerr << "Warning: invalid SVG path data near \"" << std::string(p).substr(0, 20) << "\"." << std::endl;
+                break;
+            }
+            previous = command != 0 ? command : 'Z';
+        }
+        f.finish();
+    }
+
+    void parsePoints(const std::string& list, bool closed, flattener& f) {
+        const char* p = list.c_str();
+        float x, y;
+        bool first = true;
+        while (nextNumber(p, x) && nextNumber(p, y)) {
+            if (first)
+                f.moveTo(x, y);
+            else
+                f.lineTo(x, y);
+            first = false;
+        }
+        if (closed)
+            f.close();
+        f.finish();
+    }
+
+    // the style attribute overrides the presentation attributes
+    void mergeStyle(attributes& attr) {
+        const std::string* css = find(attr, "style");
+        if (css == NULL)
+            return;
+        std::stringstream stream(*css);
+        std::string declaration;
+        while (std::getline(stream, declaration, ';')) {
+            const size_t colon = declaration.find(':');
+            if (colon == std::string::npos)
+                continue;
+            std::string key = declaration.substr(0, colon);
+            key.erase(0, key.find_first_not_of(" \t\n"));
+            key.erase(key.find_last_not_of(" \t\n") + 1);
+            attr.push_back({key, declaration.substr(colon + 1)});
+        }
+    }
+
+    // last occurrence wins, i.e. the style attribute
+    const std::string* findLast(const attributes& attr, const char* name) {
+        for (auto it = attr.rbegin(); it != attr.rend(); ++it)
+            if (it->first == name)
+                return &it->second;
+        return NULL;
+    }
+
+    void applyStyle(const attributes& attr, style& s) {
+        if (const std::string* t = find(attr, "transform"))
+            s.transform = multiply(s.transform, parseTransform(*t));
+        if (const std::string* c = findLast(attr, "stroke")) {
+            color parsed = parseColor(*c);
+            if (parsed.set)
+                s.stroke = parsed;
+        }
+        if (const std::string* c = findLast(attr, "fill")) {
+            color parsed = parseColor(*c);
+            if (parsed.set)
+                s.fill = parsed;
+        }
+        const std::string* display = findLast(attr, "display");
+        const std::string* visibility = findLast(attr, "visibility");
+        if ((display != NULL && display->find("none") != std::string::npos) ||
+            (visibility != NULL && visibility->find("hidden") != std::string::npos))
+            s.hidden = true;
+    }
+
+    // the laser draws the outline in the stroke color, or in the fill color for filled shapes.
+    // Black cannot be shown by a laser and is drawn white.
+    bool outlineColor(const style& s, color& c) {
+        if (s.hidden)
+            return false;
+        if (s.stroke.set && !s.stroke.none)
+            c = s.stroke;
+        else if (!s.fill.set || !s.fill.none)
+            c = s.fill;
+        else
+            return false;
+        if (c.r == 0 && c.g == 0 && c.b == 0)
+            c.r = c.g = c.b = 255;
+        return true;
+    }
+
+    void parseShape(const std::string& name, const attributes& attr, const style& s, float tolerance, document& doc) {
+        color c;
+        if (!outlineColor(s, c))
+            return;
+        // lines have no area to fill
+        if (name == "line" && s.stroke.set && s.stroke.none)
+            return;
+        flattener f(doc, s.transform, c, tolerance);
+        if (name == "path") {
+            if (const std::string* d = find(attr, "d"))
+                parsePath(*d, f);
+        } else if (name == "line") {
+            f.moveTo(number(attr, "x1"), number(attr, "y1"));
+            f.lineTo(number(attr, "x2"), number(attr, "y2"));
+            f.finish();
+        } else if (name == "polyline" || name == "polygon") {
+            if (const std::string* list = find(attr, "points"))
+                parsePoints(*list, name == "polygon", f);
+        } else if (name == "rect") {
+            const float x = number(attr, "x"), y = number(attr, "y");
+            const float w = number(attr, "width"), h = number(attr, "height");
+            f.moveTo(x, y);
+            f.lineTo(x + w, y);
+            f.lineTo(x + w, y + h);
+            f.lineTo(x, y + h);
+            f.close();
+        } else if (name == "circle") {
+            const float r = number(attr, "r");
+            f.ellipse(number(attr, "cx"), number(attr, "cy"), r, r, 0, 0, 2 * pi, false);
+            f.finish();
+        } else if (name == "ellipse") {
+            f.ellipse(number(attr, "cx"), number(attr, "cy"), number(attr, "rx"), number(attr, "ry"), 0, 0, 2 * pi, false);
+            f.finish();
+        }
+    }
+
+    // root transformation: the viewBox onto a frame with the given resolution
+    void setupViewport(const attributes& attr, int resolution, document& doc, style& s, bool& fitBounds) {
+        float box[4] = {0, 0, 0, 0};
+        const std::string* viewBox = find(attr, "viewBox");
+        const char* p = viewBox != NULL ? viewBox->c_str() : "";
+        if (!(nextNumber(p, box[0]) && nextNumber(p, box[1]) && nextNumber(p, box[2]) && nextNumber(p, box[3]))) {
+            box[0] = box[1] = 0;
+            box[2] = number(attr, "width");
+            box[3] = number(attr, "height");
+        }
+        fitBounds = !(box[2] > 0 && box[3] > 0);
+        if (fitBounds)
+            return;
+        const float scale = resolution / std::max(box[2], box[3]);
+        s.transform = {scale, 0, 0, scale, -box[0] * scale, -box[1] * scale};
+        doc.width = static_cast<int>(std::lround(box[2] * scale));
+        doc.height = static_cast<int>(std::lround(box[3] * scale));
+    }
+
+    // without viewBox and size: scale the bounding box of the drawing onto the frame
+    void fitToBounds(int resolution, document& doc) {
+        float x0 = 1e30f, y0 = 1e30f, x1 = -1e30f, y1 = -1e30f;
+        for (auto& path : doc.paths) {
+            for (auto& q : path.points) {
+                x0 = std::min(x0, q[0]); y0 = std::min(y0, q[1]);
+                x1 = std::max(x1, q[0]); y1 = std::max(y1, q[1]);
+            }
+        }
+        if (x1 < x0)
+            return;
+        const float scale = resolution / std::max(std::max(x1 - x0, y1 - y0), 1e-6f);
+        for (auto& path : doc.paths) {
+            for (auto& q : path.points) {
+                q[0] = (q[0] - x0) * scale;
+                q[1] = (q[1] - y0) * scale;
+            }
+        }
+        doc.width = std::max(1, static_cast<int>(std::lround((x1 - x0) * scale)));
+        doc.height = std::max(1, static_cast<int>(std::lround((y1 - y0) * scale)));
+    }
+
+    // elements whose content is not drawn
+    bool isSkipped(const std::string& name) {
+        static const char* skipped[] = {"defs", "clipPath", "mask", "symbol", "marker", "pattern", "style",
+                                        "title", "desc", "metadata", "text", "linearGradient", "radialGradient"};
+        for (const char* s : skipped)
+            if (name == s)
+                return true;
+        return false;
+    }
+}
+
+int parse(const std::string& text, float tolerance, int resolution, document& doc) {
+    doc = document();
+    std::vector<style> stack(1);
+    bool fitBounds = true;
+    bool foundRoot = false;
+
+    size_t pos = 0;
+    while ((pos = text.find('<', pos)) != std::string::npos) {
+        if (text.compare(pos, 4, "<!--") == 0) {
+            pos = text.find("-->", pos);
+            if (pos == std::string::npos)
+                break;
+            continue;
+        }
+        if (text.compare(pos, 2, "<?") == 0 || text.compare(pos, 2, "<!") == 0) {
+            pos = text.find('>', pos);
+            continue;
+        }
+        if (text.compare(pos, 2, "</") == 0) {
+            if (stack.size() > 1)
+                stack.pop_back();
+            pos = text.find('>', pos);
+            continue;
+        }
+
+        // element name
+        size_t p = pos + 1;
+        while (p < text.size() && !std::isspace(static_cast<unsigned char>(text[p])) && text[p] != '>' && text[p] != '/')
+            ++p;
+        std::string name = text.substr(pos + 1, p - pos - 1);
+        const size_t colon = name.find(':');
+        if (colon != std::string::npos)
+            name = name.substr(colon + 1); // svg:path
+
+        // attributes
+        attributes attr;
+        bool selfClosing = false;
+        while (p < text.size()) {
+            while (p < text.size() && std::isspace(static_cast<unsigned char>(text[p])))
+                ++p;
+            if (p >= text.size())
+                break;
+            if (text[p] == '>') {
+                ++p;
+                break;
+            }
+            if (text[p] == '/') {
+                selfClosing = true;
+                ++p;
+                continue;
+            }
+            const size_t keyStart = p;
+            while (p < text.size() && text[p] != '=' && text[p] != '>' && !std::isspace(static_cast<unsigned char>(text[p])))
+                ++p;
+            std::string key = text.substr(keyStart, p - keyStart);
+            while (p < text.size() && (std::isspace(static_cast<unsigned char>(text[p])) || text[p] == '='))
+                ++p;
+            if (p < text.size() && (text[p] == '"' || text[p] == '\'')) {
+                const char quote = text[p];
+                const size_t end = text.find(quote, p + 1);
+                if (end == std::string::npos)
+                    break;
+                attr.push_back({key, text.substr(p + 1, end - p - 1)});
+                p = end + 1;
+            }
+        }
+        pos = p;
+
+        if (isSkipped(name)) {
+            if (!selfClosing) {
+                const size_t end = text.find("</" + name, pos);
+                pos = (end == std::string::npos) ? text.size() : text.find('>', end);
+            }
+            continue;
+        }
+
+        mergeStyle(attr);
+        style s = stack.back();
+        if (name == "svg" && !foundRoot) {
+            setupViewport(attr, resolution, doc, s, fitBounds);
+            foundRoot = true;
+        }
+        applyStyle(attr, s);
+        parseShape(name, attr, s, tolerance, doc);
+        if (!selfClosing)
+            stack.push_back(s);
+    }
+
+    if (!foundRoot) {
+        std::cerr << "Error: no <svg> element found." << std::endl;
+        return -1;
+    }
+    if (fitBounds)
+        fitToBounds(resolution, doc);
+    return 0;
+}
+
+int load(const std::string& fileName, float tolerance, int resolution, document& doc) {
+    std::ifstream file(fileName);
+    if (!file) {
+        std::cerr << "Error: could not open " << fileName << "." << std::endl;
+        return -1;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    if (parse(buffer.str(), tolerance, resolution, doc) != 0)
+        return -1;
+    size_t vertices = 0;
+    for (auto& path : doc.paths)
+        vertices += path.points.size();
+    std::cout << "SVG: " << doc.paths.size() << " paths, " << vertices << " vertices, frame " << doc.width << " x " << doc.height << std::endl;
+    return 0;
+}
+
+void generatePoints(const document& doc, laser::frame& points) {
+    // segments on the integer grid of the frame with the color of their path as fifth
+    // element, so it moves with the segment through the ordering
+    std::vector<segments::attributed> lines;
+    for (auto& path : doc.paths) {
+        const int color = (path.r << 16) | (path.g << 8) | path.b;
+        for (size_t i = 1; i < path.points.size(); ++i) {
+            const int x1 = static_cast<int>(std::lround(path.points[i - 1][0]));
+            const int y1 = static_cast<int>(std::lround(path.points[i - 1][1]));
+            const int x2 = static_cast<int>(std::lround(path.points[i][0]));
+            const int y2 = static_cast<int>(std::lround(path.points[i][1]));
+            if (x1 == x2 && y1 == y2)
+                continue;
+            lines.push_back(segments::attributed(x1, y1, x2, y2, color));
+        }
+    }
+    segments::order(segments::view<int, segments::attributed>(lines));
+
+    points.clear();
+    points.reserve(2 * lines.size() + 16);
+    points.width = doc.width;
+    points.height = doc.height;
+    bool hasLast = false;
+    int lastX = 0, lastY = 0;
+    for (const segments::attributed& l : lines) {
+        const int r = (l[4] >> 16) & 0xff, g = (l[4] >> 8) & 0xff, b = l[4] & 0xff;
+        if (!hasLast || l[0] != lastX || l[1] != lastY) {
+            // blank move, connected segments are drawn without
+            if (hasLast)
+                points.push(lastX, lastY, 0, 0, 0);
+            points.push(l[0], l[1], 0, 0, 0);
+            points.push(l[0], l[1], r, g, b);
+        }
+        points.push(l[2], l[3], r, g, b);
+        lastX = l[2];
+        lastY = l[3];
+        hasLast = true;
+    }
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <string>
+#include <cstdint>
+
+#include "src/pointframe.h"
+
+namespace svg {
+    // flattened path, in frame coordinates
+    struct polyline {
+        std::vector<std::array<float, 2>> points;
+        uint8_t r = 255, g = 255, b = 255;
+    };
+
+    struct document {
+        // frame size, the longer side is the resolution given to parse()
+        int width = 0;
+        int height = 0;
+        std::vector<polyline> paths;
+    };
+
+    // Parses path, line, polyline, polygon, rect, circle and ellipse elements with
+    // group transforms and stroke/fill colors. Curves and arcs are flattened until the
+    // polyline deviates less than tolerance (in frame units) from the curve. The frame
+    // is scaled so that its longer side has resolution units, finer than the preview
+    // and the line detection, so the drawing keeps its precision.
+    int parse(const std::string& text, float tolerance, int resolution, document& doc);
+    int load(const std::string& fileName, float tolerance, int resolution, document& doc);
+
+    // order the segments with the line sorting of the raster pipeline and generate
+    // the laser points, blank moves only where the drawing is not connected
+    void generatePoints(const document& doc, laser::frame& points);
+}
@@ -0,0 +1,217 @@
+#include "src/trace.h"
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+namespace trace {
+
+namespace {
+    const char* names[numberOfStages] = {
+        "decode", "blur", "gray", "canny", "dilate", "hough", "sort", "color", "points", "submit"
+    };
+
+    // single producer (the owning thread), single consumer (collect)
+    struct ring {
+        static const size_t capacity = 4096; // power of two
+        std::array<event, capacity> events;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        uint32_t thread = 0;
+        // the owning thread has ended, set after its last event
+        std::atomic<bool> finished{false};
+    };
+
+    // the ring of a thread, marked as finished when the thread ends
+    struct owner {
+        std::shared_ptr<ring> r;
+        ~owner() {
+            if (r)
+                r->finished.store(true, std::memory_order_release);
+        }
+    };
+
+    // samples of the last frames, for the percentiles
+    struct window {
+        static const size_t capacity = 512;
+        std::vector<double> samples;
+        size_t next = 0;
+
+        void add(double value) {
+            if (samples.size() < capacity) {
+                samples.push_back(value);
+            } else {
+                samples[next] = value;
+                next = (next + 1) % capacity;
+            }
+        }
+    };
+
+    std::atomic<bool> enabled{false};
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> dropped{0};
+
+    // the rings are owned here, so that they outlive their threads until collected
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<ring>> rings;
+    uint32_t threads = 0;
+
+    // only touched by collect and the readers of the statistics
+    std::mutex historyMutex;
+    const size_t historySize = 1 << 18;
+    std::deque<event> history;
+    std::array<window, numberOfStages> stages;
+    window latency;
+    // begin of the capture of the last frames, indexed by frame id
+    const size_t captureSlots = 1024;
+    std::array<std::pair<uint64_t, int64_t>, captureSlots> captures;
+
+    ring& threadRing() {
+        thread_local owner local;
+        if (!local.r) {
+            local.r = std::make_shared<ring>();
+            std::lock_guard<std::mutex> lock(registryMutex);
+            local.r->thread = threads++;
+            rings.push_back(local.r);
+        }
+        return *local.r;
+    }
+
+    percentiles evaluate(const window& w) {
+        percentiles p;
+        p.samples = w.samples.size();
+        if (p.samples == 0)
+            return p;
+        std::vector<double> s = w.samples;
+        auto rank = [&](double q) {
+            size_t k = std::min(s.size() - 1, static_cast<size_t>(q * s.size()));
+            std::nth_element(s.begin(), s.begin() + k, s.end());
+            return s[k];
+        };
+        p.p50 = rank(0.50);
+        p.p95 = rank(0.95);
+        p.p99 = rank(0.99);
+        return p;
+    }
+}
+
+const char* stageName(stage s) {
+    return s < numberOfStages ? names[s] : "unknown";
+}
+
+void enable(bool on) {
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+bool isEnabled() {
+    return enabled.load(std::memory_order_relaxed);
+}
+
+uint64_t nextFrame() {
+    return ++frames;
+}
+
+void record(uint64_t frame, stage s, int64_t begin, int64_t end) {
+    if (!isEnabled())
+        return;
+    ring& r = threadRing();
+    const size_t head = r.head.load(std::memory_order_relaxed);
+    if (head - r.tail.load(std::memory_order_acquire) >= ring::capacity) {
+        // the consumer is behind, never block the pipeline
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    r.events[head & (ring::capacity - 1)] = {frame, static_cast<uint32_t>(s), r.thread, begin, end};
+    r.head.store(head + 1, std::memory_order_release);
+}
+
+void collect() {
+    std::vector<std::shared_ptr<ring>> current;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        current = rings;
+    }
+
+    // collect is only called from one thread, keep the buffer between the calls
+    static std::vector<event> drained;
+    drained.clear();
+    std::vector<std::shared_ptr<ring>> finished;
+    for (auto& r : current) {
+        // a finished thread does not record anymore, its ring is empty once drained
+        if (r->finished.load(std::memory_order_acquire))
+            finished.push_back(r);
+        const size_t head = r->head.load(std::memory_order_acquire);
+        size_t tail = r->tail.load(std::memory_order_relaxed);
+        for (; tail != head; ++tail)
+            drained.push_back(r->events[tail & (ring::capacity - 1)]);
+        r->tail.store(tail, std::memory_order_release);
+    }
+    if (!finished.empty()) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (auto& r : finished)
+            rings.erase(std::find(rings.begin(), rings.end(), r));
+    }
+
+    std::lock_guard<std::mutex> lock(historyMutex);
+    // the captures first, the submit of a frame may be drained from another ring
+    for (const event& e : drained)
+        if (e.stage == decode)
+            captures[e.frame % captureSlots] = {e.frame, e.begin};
+    for (const event& e : drained) {
+        stages[e.stage].add((e.end - e.begin) * 1e-6);
+        if (e.stage == submit) {
+            const auto& c = captures[e.frame % captureSlots];
+            if (c.first == e.frame)
+                latency.add((e.end - c.second) * 1e-6);
+        }
+        history.push_back(e);
+    }
+    while (history.size() > historySize)
+        history.pop_front();
+}
+
+percentiles getPercentiles(stage s) {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    return evaluate(stages[s]);
+}
+
+percentiles getLatency() {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    return evaluate(latency);
+}
+
+uint64_t getDroppedEvents() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+int writeChromeTrace(const std::string& fileName) {
+    std::ofstream file(fileName);
+    if (!file) {
+        std::cerr << "Error: could not write trace file " << fileName << std::endl;
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(historyMutex);
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    char buffer[256];
+    bool first = true;
+    for (const event& e : history) {
+        // complete events, timestamps in microseconds
+        std::snprintf(buffer, sizeof(buffer), "%s\n{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                      first ? "" : ",", names[e.stage], e.thread, e.begin * 1e-3, (e.end - e.begin) * 1e-3, static_cast<unsigned long long>(e.frame));
+        file << buffer;
+        first = false;
+    }
+    file << "\n]}\n";
+    std::cout << "Wrote " << history.size() << " trace events to " << fileName << std::endl;
+    return 0;
+}
+
+}
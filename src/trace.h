@@ -0,0 +1,85 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace trace {
+    // pipeline stages that are timed for every frame
+    enum stage {
+        decode, blur, gray, canny, dilate, hough, sort, color, points, submit,
+        numberOfStages
+    };
+    const char* stageName(stage s);
+
+    // one timed span of a frame
+    struct event {
+        uint64_t frame;
+        uint32_t stage;
+        uint32_t thread;
+        int64_t begin; // [ns] since the start of the program
+        int64_t end;
+    };
+
+    // percentiles of the last samples of a stage [ms]
+    struct percentiles {
+        double p50 = 0;
+        double p95 = 0;
+        double p99 = 0;
+        size_t samples = 0;
+    };
+
+    // tracing is off unless enabled, a disabled trace costs one branch per span
+    void enable(bool on);
+    bool isEnabled();
+
+    // [ns] since the start of the program
+    inline int64_t now() {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    // a new frame id, called when a frame is captured
+    uint64_t nextFrame();
+
+    // store a span in the lock-free ring buffer of the calling thread, the buffer is freed
+    // by collect() once the thread has ended
+    void record(uint64_t frame, stage s, int64_t begin, int64_t end);
+
+    // times the lifetime of the object, next() ends the current span and starts the following
+    class scope {
+    public:
+        scope(uint64_t frame, stage s) : frame(frame), s(s), active(isEnabled()), begin(active ? now() : 0) {}
+        ~scope() {
+            if (active)
+                record(frame, s, begin, now());
+        }
+        void next(stage following) {
+            if (active) {
+                int64_t end = now();
+                record(frame, s, begin, end);
+                begin = end;
+            }
+            s = following;
+        }
+    private:
+        uint64_t frame;
+        stage s;
+        // tracing was enabled when the span started
+        bool active;
+        int64_t begin;
+    };
+
+    // move the events of all threads into the history and update the statistics,
+    // called regularly from one thread (the main loop)
+    void collect();
+
+    // live statistics of the collected events
+    percentiles getPercentiles(stage s);
+    // capture (begin of decode) to laser (end of submit)
+    percentiles getLatency();
+    // events that did not fit into a ring buffer
+    uint64_t getDroppedEvents();
+
+    // write the collected history as Chrome trace JSON (chrome://tracing, Perfetto)
+    int writeChromeTrace(const std::string& fileName);
+}
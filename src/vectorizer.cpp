@@ -0,0 +1,196 @@
+#include "src/vectorizer.h"
+
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+
+#include "GameLibrary/algorithms.h"
+#include "src/color.h"
+#include "src/trace.h"
+
+namespace vectorizer {
+
+void getParameters(const libconfig::Setting& opencv, vectorizerParameters& parameters) {
+    opencv.lookupValue("fillShortBlanks", parameters.fillShortBlanks);
+    opencv.lookupValue("lightThreshold", parameters.lightThreshold);
+    opencv.lookupValue("interThreshold", parameters.interThreshold);
+    opencv.lookupValue("minLineLength", parameters.minLineLength);
+    opencv.lookupValue("maxLineGap", parameters.maxLineGap);
+    opencv.lookupValue("blursize", parameters.blursize);
+    opencv.lookupValue("upperThreshold", parameters.upperThreshold);
+    opencv.lookupValue("lowerThreshold", parameters.lowerThreshold);
+    opencv.lookupValue("rResolution", parameters.rResolution);
+    opencv.lookupValue("thetaResolution", parameters.thetaResolution);
+    opencv.lookupValue("colorBoost", parameters.colorBoost);
+}
+
+cv::Mat crop(const cv::Mat& img, std::array<int, 4> cropDim) {
+    if (cropDim[0] == 0 && cropDim[1] == 0 && cropDim[2] == 0 && cropDim[3] == 0)
+        return img;
+    cropDim[0] = algorithms::constrain(cropDim[0], 0, img.cols / 2);
+    cropDim[1] = algorithms::constrain(cropDim[1], 0, img.rows / 2);
+    cropDim[2] = algorithms::constrain(cropDim[2], 0, img.cols / 2);
+    cropDim[3] = algorithms::constrain(cropDim[3], 0, img.rows / 2);
+    // Crop the full image to that image contained by the rectangle crop
+    cv::Rect rect(cropDim[0], cropDim[1], img.cols - cropDim[0] - cropDim[2], img.rows - cropDim[1] - cropDim[3]);
+    return img(rect);
+}
+
+cv::Mat preview(const cv::Mat& img) {
+    if (img.channels() != 4)
+        return img;
+    cv::Mat bgr;
+    cv::cvtColor(img, bgr, cv::COLOR_BGRA2BGR);
+    return bgr;
+}
+
+void vectorize(const cv::Mat& img, const vectorizerParameters& parameters, std::vector<cv::Vec4i>& houghLines, laser::frame& points, cv::Mat& display) {
+#if OCVSTEP == 0
+    // the preview is BGR, screen captures are BGRA
+    if (img.channels() == 4)
+        cv::cvtColor(img, display, cv::COLOR_BGRA2BGR);
+    else
+        display = img.clone();
+#endif
+
+// TODO: test if HSV threshold may improve object detection
+#if 0
+    // HSV threshold detection
+    // Convert from BGR to HSV colorspace
+    cv::Mat imgHSV;
+    cv::cvtColor(img, imgHSV, cv::COLOR_BGR2HSV);
+    // Detect the object based on HSV Range Values
+    cv::Mat img_threshold;
+    int max_value = 255;
+    int max_value_H = 360/2;
+    int low_H = 0;
+    int low_S = 0;
+    int low_V = 0;
+    int high_H = max_value_H;
+    int high_S = max_value;
+    int high_V = max_value;
+    cv::inRange(imgHSV, cv::Scalar(low_H, low_S, low_V), cv::Scalar(high_H, high_S, high_V), img_threshold);
+#if OCVSTEP == 1
+    display = img_threshold.clone();
+    //cv::cvtColor(display, display, cv::COLOR_HSV2BGR);
+#endif
+#endif
+
+    // the stages are timed with the id of the captured frame
+    trace::scope span(points.sequence, trace::blur);
+
+    // Blur the image for better edge detection
+    cv::Mat img_blur;
+    cv::GaussianBlur(img, img_blur, cv::Size(parameters.blursize, parameters.blursize), 0);
+#if OCVSTEP == 2
+    display = img_blur.clone();
+#endif
+
+    // Convert to graycsale
+    span.next(trace::gray);
+    cv::Mat img_gray;
+    cv::cvtColor(img_blur, img_gray, img.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+#if OCVSTEP == 3
+    display = img_gray.clone();
+    // convert to original color space, preserving content
+    cv::cvtColor(display, display, cv::COLOR_GRAY2RGB);
+#endif
+
+    // Canny edge detection
+    span.next(trace::canny);
+    cv::Mat edges;
+    cv::Canny(img_gray, edges, parameters.lowerThreshold, parameters.upperThreshold, 3, false);
+#if OCVSTEP == 4
+    display = edges.clone();
+    // convert to original color space, preserving content
+    cv::cvtColor(display, display, cv::COLOR_GRAY2RGB);
+#endif
+
+    // dilate the lines (thicken)
+    span.next(trace::dilate);
+    int dilationSize = 1;
+    int erosionType = cv::MORPH_ELLIPSE; // MORPH_RECT, MORPH_CROSS, MORPH_ELLIPSE
+    cv::Mat element = cv::getStructuringElement(erosionType, cv::Size(2*dilationSize + 1, 2*dilationSize+1), cv::Point(dilationSize, dilationSize));
+    cv::dilate(edges, edges, element);
+#if OCVSTEP == 5
+    display = edges.clone();
+    // convert to original color space, preserving content
+    cv::cvtColor(display, display, cv::COLOR_GRAY2RGB);
+#endif
+
+    // probabilistic Hough Line Transform
+    span.next(trace::hough);
+    houghLines.clear(); // HoughLinesP: will hold the results of the detection
+    HoughLinesP(edges, houghLines, parameters.rResolution, parameters.thetaResolution, parameters.interThreshold, parameters.minLineLength, parameters.maxLineGap);
+    // order the lines for short blank moves
+    span.next(trace::sort);
+    segments::order(houghLines);
+
+    // Draw the lines
+    span.next(trace::color);
+    cv::Mat lines = edges.clone(); // copy to have a matrix with the right size
+    lines.setTo(cv::Scalar(0, 0, 0));
+    for(size_t i = 0; i < houghLines.size(); ++i) {
+        cv::Vec4i l = houghLines[i];
+        cv::line(lines, cv::Point(l[0], l[1]), cv::Point(l[2], l[3]), cv::Scalar(255, 255, 255), 1, cv::LINE_AA);
+    }
+    // convert to original color space, preserving content
+    cv::cvtColor(lines, lines, img.channels() == 4 ? cv::COLOR_GRAY2BGRA : cv::COLOR_GRAY2RGB);
+#if OCVSTEP == 6
+    display = lines.clone();
+#endif
+
+    // use lines as mask and multiply original image with mask
+    cv::bitwise_and(img, lines, lines);
+#if OCVSTEP == 7
+    display = lines.clone();
+#endif
+
+    span.next(trace::points);
+    generatePoints(img, lines, houghLines, parameters, points);
+}
+
+template<typename T, typename Segment>
+void generatePoints(const cv::Mat& img, const cv::Mat& lines, const segments::view<T, Segment>& lineSegments, const vectorizerParameters& parameters, laser::frame& points) {
+    points.clear();
+    points.reserve(4 * lineSegments.size());
+    points.width = img.cols;
+    points.height = img.rows;
+
+    int lastLaser[2] = {img.cols / 2, img.rows / 2};
+    for(size_t i = 0; i < lineSegments.size(); ++i) {
+        const int l[4] = {segments::toGrid(lineSegments.x1(i)), segments::toGrid(lineSegments.y1(i)), segments::toGrid(lineSegments.x2(i)), segments::toGrid(lineSegments.y2(i))};
+        // BGR or BGRA
+        const uint8_t* intensity1 = lines.ptr<uint8_t>(algorithms::constrain<int>(l[1], 0, lines.rows - 1)) + lines.channels() * algorithms::constrain<int>(l[0], 0, lines.cols - 1);
+        const uint8_t* intensity2 = lines.ptr<uint8_t>(algorithms::constrain<int>(l[3], 0, lines.rows - 1)) + lines.channels() * algorithms::constrain<int>(l[2], 0, lines.cols - 1);
+
+        int blue  = algorithms::constrain<int>((intensity1[0] + intensity2[0]) / 2, 0, 255);
+        int green = algorithms::constrain<int>((intensity1[1] + intensity2[1]) / 2, 0, 255);
+        int red   = algorithms::constrain<int>((intensity1[2] + intensity2[2]) / 2, 0, 255);
+
+        // sort out dark lines
+        if ((blue + green + red) >= parameters.lightThreshold) {
+            // color boost
+            if (parameters.colorBoost)
+                color::boost(red, green, blue);
+
+            const int64_t dx = l[0] - lastLaser[0], dy = l[1] - lastLaser[1];
+            if (std::sqrt(static_cast<double>(dx * dx + dy * dy)) > parameters.fillShortBlanks) {
+                // blank move
+                points.push(lastLaser[0], lastLaser[1], 0, 0, 0);
+                points.push(l[0], l[1], 0, 0, 0);
+            }
+            // laser line
+            points.push(l[0], l[1], red, green, blue);
+            points.push(l[2], l[3], red, green, blue);
+            // store the last laser point
+            lastLaser[0] = l[2];
+            lastLaser[1] = l[3];
+        }
+    }
+}
+
+template void generatePoints(const cv::Mat&, const cv::Mat&, const segments::view<const short, const cv::Vec4s>&, const vectorizerParameters&, laser::frame&);
+template void generatePoints(const cv::Mat&, const cv::Mat&, const segments::view<const int, const cv::Vec4i>&, const vectorizerParameters&, laser::frame&);
+template void generatePoints(const cv::Mat&, const cv::Mat&, const segments::view<const float, const cv::Vec4f>&, const vectorizerParameters&, laser::frame&);
+
+}
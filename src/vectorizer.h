@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <array>
+#include <opencv2/opencv.hpp>
+#include <libconfig.h++>
+
+#include "src/parameters.h"
+#include "src/pointframe.h"
+#include "src/segments.h"
+
+// which step of the openCV pipeline is shown in the SDL window, 0 shows the input
+#define OCVSTEP 0
+
+namespace vectorizer {
+    // the settings of an opencv section, missing ones are kept
+    void getParameters(const libconfig::Setting& opencv, vectorizerParameters& parameters);
+
+    // remove the given number of pixels (left, up, right, down) from the borders,
+    // at most half of the image per side
+    cv::Mat crop(const cv::Mat& img, std::array<int, 4> cropDim);
+
+    // the image as BGR for the preview, not copied if it is BGR already
+    cv::Mat preview(const cv::Mat& img);
+
+    // Blur, gray, Canny, dilate and probabilistic Hough transform, the lines are sorted
+    // for minimal blank moves. Generates the laser points in pixel coordinates of img,
+    // colored by the image along the lines. display is the image of step OCVSTEP.
+    void vectorize(const cv::Mat& img, const vectorizerParameters& parameters, std::vector<cv::Vec4i>& houghLines, laser::frame& points, cv::Mat& display);
+
+    // color every line by the image and generate the laser points with blank moves.
+    // Instantiated for read-only views of cv::Vec4s, cv::Vec4i and cv::Vec4f.
+    template<typename T, typename Segment>
+    void generatePoints(const cv::Mat& img, const cv::Mat& lines, const segments::view<T, Segment>& lineSegments, const vectorizerParameters& parameters, laser::frame& points);
+    inline void generatePoints(const cv::Mat& img, const cv::Mat& lines, const std::vector<cv::Vec4i>& houghLines, const vectorizerParameters& parameters, laser::frame& points) {
+        generatePoints(img, lines, segments::view<const int, const cv::Vec4i>(houghLines), parameters, points);
+    }
+}
@@ -1,54 +1,35 @@
-// g++ -std=c++17 img-from-display.cpp $(pkg-config --libs --cflags opencv4) -I/opt/X11/include/ -L/opt/local/lib -lX11 -o test
+// g++ -std=c++17 -DX11_CAPTURE -I.. img-from-display.cpp ../src/screen.cpp $(pkg-config --libs --cflags opencv4) -I/opt/X11/include/ -L/opt/local/lib -lX11 -lXext -o test
 #include <opencv2/opencv.hpp>
 #include <opencv2/imgproc.hpp>
 
-#include <X11/Xlib.h>
-#include <X11/Xutil.h>
-#include <cstdint>
-#include <cstring>
-#include <vector>
+#include <iostream>
+#include <chrono>
 
-using namespace cv;
-
-void ImageFromDisplay(std::vector<uint8_t>& Pixels, int& Width, int& Height, int& BitsPerPixel)
-{
-    Display* display = XOpenDisplay(nullptr);
-    Window root = DefaultRootWindow(display);
-
-    XWindowAttributes attributes = {0};
-    XGetWindowAttributes(display, root, &attributes);
-
-    Width = attributes.width;
-    Height = attributes.height;
-
-    XImage* img = XGetImage(display, root, 0, 0 , Width, Height, AllPlanes, ZPixmap);
-    BitsPerPixel = img->bits_per_pixel;
-    Pixels.resize(Width * Height * 4);
-
-    memcpy(&Pixels[0], img->data, Pixels.size());
-
-    XDestroyImage(img);
-    XCloseDisplay(display);
-}
+#include "src/screen.h"
 
+using namespace cv;
 
+// captures the whole screen with the shared memory source of the laser display and
+// shows it together with the capture time, press any key to quit
 int main()
 {
-    int Width = 0;
-    int Height = 0;
-    int Bpp = 0;
-    std::vector<std::uint8_t> Pixels;
+    input::screenSource screen("", {0, 0, 0, 0}, 2);
+    if (!screen.open())
+        return 1;
 
-    ImageFromDisplay(Pixels, Width, Height, Bpp);
-
-    if (Width && Height)
+    namedWindow("Display window", WINDOW_NORMAL);
+    Mat img;
+    while (true)
     {
-        Mat img = Mat(Height, Width, Bpp > 24 ? CV_8UC4 : CV_8UC3, &Pixels[0]); //Mat(Size(Height, Width), Bpp > 24 ? CV_8UC4 : CV_8UC3, &Pixels[0]); 
+        auto start = std::chrono::steady_clock::now();
+        if (!screen.read(img))
+            break;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << img.cols << "x" << img.rows << ": " << ms << " ms" << std::endl;
 
-        namedWindow("WindowTitle", WINDOW_AUTOSIZE);
         imshow("Display window", img);
-
-        waitKey(0);
+        if (waitKey(30) >= 0)
+            break;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,43 @@
+// g++ -std=c++17 -O2 -I.. `pkg-config --cflags opencv4` segments-bench.cpp ../src/segments.cpp -o segments-bench
+// ./segments-bench: nearest segment to a query line, batched against one at a time
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+
+#include "src/segments.h"
+
+template<typename F>
+double measure(F f, size_t repetitions) {
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < repetitions; ++r)
+        f();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / repetitions;
+}
+
+int main()
+{
+    std::mt19937 random(1);
+    std::uniform_int_distribution<int> coordinate(0, 1919);
+    // the kernel is chosen at runtime by the CPU
+    const segments::instructions set = segments::getInstructions();
+    std::cout << (set == segments::instructions::avx2 ? "AVX2" : set == segments::instructions::sse41 ? "SSE4.1" : "scalar only, the CPU has neither AVX2 nor SSE4.1") << std::endl;
+    std::cout << std::setw(10) << "segments" << std::setw(16) << "scalar [ns]" << std::setw(16) << "batched [ns]" << std::setw(10) << "speedup" << std::endl;
+
+    for (size_t n = 100; n <= 100000; n *= 10)
+    {
+        segments::block candidates;
+        for (size_t i = 0; i < n; ++i)
+            candidates.push(coordinate(random), coordinate(random), coordinate(random), coordinate(random));
+        const cv::Vec4i line(coordinate(random), coordinate(random), coordinate(random), coordinate(random));
+
+        // about 10^7 candidates per measurement
+        const size_t repetitions = 10000000 / n;
+        volatile size_t sink = 0;
+        const double scalar = measure([&] { sink += segments::nearestScalar(line, candidates).index; }, repetitions);
+        const double batched = measure([&] { sink += segments::nearest(line, candidates).index; }, repetitions);
+        std::cout << std::setw(10) << n << std::setw(16) << std::fixed << std::setprecision(1) << scalar << std::setw(16) << batched
+                  << std::setw(9) << scalar / batched << "x" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+// g++ -std=c++17 -O2 -I.. shm-producer.cpp ../src/shmring.cpp -o shm-producer
+// start the laser display with -i shm first, then ./shm-producer [name] [fps]
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "src/shmring.h"
+
+// draws a rotating square with colored sides straight into the shared memory
+// of the laser display
+void drawLine(uint8_t* pixels, int width, int height, int stride, float x0, float y0, float x1, float y1, const uint8_t color[3])
+{
+    const int steps = static_cast<int>(std::max(std::fabs(x1 - x0), std::fabs(y1 - y0))) + 1;
+    for (int i = 0; i <= steps; ++i)
+    {
+        const int x = static_cast<int>(x0 + (x1 - x0) * i / steps);
+        const int y = static_cast<int>(y0 + (y1 - y0) * i / steps);
+        for (int dy = -1; dy <= 1; ++dy)
+            for (int dx = -1; dx <= 1; ++dx)
+            {
+                if (x + dx < 0 || x + dx >= width || y + dy < 0 || y + dy >= height)
+                    continue;
+                std::memcpy(pixels + (y + dy) * stride + 3 * (x + dx), color, 3);
+            }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string name = argc > 1 ? argv[1] : "/laser-display";
+    const double fps = argc > 2 ? std::stod(argv[2]) : 60;
+    const int width = 640, height = 480, stride = 3 * width;
+    const uint8_t colors[4][3] = {{0, 0, 255}, {0, 255, 0}, {255, 0, 0}, {255, 255, 255}}; // BGR
+
+    shmring::ring ring;
+    if (ring.attach(name) != 0)
+        return 1;
+    if (ring.getSlotSize() < static_cast<uint64_t>(stride) * height)
+    {
+        std::cerr << "The slots are too small for " << width << "x" << height << "." << std::endl;
+        return 1;
+    }
+
+    const auto period = std::chrono::duration<double>(1.0 / fps);
+    auto next = std::chrono::steady_clock::now();
+    for (uint64_t frame = 0; ; ++frame)
+    {
+        uint8_t* pixels = ring.beginFrame();
+        if (pixels != NULL)
+        {
+            std::memset(pixels, 0, stride * height);
+            const float angle = 0.02f * frame;
+            float corners[4][2];
+            for (int i = 0; i < 4; ++i)
+            {
+                corners[i][0] = width / 2 + 150 * std::cos(angle + i * M_PI / 2);
+                corners[i][1] = height / 2 + 150 * std::sin(angle + i * M_PI / 2);
+            }
+            for (int i = 0; i < 4; ++i)
+                drawLine(pixels, width, height, stride, corners[i][0], corners[i][1], corners[(i + 1) % 4][0], corners[(i + 1) % 4][1], colors[i]);
+            ring.publish(width, height, shmring::bgr, stride);
+        }
+        if (frame % 600 == 0)
+            std::cout << frame << " frames, " << ring.getDropped() << " dropped" << std::endl;
+
+        next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+        std::this_thread::sleep_until(next);
+    }
+    return 0;
+}
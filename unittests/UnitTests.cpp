@@ -4,11 +4,36 @@
 #include "GameLibrary/matrix.h"
 #include "GameLibrary/operators.h"
 #include "GameLibrary/Fit.h"
+#include "src/output.h"
+#include "src/multidevice.h"
+#include "src/recorder.h"
+#include "src/trace.h"
+#include "src/color.h"
+#include "src/geometry.h"
+#include "src/ilda.h"
+#include "src/svg.h"
+#include "src/shmring.h"
+#include "src/rawframes.h"
+#include "src/framecache.h"
+#include "src/linalg.h"
+#include "src/segments.h"
+#include "src/snapshot.h"
+#include "src/autotune.h"
+#include "src/compositor.h"
+#include "src/strokefont.h"
+#include "src/input.h"
 #include "GameLibrary/vector.h"
 #include "GameLibrary/matrix.h"
 #include "GameLibrary/operators.h"
 #include <vector>
 #include <iostream>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
 #include <opencv2/opencv.hpp>
 #include <opencv2/imgproc.hpp>
 
@@ -272,4 +297,1427 @@ TEST(GameLibrary, polyFit) {
     EXPECT_NEAR(0, coeff[0], 0.001); // c = 0
     EXPECT_NEAR(0, coeff[1], 0.001); // b = 0
     EXPECT_NEAR(1, coeff[2], 0.001); // a = 1
-}
\ No newline at end of file
+}
+
+TEST(LinAlg, Product) {
+    linalg::matrix<double> dmat1 = {{1, 2}, {3, 4}};
+    linalg::matrix<double> dmat2;
+    dmat2.push_back({5, 6});
+    dmat2.push_back({7, 8});
+    linalg::matrix<double> dmat = dmat1 * dmat2;
+
+    // one buffer, row after row
+    EXPECT_EQ(&dmat1(0, 0) + 2, &dmat1(1, 0));
+    EXPECT_EQ(19, dmat(0, 0));
+    EXPECT_EQ(22, dmat(0, 1));
+    EXPECT_EQ(43, dmat(1, 0));
+    EXPECT_EQ(50, dmat(1, 1));
+}
+
+TEST(LinAlg, PolyFit) {
+    // noisy points of 2 + 0.5 * x + 0.25 * x^2
+    linalg::matrix<double> P;
+    for (int i = 0; i < 20; ++i) {
+        const double x = i;
+        P.push_back({x, 2 + 0.5 * x + 0.25 * x * x + (i % 2 == 0 ? 0.01 : -0.01)});
+    }
+    std::vector<double> coeff = linalg::polyFit<double>(P, 2);
+
+    ASSERT_EQ(3u, coeff.size());
+    EXPECT_NEAR(2, coeff[0], 0.01);
+    EXPECT_NEAR(0.5, coeff[1], 0.01);
+    EXPECT_NEAR(0.25, coeff[2], 0.001);
+
+    // same as the explicit least squares solve
+    linalg::matrix<double> A(3, 2);
+    A(0, 0) = 1; A(0, 1) = 0;
+    A(1, 0) = 1; A(1, 1) = 1;
+    A(2, 0) = 1; A(2, 1) = 2;
+    std::vector<double> x = linalg::linFit<double>({1, 3, 5}, A);
+    EXPECT_NEAR(1, x[0], 1e-9);
+    EXPECT_NEAR(2, x[1], 1e-9);
+}
+
+TEST(Output, SimulatedPacing) {
+    // 500 points at 10000 points/s are 50ms, the buffer holds two frames
+    output::simulationParameters parameters;
+    parameters.bufferSize = 1000;
+    parameters.usbLatency = 0;
+    parameters.usbBandwidth = 1.0e12;
+    parameters.realTime = false;
+    parameters.renderTime = 0;
+    laser::frame points;
+    for (int i = 0; i < 500; ++i)
+        points.push(i, i, 255, 255, 255);
+
+    // a fast caller is held back to the point rate once the buffer is full
+    output::simulatedBackend fast(parameters);
+    ASSERT_TRUE(fast.open());
+    for (int i = 0; i < 12; ++i)
+        fast.sendFrame(points, 10000);
+    EXPECT_EQ(12u, fast.getStatistics().frames);
+    EXPECT_EQ(0u, fast.getStatistics().underruns);
+    EXPECT_NEAR(10 * 0.05, fast.getStatistics().blockedTime, 1e-6);
+
+    // a caller that needs 200ms per frame starves the device 150ms after every frame
+    parameters.renderTime = 0.2;
+    output::simulatedBackend slow(parameters);
+    ASSERT_TRUE(slow.open());
+    for (int i = 0; i < 12; ++i)
+        slow.sendFrame(points, 10000);
+    EXPECT_EQ(11u, slow.getStatistics().underruns);
+    EXPECT_NEAR(11 * 0.15, slow.getStatistics().underrunTime, 1e-6);
+    EXPECT_NEAR(0, slow.getStatistics().blockedTime, 1e-6);
+}
+
+TEST(MultiDevice, SplitFrame) {
+    // leaves the left half of a 200 x 100 frame to the right and comes back in
+    laser::frame points;
+    points.width = 200;
+    points.height = 100;
+    points.push(10, 10, 0, 0, 0);
+    points.push(150, 10, 255, 0, 0);
+    points.push(150, 90, 255, 0, 0);
+    points.push(10, 90, 255, 0, 0);
+
+    // the whole frame is replicated
+    laser::frame result;
+    output::splitFrame(points, {0, 0, 1, 1}, result);
+    EXPECT_EQ(points.x, result.x);
+    EXPECT_EQ(points.r, result.r);
+
+    // clipped at the seam x = 100 and stretched to the full width, with a blank move
+    // along the seam instead of a lit line outside of the region
+    output::splitFrame(points, {0, 0, 0.5, 1}, result);
+    const int left[7][3] = {{20, 10, 0}, {20, 10, 255}, {200, 10, 255}, {200, 10, 0}, {200, 90, 0}, {200, 90, 255}, {20, 90, 255}};
+    ASSERT_EQ(7u, result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        EXPECT_EQ(left[i][0], result.x[i]) << i;
+        EXPECT_EQ(left[i][1], result.y[i]) << i;
+        EXPECT_EQ(left[i][2], result.r[i]) << i;
+    }
+
+    // the right half gets a connected path
+    output::splitFrame(points, {0.5, 0, 1, 1}, result);
+    const int right[5][3] = {{0, 10, 0}, {0, 10, 255}, {100, 10, 255}, {100, 90, 255}, {0, 90, 255}};
+    ASSERT_EQ(5u, result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+        EXPECT_EQ(right[i][0], result.x[i]) << i;
+        EXPECT_EQ(right[i][1], result.y[i]) << i;
+        EXPECT_EQ(right[i][2], result.r[i]) << i;
+    }
+
+    // device coordinates are sent as they are
+    points.width = points.height = 0;
+    output::splitFrame(points, {0, 0, 0.5, 1}, result);
+    EXPECT_EQ(points.x, result.x);
+}
+
+TEST(MultiDevice, SameSequence) {
+    output::simulationParameters parameters;
+    parameters.realTime = false;
+    parameters.renderTime = 0;
+    parameters.maxRecordedPoints = 100000;
+    output::deviceGroup group(20000);
+    output::simulatedBackend* dacs[2];
+    for (int i = 0; i < 2; ++i) {
+        dacs[i] = new output::simulatedBackend(parameters);
+        ASSERT_TRUE(dacs[i]->open());
+        group.addDevice(std::unique_ptr<output::backend>(dacs[i]));
+    }
+    group.start();
+    laser::frame points;
+    points.width = 200;
+    points.height = 100;
+    for (int k = 1; k <= 10; ++k) {
+        points.sequence = k;
+        points.push(10 * k, 5 * k, 255, 255, 255);
+        group.present(points);
+        ASSERT_TRUE(group.flush(std::chrono::milliseconds(1000)));
+    }
+    group.stop();
+
+    // both devices sent all frames, in the same order
+    ASSERT_EQ(10u, dacs[0]->getFrameOffsets().size());
+    EXPECT_EQ(dacs[0]->getFrameOffsets(), dacs[1]->getFrameOffsets());
+    EXPECT_EQ(dacs[0]->getStream().x, dacs[1]->getStream().x);
+    EXPECT_EQ(dacs[0]->getStream().y, dacs[1]->getStream().y);
+    for (int k = 1; k < 10; ++k)
+        EXPECT_EQ(dacs[0]->getFrameOffsets()[k - 1] + k, dacs[0]->getFrameOffsets()[k]);
+}
+
+TEST(MultiDevice, DeadlineMisses) {
+    // 1000 points take 50 ms to scan and 19 ms to transfer, a DAC buffer smaller than a
+    // frame makes sendFrame() wait until the frame before is played
+    output::simulationParameters parameters;
+    parameters.bufferSize = 100;
+    laser::frame points;
+    for (int i = 0; i < 1000; ++i)
+        points.push(i, i, 255, 255, 255);
+
+    auto run = [&](double deadline) {
+        output::deviceGroup group(20000);
+        std::unique_ptr<output::backend> dac(new output::simulatedBackend(parameters));
+        EXPECT_TRUE(dac->open());
+        group.addDevice(std::move(dac));
+        realtime::realtimeParameters rt;
+        rt.deadline = deadline;
+        group.setRealtime(rt);
+        group.start();
+        for (int k = 0; k < 4; ++k) {
+            group.present(points);
+            EXPECT_TRUE(group.flush(std::chrono::milliseconds(1000)));
+        }
+        group.stop();
+        return group.getDeadlineMisses();
+    };
+    // the wait for the DAC counts, not only the preparation
+    EXPECT_EQ(4u, run(5));
+    // within twice the scan time
+    EXPECT_EQ(0u, run(0));
+    EXPECT_EQ(0u, run(-1));
+}
+
+TEST(Color, LookupTable) {
+    // P(x) = 0.5 * x + 10
+    color::correction corr;
+    corr.ar = 0; corr.br = 0.5; corr.cr = 10;
+    corr.ag = 0; corr.bg = 1;   corr.cg = 0;
+    corr.ab = 0.01; corr.bb = 0; corr.cb = 300;
+    color::lookupTable table = color::buildLookupTable(corr);
+
+    // zero stays zero (blank moves)
+    EXPECT_EQ(0, table.r[0]);
+    EXPECT_EQ(0, table.b[0]);
+    EXPECT_EQ(60, table.r[100]);
+    EXPECT_EQ(138, table.r[255]);
+    EXPECT_EQ(100, table.g[100]);
+    // clamped
+    EXPECT_EQ(255, table.b[1]);
+
+    laser::frame points;
+    for (int i = 0; i < 11; ++i)
+        points.push(0, 0, 100, 100, 0);
+    color::apply(table, points);
+    for (size_t i = 0; i < points.size(); ++i) {
+        EXPECT_EQ(60, points.r[i]);
+        EXPECT_EQ(100, points.g[i]);
+        EXPECT_EQ(0, points.b[i]);
+    }
+}
+
+TEST(Color, Boost) {
+    int r = 100, g = 50, b = 0;
+    color::boost(r, g, b);
+    EXPECT_EQ(255, r);
+    EXPECT_EQ(128, g);
+    EXPECT_EQ(0, b);
+
+    // integer division 255 / 200 would give a factor of 1
+    r = 10; g = 200; b = 40;
+    color::boost(r, g, b);
+    EXPECT_EQ(13, r);
+    EXPECT_EQ(255, g);
+    EXPECT_EQ(51, b);
+}
+
+TEST(Geometry, LayoutProjection) {
+    // mirror x and scale y by 0.5 around the center of a 200 x 100 frame
+    geometry::layout l;
+    l.mirrorFactX = -1;
+    l.scalingY = 0.5;
+    geometry::projection p = geometry::projection::fromLayout(l, 200, 100);
+    EXPECT_TRUE(p.isAffine());
+    float x = 150, y = 100;
+    p.map(x, y);
+    EXPECT_NEAR(50, x, 0.001);
+    EXPECT_NEAR(75, y, 0.001);
+
+    // swap the axes (in normalized coordinates)
+    l = geometry::layout();
+    l.swapXY = true;
+    p = geometry::projection::fromLayout(l, 200, 100);
+    x = 200; y = 50;
+    p.map(x, y);
+    EXPECT_NEAR(100, x, 0.001);
+    EXPECT_NEAR(100, y, 0.001);
+}
+
+TEST(Geometry, KeystoneSIMD) {
+    geometry::layout l;
+    l.rotation = 10;
+    l.keystoneX = 0.1;
+    l.keystoneY = -0.05;
+    geometry::projection p = geometry::projection::fromLayout(l, 640, 480);
+    EXPECT_FALSE(p.isAffine());
+
+    // the center stays where it is
+    float cx = 320, cy = 240;
+    p.map(cx, cy);
+    EXPECT_NEAR(320, cx, 0.001);
+    EXPECT_NEAR(240, cy, 0.001);
+
+    // the SIMD pass gives the same result as mapping every point on its own
+    laser::frame points;
+    for (int i = 0; i < 37; ++i)
+        points.push(17 * i, 480 - 13 * i, 255, 255, 255);
+    laser::frame mapped = points;
+    p.apply(mapped);
+    for (size_t i = 0; i < points.size(); ++i) {
+        float x = points.x[i], y = points.y[i];
+        p.map(x, y);
+        EXPECT_NEAR(x, mapped.x[i], 1);
+        EXPECT_NEAR(y, mapped.y[i], 1);
+    }
+
+    // w = 0 on the line x = 100, both paths map it to 0
+    p = geometry::projection({1, 0, 0, 0, 1, 0, 0.01f, 0, -1});
+    points.clear();
+    for (int i = 0; i < 19; ++i)
+        points.push(i % 2 == 0 ? 100 : 50, 10 * i, 255, 255, 255);
+    mapped = points;
+    p.apply(mapped);
+    for (size_t i = 0; i < points.size(); ++i) {
+        float x = points.x[i], y = points.y[i];
+        p.map(x, y);
+        EXPECT_EQ(std::lround(x), mapped.x[i]) << i;
+        EXPECT_EQ(std::lround(y), mapped.y[i]) << i;
+        if (i % 2 == 0) {
+            EXPECT_EQ(0, mapped.x[i]) << i;
+            EXPECT_EQ(0, mapped.y[i]) << i;
+        }
+    }
+
+    // near the horizon the points go far beyond 16 bit and saturate towards their side
+    p = geometry::projection({1e4f, 0, 0, 0, -1e4f, 0, 1e-9f, 0, 1e-5f});
+    points.clear();
+    for (int i = 0; i < 19; ++i)
+        points.push(100 + i, 100 + i, 255, 255, 255);
+    mapped = points;
+    p.apply(mapped);
+    for (size_t i = 0; i < points.size(); ++i) {
+        EXPECT_EQ(32767, mapped.x[i]) << i;
+        EXPECT_EQ(-32768, mapped.y[i]) << i;
+    }
+
+    // device coordinates
+    p = geometry::projection::toDevice(640, 480);
+    points.clear();
+    points.push(0, 0, 0, 0, 0);
+    points.push(640, 480, 0, 0, 0);
+    p.apply(points);
+    EXPECT_EQ(-32767, points.x[0]);
+    EXPECT_EQ(32767, points.y[0]);
+    EXPECT_EQ(32767, points.x[1]);
+    EXPECT_EQ(-32767, points.y[1]);
+}
+
+TEST(Trace, ChromeTrace) {
+    const uint64_t first = trace::nextFrame(), second = trace::nextFrame();
+    // a span started while tracing was off is not recorded
+    {
+        trace::scope span(first, trace::blur);
+        trace::enable(true);
+    }
+    {
+        trace::scope span(first, trace::decode);
+        span.next(trace::canny);
+    }
+    // a thread that has ended before its events are collected
+    std::thread([&] { trace::scope span(second, trace::submit); }).join();
+    trace::collect();
+    trace::enable(false);
+
+    const std::string fileName = "/tmp/laser-display-trace-" + std::to_string(getpid()) + ".json";
+    ASSERT_EQ(0, trace::writeChromeTrace(fileName));
+    std::ifstream file(fileName);
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::remove(fileName.c_str());
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    ASSERT_GE(json.size(), 4u);
+    EXPECT_EQ("\n]}\n", json.substr(json.size() - 4));
+
+    // one complete event per span, other tests may have traced other frames
+    std::vector<std::string> spans[2];
+    std::istringstream lines(json);
+    std::string line;
+    while (std::getline(lines, line)) {
+        if (line.find("\"ph\":\"X\"") == std::string::npos)
+            continue;
+        const size_t name = line.find("\"name\":\"") + 8;
+        const size_t frame = line.find("\"frame\":") + 8;
+        const uint64_t id = std::stoull(line.substr(frame));
+        if (id == first || id == second)
+            spans[id == second].push_back(line.substr(name, line.find('"', name) - name));
+        EXPECT_EQ(std::string::npos, line.find("\"dur\":-")) << line;
+    }
+    EXPECT_EQ(std::vector<std::string>({"decode", "canny"}), spans[0]);
+    EXPECT_EQ(std::vector<std::string>({"submit"}), spans[1]);
+    EXPECT_EQ(0u, trace::getDroppedEvents());
+}
+
+TEST(Segments, DistanceSquare) {
+    // same as Algorithms.LineDistanceSquare
+    std::array<int64_t, 4> d = segments::distanceSquare(cv::Vec4i(1, 2, 3, 4), cv::Vec4i(5, 6, 7, 8));
+    EXPECT_EQ(32, d[0]);
+    EXPECT_EQ(72, d[1]);
+    EXPECT_EQ(8,  d[2]);
+    EXPECT_EQ(32, d[3]);
+
+    // as Algorithms.MinimalLineLineDistance: p2 of the query to q1 of the candidate
+    segments::block b;
+    b.push(cv::Vec4i(5, 6, 7, 8));
+    segments::match m = segments::nearest(cv::Vec4i(1, 2, 3, 4), b);
+    EXPECT_EQ(0u, m.index);
+    EXPECT_EQ(8, m.distance);
+    EXPECT_TRUE(m.fromEnd);
+    EXPECT_FALSE(m.flip);
+    // as Algorithms.MinimalPointLinePoint: the second point of the candidate is nearer
+    b.clear();
+    b.push(cv::Vec4i(7, 8, 5, 6));
+    m = segments::nearest(3, 4, b);
+    EXPECT_EQ(8, m.distance);
+    EXPECT_TRUE(m.flip);
+
+    // an empty block has no match
+    b.clear();
+    EXPECT_EQ(0u, segments::nearest(3, 4, b).index);
+}
+
+TEST(Segments, BatchedMatchesScalar) {
+    // every vector kernel the CPU has, whatever the build flags, against the scalar one
+    std::vector<segments::instructions> kernels;
+    for (segments::instructions set : {segments::instructions::sse41, segments::instructions::avx2})
+        if (segments::isSupported(set))
+            kernels.push_back(set);
+    std::cout << "Segments: " << kernels.size() << " vector kernels supported." << std::endl;
+    std::mt19937 random(42);
+    // small ranges give many ties, the full range checks the 32 bit distances
+    for (int range : {8, 640, 32767}) {
+        std::uniform_int_distribution<int> coordinate(0, range);
+        for (size_t n : {1, 3, 4, 7, 8, 9, 16, 31, 100, 257}) {
+            segments::block b;
+            for (size_t i = 0; i < n; ++i)
+                b.push(coordinate(random), coordinate(random), coordinate(random), coordinate(random));
+            for (int k = 0; k < 20; ++k) {
+                const cv::Vec4i line(coordinate(random), coordinate(random), coordinate(random), coordinate(random));
+                const segments::match reference = segments::nearestScalar(line, b);
+                const segments::match pointReference = segments::nearestScalar(line[0], line[1], b);
+                // the best of the four distances of distanceSquare
+                const std::array<int64_t, 4> d = segments::distanceSquare(line, cv::Vec4i(b.x1[reference.index], b.y1[reference.index], b.x2[reference.index], b.y2[reference.index]));
+                EXPECT_EQ(*std::min_element(d.begin(), d.end()), reference.distance);
+                EXPECT_FALSE(pointReference.fromEnd);
+
+                for (segments::instructions set : kernels) {
+                    const segments::match fast = segments::nearest(line, b, set);
+                    EXPECT_EQ(reference.index, fast.index);
+                    EXPECT_EQ(reference.distance, fast.distance);
+                    EXPECT_EQ(reference.fromEnd, fast.fromEnd);
+                    EXPECT_EQ(reference.flip, fast.flip);
+
+                    const segments::match point = segments::nearest(line[0], line[1], b, set);
+                    EXPECT_EQ(pointReference.index, point.index);
+                    EXPECT_EQ(pointReference.distance, point.distance);
+                    EXPECT_EQ(pointReference.flip, point.flip);
+                    EXPECT_FALSE(point.fromEnd);
+                }
+                // the default is the widest kernel
+                EXPECT_EQ(reference.index, segments::nearest(line, b).index);
+            }
+        }
+    }
+}
+
+TEST(Segments, View) {
+    // the Hough output is used in place, as in Algorithms.HoughLinesReinterpretCast
+    std::vector<cv::Vec4i> houghLines = {cv::Vec4i(1, 2, 3, 4), cv::Vec4i(5, 6, 7, 8)};
+    segments::view<int> lines(houghLines);
+    ASSERT_EQ(2u, lines.size());
+    lines[0][0] = 0;
+    houghLines[0][1] = 1;
+    EXPECT_EQ(0, houghLines[0][0]);
+    EXPECT_EQ(1, lines.y1(0));
+    EXPECT_EQ(7, lines.x2(1));
+    lines.flip(1);
+    EXPECT_EQ(7, houghLines[1][0]);
+    EXPECT_EQ(8, houghLines[1][1]);
+    EXPECT_EQ(5, houghLines[1][2]);
+    EXPECT_EQ(6, houghLines[1][3]);
+
+    // any coordinate type
+    std::vector<cv::Vec4f> contour = {cv::Vec4f(1.5f, 2, 3, 4), cv::Vec4f(5, 6, 7, 8)};
+    std::array<double, 4> d = segments::distanceSquare(contour[0], contour[1]);
+    EXPECT_DOUBLE_EQ(3.5 * 3.5 + 16, d[0]);
+    EXPECT_DOUBLE_EQ(8, d[2]);
+}
+
+TEST(Segments, Order) {
+    // same as Algorithms.SortLines, for every coordinate type
+    std::vector<cv::Vec4i> lines = {cv::Vec4i(4, 2, 3, 2), cv::Vec4i(3, 4, 4, 4), cv::Vec4i(1, 1, 2, 2), cv::Vec4i(5, 4, 4, 3)};
+    std::vector<cv::Vec4s> shortLines;
+    std::vector<cv::Vec4f> floatLines;
+    for (const cv::Vec4i& l : lines) {
+        shortLines.push_back(cv::Vec4s(l[0], l[1], l[2], l[3]));
+        floatLines.push_back(cv::Vec4f(l[0], l[1], l[2], l[3]));
+    }
+    segments::order(lines);
+    segments::order(segments::view<short>(shortLines));
+    segments::order(segments::view<float>(floatLines));
+
+    const int expected[4][4] = {{4, 2, 3, 2}, {2, 2, 1, 1}, {3, 4, 4, 4}, {5, 4, 4, 3}};
+    for (size_t k = 0; k < 4; ++k) {
+        for (int c = 0; c < 4; ++c) {
+            EXPECT_EQ(expected[k][c], lines[k][c]);
+            EXPECT_EQ(expected[k][c], shortLines[k][c]);
+            EXPECT_EQ(expected[k][c], floatLines[k][c]);
+        }
+    }
+}
+
+TEST(ILDA, WriteRead) {
+    const std::string fileName = ::testing::TempDir() + "unittest.ild";
+    laser::frame points;
+    points.push(-32767, 32767, 0, 0, 0);
+    points.push(100, -200, 255, 128, 1);
+    points.push(32767, -32767, 10, 20, 30);
+
+    ilda::writer out;
+    ASSERT_EQ(0, out.open(fileName, ilda::frameRateName(29.97)));
+    EXPECT_EQ(0, out.writeFrame(points));
+    EXPECT_EQ(0, out.writeFrame(laser::frame())); // one blanked point
+    EXPECT_EQ(0, out.writeFrame(points));
+    EXPECT_EQ(0, out.close());
+
+    ilda::reader in;
+    ASSERT_EQ(0, in.open(fileName));
+    EXPECT_EQ(3u, in.getFrames());
+    EXPECT_EQ(3u, in.getMaxPoints());
+    EXPECT_NEAR(29.97, in.getFrameRate(), 0.001);
+
+    laser::frame read;
+    ASSERT_EQ(0, in.readFrame(2, read));
+    ASSERT_EQ(points.size(), read.size());
+    EXPECT_EQ(0, read.width);
+    for (size_t i = 0; i < points.size(); ++i) {
+        EXPECT_EQ(points.x[i], read.x[i]);
+        EXPECT_EQ(points.y[i], read.y[i]);
+        EXPECT_EQ(points.r[i], read.r[i]);
+        EXPECT_EQ(points.g[i], read.g[i]);
+        EXPECT_EQ(points.b[i], read.b[i]);
+    }
+    ASSERT_EQ(0, in.readFrame(1, read));
+    EXPECT_EQ(1u, read.size());
+    EXPECT_TRUE(read.isBlank(0));
+    EXPECT_NE(0, in.readFrame(3, read));
+    in.close();
+
+    // format 1 (indexed) frames before and after a palette of the file (format 2)
+    std::vector<uint8_t> file;
+    auto header = [&](uint8_t format, uint16_t records) {
+        const uint8_t h[32] = {'I', 'L', 'D', 'A', 0, 0, 0, format, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                               static_cast<uint8_t>(records >> 8), static_cast<uint8_t>(records & 0xff), 0, 0, 0, 0, 0, 0};
+        file.insert(file.end(), h, h + 32);
+    };
+    const uint8_t indices[3] = {0, 16, 40};
+    auto indexedFrame = [&]() {
+        header(1, 3);
+        for (int i = 0; i < 3; ++i) {
+            const uint8_t record[6] = {0, static_cast<uint8_t>(i), 0, 0, static_cast<uint8_t>(i == 2 ? ilda::lastPoint : 0), indices[i]};
+            file.insert(file.end(), record, record + 6);
+        }
+    };
+    indexedFrame();
+    header(2, 2);
+    const uint8_t colors[6] = {1, 2, 3, 4, 5, 6};
+    file.insert(file.end(), colors, colors + 6);
+    indexedFrame();
+    header(1, 0);
+    std::ofstream(fileName, std::ios::binary).write(reinterpret_cast<const char*>(file.data()), file.size());
+
+    ASSERT_EQ(0, in.open(fileName));
+    EXPECT_EQ(2u, in.getFrames());
+    // the default palette: red, yellow, blue
+    ASSERT_EQ(0, in.readFrame(0, read));
+    ASSERT_EQ(3u, read.size());
+    const int standard[3][3] = {{255, 0, 0}, {255, 255, 0}, {0, 0, 255}};
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(i, read.x[i]);
+        EXPECT_EQ(standard[i][0], read.r[i]) << i;
+        EXPECT_EQ(standard[i][1], read.g[i]) << i;
+        EXPECT_EQ(standard[i][2], read.b[i]) << i;
+    }
+    // the palette of the file, indices outside of it are white
+    ASSERT_EQ(0, in.readFrame(1, read));
+    EXPECT_EQ(1, read.r[0]);
+    EXPECT_EQ(2, read.g[0]);
+    EXPECT_EQ(3, read.b[0]);
+    EXPECT_EQ(255, read.r[1]);
+    EXPECT_EQ(255, read.b[2]);
+}
+
+TEST(ILDA, Playback) {
+    // 10 frames at 10 fps, looping
+    ilda::playback clock(10, 10);
+    clock.start();
+    clock.setPause(true);
+    EXPECT_EQ(0, clock.getFrame());
+    clock.seek(0.55);
+    EXPECT_EQ(5, clock.getFrame());
+    clock.seek(1.0);
+    EXPECT_EQ(5, clock.getFrame());
+    clock.seek(-0.6);
+    EXPECT_EQ(9, clock.getFrame());
+    // not looping: the end of the file
+    clock.setLoop(false);
+    clock.seek(5);
+    EXPECT_EQ(-1, clock.getFrame());
+}
+
+TEST(ILDA, FrameNumberWrap) {
+    // one point per frame, a little more than the 16 bit frame numbers hold
+    const std::string fileName = ::testing::TempDir() + "unittest-wrap.ild";
+    const size_t frames = 65536 + 3;
+    laser::frame points;
+    points.push(0, 0, 255, 255, 255);
+    ilda::writer out;
+    ASSERT_EQ(0, out.open(fileName));
+    for (size_t i = 0; i < frames; ++i) {
+        points.x[0] = static_cast<int16_t>(i);
+        ASSERT_EQ(0, out.writeFrame(points));
+    }
+    EXPECT_EQ(0, out.close());
+
+    // the numbers in the headers wrap, the total is capped
+    const size_t frameSize = ilda::headerSize + ilda::pointSize;
+    std::ifstream file(fileName, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ((frames + 1) * frameSize - ilda::pointSize, bytes.size());
+    auto word = [&](size_t offset) { return (static_cast<uint8_t>(bytes[offset]) << 8) | static_cast<uint8_t>(bytes[offset + 1]); };
+    EXPECT_EQ(65535, word(65535 * frameSize + 26));
+    EXPECT_EQ(0, word(65536 * frameSize + 26));
+    EXPECT_EQ(2, word(65538 * frameSize + 26));
+    EXPECT_EQ(65535, word(65538 * frameSize + 28));
+
+    // all frames are read nevertheless
+    ilda::reader in;
+    ASSERT_EQ(0, in.open(fileName));
+    EXPECT_EQ(frames, in.getFrames());
+    laser::frame read;
+    ASSERT_EQ(0, in.readFrame(frames - 1, read));
+    EXPECT_EQ(static_cast<int16_t>(frames - 1), read.x[0]);
+    in.close();
+    std::remove(fileName.c_str());
+}
+
+TEST(Recorder, DropAndReadBack) {
+    const std::string fileName = ::testing::TempDir() + "unittest-record.ild";
+    output::recorderParameters parameters;
+    parameters.frames = 2;
+    parameters.maxPoints = 4;
+    output::recorder rec(fileName, parameters);
+
+    // pushed faster than the writer thread polls the ring of two frames
+    laser::frame points;
+    for (int i = 0; i < 6; ++i)
+        points.push(i, -i, i == 0 ? 0 : 255, i == 0 ? 0 : 128, 0);
+    EXPECT_FALSE(rec.push(points)); // not started
+    ASSERT_EQ(0, rec.start());
+    const int pushed = 500;
+    uint64_t refused = 0;
+    for (int k = 0; k < pushed; ++k) {
+        points.x[0] = static_cast<int16_t>(k);
+        if (!rec.push(points))
+            refused++;
+    }
+    rec.stop();
+    EXPECT_GT(rec.getDropped(), 0u);
+    EXPECT_EQ(refused, rec.getDropped());
+    EXPECT_EQ(static_cast<uint64_t>(pushed), rec.getRecorded() + rec.getDropped());
+    EXPECT_EQ(rec.getRecorded(), rec.getTruncated());
+
+    // the recorded frames in the order pushed, truncated to maxPoints
+    ilda::reader in;
+    ASSERT_EQ(0, in.open(fileName));
+    ASSERT_EQ(rec.getRecorded(), in.getFrames());
+    laser::frame read;
+    int last = -1;
+    for (size_t f = 0; f < in.getFrames(); ++f) {
+        ASSERT_EQ(0, in.readFrame(f, read));
+        ASSERT_EQ(4u, read.size());
+        EXPECT_GT(read.x[0], last);
+        last = read.x[0];
+        EXPECT_TRUE(read.isBlank(0));
+        for (size_t i = 1; i < read.size(); ++i) {
+            EXPECT_EQ(points.x[i], read.x[i]);
+            EXPECT_EQ(points.y[i], read.y[i]);
+            EXPECT_EQ(255, read.r[i]);
+            EXPECT_EQ(128, read.g[i]);
+        }
+    }
+    in.close();
+    std::remove(fileName.c_str());
+}
+
+TEST(Recorder, WriteError) {
+    output::recorderParameters parameters;
+    parameters.maxPoints = 4;
+    output::recorder rec("/dev/full", parameters);
+    laser::frame points;
+    for (int i = 0; i < 4; ++i)
+        points.push(i, i, 255, 255, 255);
+    ASSERT_EQ(0, rec.start());
+    // more than the stream buffers, so the full device is noticed
+    const int pushed = 1000;
+    for (int k = 0; k < pushed; ++k)
+        while (!rec.push(points))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    rec.stop();
+    // the frames after the first error are not counted as recorded
+    EXPECT_GT(rec.getFailed(), 0u);
+    EXPECT_EQ(static_cast<uint64_t>(pushed), rec.getRecorded() + rec.getFailed());
+    std::ostringstream statistics;
+    rec.printStatistics(statistics);
+    EXPECT_NE(std::string::npos, statistics.str().find(std::to_string(rec.getFailed()) + " failed to write"));
+}
+
+TEST(SVG, ParseAndFlatten) {
+    const std::string text =
+        "<svg viewBox=\"0 0 200 100\">"
+        "<g transform=\"translate(10 10)\" stroke=\"#f00\" fill=\"none\">"
+        "<rect x=\"0\" y=\"0\" width=\"10\" height=\"5\"/>"
+        "<circle cx=\"50\" cy=\"40\" r=\"20\" style=\"stroke: rgb(0, 255, 0)\"/>"
+        "</g>"
+        "<path d=\"M0 0 C 0 50 100 50 100 0\" stroke=\"none\"/>"
+        "</svg>";
+    svg::document doc;
+    ASSERT_EQ(0, svg::parse(text, 1, 1000, doc));
+    // the longer side gets the resolution
+    EXPECT_EQ(1000, doc.width);
+    EXPECT_EQ(500, doc.height);
+    ASSERT_EQ(3u, doc.paths.size());
+
+    // closed rectangle, translated and scaled by 5
+    const svg::polyline& rect = doc.paths[0];
+    ASSERT_EQ(5u, rect.points.size());
+    EXPECT_NEAR(50, rect.points[0][0], 1e-3);
+    EXPECT_NEAR(75, rect.points[2][1], 1e-3);
+    EXPECT_EQ(255, rect.r);
+    EXPECT_EQ(0, rect.g);
+
+    // the circle stays within the tolerance, the chords are not longer than needed
+    const svg::polyline& circle = doc.paths[1];
+    EXPECT_EQ(255, circle.g);
+    EXPECT_GT(circle.points.size(), 20u);
+    EXPECT_LT(circle.points.size(), 80u);
+    for (auto& q : circle.points)
+        EXPECT_NEAR(100, std::hypot(q[0] - 300, q[1] - 250), 1e-2);
+
+    // black (default fill) is drawn white, the curve ends at its end point
+    const svg::polyline& curve = doc.paths[2];
+    EXPECT_EQ(255, curve.r);
+    EXPECT_NEAR(500, curve.points.back()[0], 1e-3);
+    EXPECT_NEAR(0, curve.points.back()[1], 1e-3);
+
+    // two paths over the same segment keep their own colors
+    ASSERT_EQ(0, svg::parse("<svg viewBox=\"0 0 100 100\"><path d=\"M10 10 L90 10\" stroke=\"#f00\"/>"
+                            "<path d=\"M90 10 L10 10 L10 90\" stroke=\"#00f\"/></svg>", 1, 100, doc));
+    laser::frame points;
+    svg::generatePoints(doc, points);
+    int red = 0, blue = 0;
+    for (size_t i = 1; i < points.size(); ++i) {
+        if (points.isBlank(i))
+            continue;
+        EXPECT_TRUE((points.r[i] == 255 && points.b[i] == 0) || (points.r[i] == 0 && points.b[i] == 255)) << i;
+        red += points.r[i] == 255 && points.y[i] == 10 && points.y[i - 1] == 10 && points.x[i] != points.x[i - 1];
+        blue += points.b[i] == 255 && points.y[i] == 10 && points.y[i - 1] == 10 && points.x[i] != points.x[i - 1];
+    }
+    EXPECT_EQ(1, red);
+    EXPECT_EQ(1, blue);
+}
+
+TEST(ShmRing, PublishAcquire) {
+    const std::string name = "/laser-display-test-" + std::to_string(getpid());
+    shmring::ring consumer, producer;
+    ASSERT_EQ(0, consumer.create(name, 3, 64));
+    ASSERT_EQ(0, producer.attach(name));
+    EXPECT_EQ(-1, consumer.acquire(0, 1));
+
+    // the producer draws in place, the consumer sees the same pixels
+    uint8_t* pixels = producer.beginFrame();
+    ASSERT_NE(nullptr, pixels);
+    for (int i = 0; i < 12; ++i)
+        pixels[i] = i;
+    ASSERT_TRUE(producer.publish(2, 2, shmring::bgr, 6));
+    int slot = consumer.acquire(0, 100);
+    ASSERT_GE(slot, 0);
+    const shmring::frameHeader& f = consumer.getFrame(slot);
+    EXPECT_EQ(1u, f.sequence.load());
+    EXPECT_EQ(2u, f.width);
+    EXPECT_EQ(6u, f.stride);
+    EXPECT_EQ(11, consumer.getPixels(slot)[11]);
+
+    // a frame larger than a slot is refused
+    ASSERT_NE(nullptr, producer.beginFrame());
+    EXPECT_FALSE(producer.publish(100, 100, shmring::bgra, 400));
+
+    // the busy slot and the newest frame are never written, with three slots the
+    // producer keeps on publishing into the third one
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_NE(nullptr, producer.beginFrame());
+        ASSERT_TRUE(producer.publish(2, 2, shmring::bgr, 6));
+        EXPECT_EQ(11, consumer.getPixels(slot)[11]);
+    }
+    EXPECT_EQ(0u, producer.getDropped());
+    int newest = consumer.acquire(1, 100);
+    ASSERT_GE(newest, 0);
+    EXPECT_NE(slot, newest);
+    EXPECT_EQ(6u, consumer.getFrame(newest).sequence.load());
+    // two slots are held and the third has the newest frame: no free slot
+    ASSERT_NE(nullptr, producer.beginFrame());
+    ASSERT_TRUE(producer.publish(2, 2, shmring::bgr, 6));
+    EXPECT_EQ(nullptr, producer.beginFrame());
+    EXPECT_EQ(1u, producer.getDropped());
+    consumer.release(slot);
+    consumer.release(newest);
+    EXPECT_NE(nullptr, producer.beginFrame());
+
+    // a second consumer does not take over the ring
+    shmring::ring second;
+    EXPECT_EQ(-1, second.create(name, 3, 64));
+    consumer.close();
+    EXPECT_EQ(0, second.create(name, 3, 64));
+}
+
+TEST(Snapshot, PinAndReclaim) {
+    struct pair {
+        int a;
+        int b;
+    };
+    snapshot::publisher<pair> p({1, 1});
+    snapshot::reader<pair> r(p);
+    ASSERT_TRUE(r.isValid());
+    EXPECT_EQ(1u, p.latest().number);
+
+    // a pinned snapshot survives publishing, it is freed after the release
+    const snapshot::publisher<pair>::version& pinned = r.acquire();
+    EXPECT_EQ(2u, p.publish({2, 2}));
+    EXPECT_EQ(1u, p.getRetired());
+    EXPECT_EQ(1, pinned.value.a);
+    EXPECT_EQ(2u, r.acquire().number);
+    r.release();
+    p.publish({3, 3});
+    EXPECT_EQ(0u, p.getRetired());
+
+    // readers never see a half written value, the numbers never go back
+    std::atomic<bool> stop(false);
+    std::atomic<int> errors(0);
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&] {
+            snapshot::reader<pair> own(p);
+            uint64_t last = 0;
+            while (!stop.load()) {
+                const snapshot::publisher<pair>::version& v = own.acquire();
+                if (v.value.a != v.value.b || v.number < last)
+                    ++errors;
+                last = v.number;
+            }
+        });
+    }
+    for (int i = 4; i <= 20000; ++i)
+        p.publish({i, i});
+    stop.store(true);
+    for (std::thread& t : readers)
+        t.join();
+    EXPECT_EQ(0, errors.load());
+    EXPECT_EQ(20000u, p.latest().number);
+}
+
+TEST(AutoTune, ParetoFront) {
+    auto makeScore = [](double time, double points, double fidelity) {
+        autotune::score s;
+        s.time = time;
+        s.points = points;
+        s.fidelity = fidelity;
+        return s;
+    };
+    std::vector<autotune::score> scores = {
+        makeScore(10, 5000, 0.9), // slow but faithful
+        makeScore(2, 3000, 0.5),  // fast
+        makeScore(5, 1000, 0.7),  // short
+        makeScore(6, 4000, 0.6),  // dominated by the short one
+        makeScore(10, 5000, 0.9), // equal to the first, not dominated
+    };
+    EXPECT_TRUE(autotune::dominates(scores[2], scores[3]));
+    EXPECT_FALSE(autotune::dominates(scores[0], scores[4]));
+    std::vector<autotune::score> front = autotune::paretoFront(scores);
+    ASSERT_EQ(4u, front.size());
+    EXPECT_EQ(10, front[0].time);
+    EXPECT_EQ(2, front[1].time);
+    EXPECT_EQ(5, front[2].time);
+    EXPECT_EQ(10, front[3].time);
+}
+
+TEST(Compositor, PlaceAndCompose) {
+    laser::frame f;
+    f.width = 100;
+    f.height = 50;
+    f.push(0, 0, 0, 0, 0);
+    f.push(100, 50, 255, 0, 0);
+    laser::frame placed;
+    compositor::place(f, {0.5f, 0.5f, 1, 1}, 200, 100, placed);
+    ASSERT_EQ(2u, placed.size());
+    EXPECT_EQ(100, placed.x[0]);
+    EXPECT_EQ(50, placed.y[0]);
+    EXPECT_EQ(200, placed.x[1]);
+    EXPECT_EQ(100, placed.y[1]);
+    EXPECT_EQ(255, placed.r[1]);
+
+    // two static drawings side by side, the right one has the higher priority
+    const std::string base = "/tmp/laser-display-compositor-" + std::to_string(getpid());
+    std::ofstream(base + ".svg") << "<svg viewBox=\"0 0 100 100\"><path d=\"M10 10 L90 10 L90 90\" stroke=\"#f00\" fill=\"none\"/></svg>";
+    Parameters parameters;
+    compositor::compositorParameters settings;
+    settings.width = 200;
+    settings.height = 100;
+    compositor::sourceParameters left, right;
+    left.input = right.input = base + ".svg";
+    left.inputtype = right.inputtype = InputType::vectorgraphic;
+    left.area = {0, 0, 0.5f, 1};
+    right.area = {0.5f, 0, 1, 1};
+    right.priority = 1;
+    settings.sources = {left, right};
+
+    laser::frame points;
+    points.sequence = 7;
+    {
+        compositor::compositor c(parameters, settings);
+        ASSERT_EQ(0, c.start());
+        c.compose(points);
+    }
+    EXPECT_EQ(7u, points.sequence);
+    EXPECT_EQ(200, points.width);
+    ASSERT_GT(points.size(), 4u);
+    // the right drawing first, joined to the left one by a blank move
+    const size_t half = (points.size() - 2) / 2;
+    for (size_t i = 0; i < half; ++i)
+        EXPECT_GE(points.x[i], 100);
+    EXPECT_TRUE(points.isBlank(half + 1));
+    for (size_t i = half + 2; i < points.size(); ++i)
+        EXPECT_LT(points.x[i], 100);
+
+    // a short budget is spent on the higher priority
+    settings.pointBudget = static_cast<int>(half);
+    {
+        compositor::compositor c(parameters, settings);
+        ASSERT_EQ(0, c.start());
+        c.compose(points);
+    }
+    ASSERT_EQ(half, points.size());
+    EXPECT_GE(points.x[0], 100);
+    std::remove((base + ".svg").c_str());
+}
+
+TEST(Compositor, LiveSource) {
+    const std::string name = "/laser-display-compositor-" + std::to_string(getpid());
+    Parameters parameters;
+    parameters.shmSlotSize = 64;
+    compositor::compositorParameters settings;
+    compositor::sourceParameters live;
+    live.input = "shm:" + name;
+    live.inputtype = InputType::sharedmemory;
+    live.maxFPS = 0.1;
+    settings.sources = {live};
+
+    compositor::compositor c(parameters, settings);
+    ASSERT_EQ(0, c.start());
+    shmring::ring producer;
+    ASSERT_EQ(0, producer.attach(name));
+    auto publish = [&]() {
+        uint8_t* pixels = producer.beginFrame();
+        if (pixels == NULL)
+            return false;
+        std::fill(pixels, pixels + 12, 255);
+        return producer.publish(2, 2, shmring::bgr, 6);
+    };
+    ASSERT_TRUE(publish());
+    // the worker takes the frame and waits for its next one, 10 s later
+    for (int i = 0; i < 100; ++i) {
+        std::ostringstream statistics;
+        c.printStatistics(statistics);
+        if (statistics.str().find(": 1 frames vectorized") != std::string::npos)
+            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    const auto start = std::chrono::steady_clock::now();
+    c.stop();
+    const std::chrono::duration<double> stopping = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(stopping.count(), 1.0);
+
+    // no slot is borrowed anymore
+    for (int i = 0; i < parameters.shmSlots; ++i)
+        EXPECT_TRUE(publish()) << i;
+}
+
+TEST(StrokeFont, GlyphsAndTicker) {
+    strokefont::font f;
+    // one stroke: a blank point at its start, then the lit corners
+    const strokefont::glyph& l = f.get('L');
+    ASSERT_EQ(4u, l.points.size());
+    EXPECT_TRUE(l.points.isBlank(0));
+    EXPECT_FALSE(l.points.isBlank(1));
+    EXPECT_EQ(4, l.points.x[3]);
+    EXPECT_EQ(6, l.points.y[3]);
+    EXPECT_EQ(6, l.advance);
+    // three strokes with two blank moves, connected strokes stay together
+    EXPECT_EQ(11u, f.get('H').points.size());
+    EXPECT_EQ(&f.get('H'), &f.get('h'));
+    EXPECT_EQ(&f.get('?'), &f.get('~'));
+    // glyphs start at their left edge
+    EXPECT_EQ(6, f.measure("I."));
+    EXPECT_EQ(0, f.get('.').points.x[0]);
+
+    laser::frame points;
+    f.render("L", 10, 20, 12, 255, 0, 0, points);
+    ASSERT_EQ(4u, points.size());
+    EXPECT_EQ(10, points.x[0]);
+    EXPECT_EQ(20, points.y[0]);
+    EXPECT_EQ(18, points.x[3]);
+    EXPECT_EQ(32, points.y[3]);
+    EXPECT_EQ(255, points.r[3]);
+    EXPECT_EQ(0, points.g[3]);
+
+    // the ticker enters at the right edge, half a window per second
+    strokefont::tickerParameters p;
+    p.text = "HI";
+    p.y = 0;
+    p.height = 0.06f;
+    p.speed = 0.5f;
+    strokefont::ticker t(f, p);
+    points.clear();
+    points.width = 600;
+    points.height = 100;
+    t.render(0, points);
+    EXPECT_EQ(0u, points.size());
+    t.render(1, points);
+    ASSERT_EQ(23u, points.size());
+    EXPECT_EQ(300, points.x[0]);
+    for (size_t i = 0; i < points.size(); ++i) {
+        EXPECT_GE(points.x[i], 300);
+        EXPECT_LE(points.x[i], 308);
+    }
+}
+
+TEST(RawFrames, WriteRead) {
+    const std::string file = "/tmp/laser-display-test-" + std::to_string(getpid()) + ".raw";
+    cv::Mat img(3, 5, CV_8UC3);
+    for (int y = 0; y < img.rows; ++y)
+        for (int x = 0; x < 3 * img.cols; ++x)
+            img.ptr<uint8_t>(y)[x] = 16 * y + x;
+    // a cropped view is stored packed
+    cv::Mat view = img(cv::Rect(1, 1, 3, 2));
+
+    rawframes::writer w;
+    ASSERT_EQ(0, w.open(file));
+    ASSERT_EQ(0, w.writeFrame(img, 1000));
+    ASSERT_EQ(0, w.writeFrame(view, 41000));
+    ASSERT_EQ(0, w.close());
+
+    rawframes::reader r;
+    ASSERT_EQ(0, r.open(file));
+    ASSERT_EQ(2u, r.getFrames());
+    EXPECT_EQ(0u, r.getTimestamp(0));
+    EXPECT_EQ(40000u, r.getTimestamp(1));
+    cv::Mat a = r.getFrame(0);
+    cv::Mat b = r.getFrame(1);
+    ASSERT_EQ(CV_8UC3, b.type());
+    ASSERT_EQ(3, b.cols);
+    ASSERT_EQ(2, b.rows);
+    EXPECT_EQ(0, cv::norm(a, img, cv::NORM_INF));
+    EXPECT_EQ(0, cv::norm(b, view, cv::NORM_INF));
+    // used from the mapping, the pixels are aligned
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(b.data) % 64);
+    r.close();
+    std::remove(file.c_str());
+}
+
+// counts the decodes, to see how far the prefetcher reads ahead
+class countingSequence : public input::sequenceSource {
+public:
+    using input::sequenceSource::sequenceSource;
+    bool read(cv::Mat& img) override {
+        reads++;
+        return input::sequenceSource::read(img);
+    }
+    std::atomic<int> reads{0};
+};
+
+TEST(Input, SequencePattern) {
+    const std::string dir = ::testing::TempDir() + "laser-display-pattern-" + std::to_string(getpid());
+    for (int k = 1; k <= 3; ++k)
+        ASSERT_TRUE(cv::imwrite(dir + "-100%-" + std::to_string(k) + ".png", cv::Mat(2, 2, CV_8UC3, cv::Scalar(k, k, k))));
+
+    // numbered from 1, the percent sign of the name is escaped
+    input::sequenceSource sequence(dir + "-100%%-%d.png");
+    ASSERT_TRUE(sequence.open());
+    EXPECT_EQ(3u, sequence.getFrameCount());
+    // never used as a format: no number, two numbers, other conversions
+    EXPECT_FALSE(input::sequenceSource(dir + "-100%-1.png").open());
+    EXPECT_FALSE(input::sequenceSource(dir + "-100%%-1.png").open());
+    EXPECT_FALSE(input::sequenceSource(dir + "-%d%%-%d.png").open());
+    EXPECT_FALSE(input::sequenceSource(dir + "-100%%-%s.png").open());
+    EXPECT_FALSE(input::sequenceSource(dir + "-100%%-%n.png").open());
+    EXPECT_FALSE(input::sequenceSource(dir + "-100%%-%").open());
+    for (int k = 1; k <= 3; ++k)
+        std::remove((dir + "-100%-" + std::to_string(k) + ".png").c_str());
+}
+
+TEST(Input, Prefetcher) {
+    const std::string prefix = ::testing::TempDir() + "laser-display-prefetch-" + std::to_string(getpid()) + "-";
+    const std::string pattern = prefix + "%02d.png";
+    const int images = 6;
+    auto file = [&](int k) { return prefix + "0" + std::to_string(k) + ".png"; };
+    for (int k = 0; k < images; ++k)
+        ASSERT_TRUE(cv::imwrite(file(k), cv::Mat(4, 6, CV_8UC3, cv::Scalar(10 * k, 0, 0))));
+
+    auto waitForReads = [](const countingSequence& s, int n) {
+        for (int i = 0; i < 200 && s.reads < n; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        // and no further ones
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return s.reads.load();
+    };
+
+    // the whole sequence in order, cropped, never more than depth frames ahead
+    const size_t depth = 2;
+    std::unique_ptr<countingSequence> sequence(new countingSequence(pattern, 0, 2));
+    ASSERT_TRUE(sequence->open());
+    countingSequence& counted = *sequence;
+    input::prefetcher prefetch(std::move(sequence), {1, 1, 1, 1}, depth, false, false);
+    EXPECT_FALSE(prefetch.isPaced());
+    prefetch.start();
+    EXPECT_EQ(static_cast<int>(depth), waitForReads(counted, depth));
+    cv::Mat img;
+    for (int k = 0; k < images; ++k) {
+        ASSERT_TRUE(prefetch.next(img));
+        ASSERT_EQ(2, img.rows);
+        ASSERT_EQ(4, img.cols);
+        EXPECT_EQ(10 * k, img.at<cv::Vec3b>(0, 0)[0]);
+        // one frame taken, one more read
+        if (k + depth < images) {
+            EXPECT_EQ(static_cast<int>(k + 1 + depth), waitForReads(counted, k + 1 + depth));
+        }
+    }
+    // the end without a loop
+    EXPECT_FALSE(prefetch.next(img));
+    EXPECT_EQ(0u, prefetch.getDropped());
+    prefetch.stop();
+
+    // looping: a cancel ends the waiting and all later calls, the frames already read included
+    std::unique_ptr<input::sequenceSource> looping(new input::sequenceSource(pattern, 0, 2));
+    ASSERT_TRUE(looping->open());
+    input::prefetcher loop(std::move(looping), {0, 0, 0, 0}, depth, true, false);
+    loop.start();
+    for (int k = 0; k < 2 * images; ++k) {
+        ASSERT_TRUE(loop.next(img));
+        EXPECT_EQ(10 * (k % images), img.at<cv::Vec3b>(0, 0)[0]);
+    }
+    std::thread canceller([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        loop.cancel();
+    });
+    while (loop.next(img)) {}
+    canceller.join();
+    EXPECT_FALSE(loop.next(img));
+    loop.stop();
+
+    for (int k = 0; k < images; ++k)
+        std::remove(file(k).c_str());
+}
+
+// frame k is due at k / rate, reads are instant and the pixels hold the frame number
+class clockedSource : public input::source {
+public:
+    clockedSource(double rate) : rate(rate) {}
+    bool open() override { return true; }
+    bool read(cv::Mat& img) override {
+        img = cv::Mat(2, 2, CV_8UC1, cv::Scalar(static_cast<double>(position++)));
+        return true;
+    }
+    bool skip() override {
+        position++;
+        return true;
+    }
+    double getFrameRate() const override { return rate; }
+    std::string getName() const override { return "clock"; }
+
+private:
+    double rate;
+    uint64_t position = 0;
+};
+
+TEST(Input, Pacing) {
+    typedef std::chrono::steady_clock clock;
+    const double rate = 50;
+    // [s] since the first frame was shown, the playback clock starts before that
+    auto elapsed = [](clock::time_point start) { return std::chrono::duration<double>(clock::now() - start).count(); };
+
+    // a fast consumer gets every frame, none before its time
+    input::prefetcher fast(std::unique_ptr<input::source>(new clockedSource(rate)), {0, 0, 0, 0}, 4);
+    ASSERT_TRUE(fast.isPaced());
+    fast.start();
+    cv::Mat img;
+    ASSERT_TRUE(fast.next(img));
+    const clock::time_point fastStart = clock::now();
+    for (int k = 1; k < 10; ++k) {
+        ASSERT_TRUE(fast.next(img));
+        EXPECT_EQ(k, img.at<uint8_t>(0, 0));
+        EXPECT_GE(elapsed(fastStart), k / rate - 0.001);
+    }
+    fast.stop();
+    EXPECT_EQ(0u, fast.getDropped());
+    EXPECT_EQ(0u, fast.getLate());
+
+    // a consumer at 1.75 frame periods per frame: the frames it is too slow for are skipped,
+    // decoded ones as late, later ones without decoding as dropped
+    input::prefetcher slow(std::unique_ptr<input::source>(new clockedSource(rate)), {0, 0, 0, 0}, 4);
+    slow.start();
+    ASSERT_TRUE(slow.next(img));
+    const clock::time_point slowStart = clock::now();
+    int shown = 0, last = 0;
+    for (int k = 1; k < 16; ++k) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(1.75 / rate));
+        ASSERT_TRUE(slow.next(img));
+        const int frame = img.at<uint8_t>(0, 0);
+        EXPECT_GT(frame, last);
+        EXPECT_GE(elapsed(slowStart), frame / rate - 0.001);
+        shown++;
+        last = frame;
+    }
+    slow.stop();
+    // every late frame was passed over for a later one, the dropped ones may also lie ahead
+    const uint64_t skipped = last - shown;
+    EXPECT_GT(skipped, 0u);
+    EXPECT_GT(slow.getLate(), 0u);
+    EXPECT_LE(slow.getLate(), skipped);
+    EXPECT_GE(slow.getLate() + slow.getDropped(), skipped);
+}
+
+// a live source that lends its frames from a few buffers like the screen capture,
+// a buffer is only written again after its handle was released
+class lendingSource : public input::source {
+public:
+    lendingSource(size_t buffers) {
+        for (size_t i = 0; i < buffers; ++i) {
+            pixels.push_back(cv::Mat(1, 1, CV_8UC1));
+            idle.push_back(i);
+        }
+    }
+    bool open() override { return true; }
+    bool read(cv::Mat& img) override {
+        std::shared_ptr<void> handle;
+        if (!borrow(img, handle))
+            return false;
+        img = img.clone();
+        return true;
+    }
+    bool borrow(cv::Mat& img, std::shared_ptr<void>& handle) override {
+        // a frame per millisecond
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::unique_lock<std::mutex> lock(mutex);
+        returned.wait(lock, [&] { return !idle.empty() || interrupted; });
+        if (interrupted)
+            return false;
+        const size_t i = idle.back();
+        idle.pop_back();
+        pixels[i].at<uint8_t>(0, 0) = static_cast<uint8_t>(++frame);
+        img = pixels[i];
+        handle = std::shared_ptr<void>(&pixels[i], [this, i](cv::Mat*) {
+            std::lock_guard<std::mutex> lock(mutex);
+            idle.push_back(i);
+            returned.notify_all();
+        });
+        return true;
+    }
+    void interrupt() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        interrupted = true;
+        returned.notify_all();
+    }
+    bool isLive() const override { return true; }
+    std::string getName() const override { return "lending"; }
+    size_t getIdle() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return idle.size();
+    }
+
+private:
+    std::vector<cv::Mat> pixels;
+    std::mutex mutex;
+    std::condition_variable returned;
+    std::vector<size_t> idle;
+    bool interrupted = false;
+    int frame = 0;
+};
+
+TEST(Input, Recording) {
+    const std::string file = ::testing::TempDir() + "laser-display-recording-" + std::to_string(getpid()) + ".raw";
+    // without pacing the frames are decoded at once, but stamped when they are due
+    input::prefetcher prefetch(std::unique_ptr<input::source>(new clockedSource(50)), {0, 0, 0, 0}, 2, true, false);
+    ASSERT_EQ(0, prefetch.record(file));
+    prefetch.start();
+    cv::Mat img;
+    for (int k = 0; k < 5; ++k)
+        ASSERT_TRUE(prefetch.next(img));
+    prefetch.stop();
+
+    rawframes::reader r;
+    ASSERT_EQ(0, r.open(file));
+    ASSERT_GE(r.getFrames(), 5u);
+    for (size_t k = 0; k < r.getFrames(); ++k) {
+        EXPECT_NEAR(20e6 * k, static_cast<double>(r.getTimestamp(k)), 1);
+        EXPECT_EQ(k, r.getFrame(k).at<uint8_t>(1, 1));
+    }
+    r.close();
+    std::remove(file.c_str());
+}
+
+TEST(Input, BorrowedFrames) {
+    // the prefetch ring, the frame of the consumer and the one being captured
+    const size_t depth = 2;
+    std::unique_ptr<lendingSource> lending(new lendingSource(depth + 2));
+    lendingSource& source = *lending;
+    input::prefetcher prefetch(std::move(lending), {0, 0, 0, 0}, depth);
+    prefetch.start();
+    cv::Mat img;
+    int last = 0;
+    for (int k = 0; k < 20; ++k) {
+        ASSERT_TRUE(prefetch.next(img));
+        const int frame = img.at<uint8_t>(0, 0);
+        EXPECT_GT(frame, last);
+        // the source keeps on capturing, but not into the frame in use
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        EXPECT_EQ(frame, img.at<uint8_t>(0, 0));
+        last = frame;
+    }
+    EXPECT_GT(prefetch.getDropped(), 0u);
+    prefetch.stop();
+    // all buffers are back
+    EXPECT_EQ(depth + 2, source.getIdle());
+}
+
+TEST(Input, SharedMemoryFrames) {
+    const std::string name = "/laser-display-source-" + std::to_string(getpid());
+    input::shmSource source(name, 2, 64, 1);
+    ASSERT_TRUE(source.open());
+    shmring::ring producer;
+    ASSERT_EQ(0, producer.attach(name));
+    auto publish = [&](uint8_t value) {
+        uint8_t* pixels = producer.beginFrame();
+        if (pixels == NULL)
+            return false;
+        std::fill(pixels, pixels + 12, value);
+        return producer.publish(2, 2, shmring::bgr, 6);
+    };
+
+    // the borrowed slot is in place and not written while its handle lives
+    ASSERT_TRUE(publish(1));
+    cv::Mat img;
+    std::shared_ptr<void> handle;
+    ASSERT_TRUE(source.borrow(img, handle));
+    ASSERT_TRUE(static_cast<bool>(handle));
+    EXPECT_EQ(1, img.at<cv::Vec3b>(1, 1)[2]);
+    ASSERT_TRUE(publish(2));
+    EXPECT_FALSE(publish(3));
+    EXPECT_EQ(1, img.at<cv::Vec3b>(1, 1)[2]);
+    // released with the handle, the view shows the slot being written again
+    handle.reset();
+    ASSERT_TRUE(publish(3));
+    EXPECT_EQ(3, img.at<cv::Vec3b>(1, 1)[2]);
+
+    // read() copies and releases the slot at once
+    cv::Mat copy;
+    ASSERT_TRUE(source.read(copy));
+    EXPECT_EQ(3, copy.at<cv::Vec3b>(0, 0)[0]);
+    ASSERT_TRUE(publish(4));
+    ASSERT_TRUE(publish(5));
+    EXPECT_EQ(3, copy.at<cv::Vec3b>(0, 0)[0]);
+    ASSERT_TRUE(source.read(copy));
+    EXPECT_EQ(5, copy.at<cv::Vec3b>(0, 0)[0]);
+
+    // a foreign producer can write any header, frames that do not fit into their slot
+    // are given back and the next frame is used
+    const std::array<std::array<uint32_t, 4>, 4> broken = {{
+        {{2, 100, shmring::bgr, 6}}, // beyond the slot
+        {{2, 2, shmring::bgra, 6}},  // rows overlap
+        {{0, 2, shmring::bgr, 6}},   // empty
+        {{2, 2, 7, 6}}               // unknown format
+    }};
+    for (size_t k = 0; k < broken.size(); ++k) {
+        uint8_t* pixels = producer.beginFrame();
+        ASSERT_TRUE(pixels != NULL) << k;
+        ASSERT_TRUE(producer.publish(2, 2, shmring::bgr, 6));
+        for (int slot = 0; slot < 2; ++slot) {
+            if (producer.getPixels(slot) != pixels)
+                continue;
+            shmring::frameHeader& f = const_cast<shmring::frameHeader&>(producer.getFrame(slot));
+            f.width = broken[k][0];
+            f.height = broken[k][1];
+            f.format = broken[k][2];
+            f.stride = broken[k][3];
+        }
+        std::thread next([&]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            publish(static_cast<uint8_t>(10 + k));
+        });
+        EXPECT_TRUE(source.read(copy)) << k;
+        next.join();
+        ASSERT_EQ(2, copy.rows) << k;
+        EXPECT_EQ(10 + k, copy.at<cv::Vec3b>(1, 1)[0]) << k;
+    }
+}
+
+TEST(FrameCache, LruAndSpill) {
+    framecache::cacheParameters p;
+    p.memory = 2;
+    p.spillFile = "/tmp/laser-display-cache-" + std::to_string(getpid());
+    p.spill = 8;
+    framecache::cache c(p);
+
+    // about 1.4 MB per frame, only one fits into memory
+    auto makeFrame = [](int seed) {
+        laser::frame f;
+        for (int i = 0; i < 200000; ++i)
+            f.push(i % 1000 + seed, seed, 1, 2, 3);
+        f.width = 640;
+        f.height = 480;
+        return f;
+    };
+    const std::vector<cv::Vec4i> lines = {cv::Vec4i(1, 2, 3, 4)};
+    c.insert(1, makeFrame(1), lines);
+    c.insert(2, makeFrame(2), lines);
+    EXPECT_LT(c.getBytes(), 2u << 20);
+    EXPECT_EQ(2u, c.getFrames());
+
+    // served from the spill file, the trace id of the frame is kept
+    laser::frame out;
+    out.sequence = 7;
+    std::vector<cv::Vec4i> l;
+    ASSERT_TRUE(c.lookup(1, out, l));
+    EXPECT_EQ(7u, out.sequence);
+    EXPECT_EQ(200000u, out.size());
+    EXPECT_EQ(11, out.x[10]);
+    EXPECT_EQ(640, out.width);
+    ASSERT_EQ(1u, l.size());
+    EXPECT_EQ(4, l[0][3]);
+    // frame 2 made room and is found in the spill file
+    ASSERT_TRUE(c.lookup(2, out, l));
+    EXPECT_EQ(12, out.x[10]);
+    EXPECT_FALSE(c.lookup(3, out, l));
+    EXPECT_EQ(2u, c.getHits());
+    EXPECT_EQ(1u, c.getMisses());
+
+    c.clear();
+    EXPECT_FALSE(c.lookup(1, out, l));
+    EXPECT_EQ(0u, c.getFrames());
+}